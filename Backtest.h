@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Capture.h"
+#include "LevelInfo.h"
+#include "MarketDataFeed.h"
+#include "OrderBook.h"
+#include "WorkStealingPool.h"
+
+// Parallel replay of captured sessions. Every (symbol, session date) found in the
+// capture headers is one job with a fresh book, so jobs share nothing and run on a
+// WorkStealingPool with no locking beyond the pool's own. Results come back in plan
+// order with the per-job MarketDataStats and book state, plus their totals.
+
+// Backtests only need the message counters; per-message timers would cost more than
+// the messages themselves.
+using BacktestBook = BasicOrderbook<MapBookSide, CountingInstrumentation>;
+
+struct BacktestJob {
+    std::string symbol;
+    std::string sessionDate;
+    std::vector<std::filesystem::path> files; // replayed in this order onto one book
+    std::uint64_t events = 0;                 // records across the files, for scheduling
+};
+
+struct BacktestOptions {
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    bool pinCores = true;
+    ReplayOptions replay{4096, 0.0, true};
+};
+
+// One capture file of a job, and where the job's book stood once it was replayed.
+struct BacktestFileResult {
+    std::filesystem::path file;
+    ReplayResult replay;
+    std::uint64_t trades = 0; // trades during this file alone
+    std::optional<LevelInfo> bestBid;
+    std::optional<LevelInfo> bestAsk;
+};
+
+struct BacktestResult {
+    std::string symbol;
+    std::string sessionDate;
+    std::size_t files = 0;
+    std::vector<BacktestFileResult> captures; // files replayed in full, in replay order
+    ReplayResult replay;      // summed over the job's files
+    MarketDataStats stats;
+    std::size_t restingOrders = 0;
+    std::size_t bidLevels = 0;
+    std::size_t askLevels = 0;
+    std::optional<LevelInfo> bestBid;
+    std::optional<LevelInfo> bestAsk;
+    std::string error;        // empty unless the job failed; its counts stop where it did
+
+    bool Ok() const { return error.empty(); }
+};
+
+struct BacktestSummary {
+    std::vector<BacktestResult> results; // same order as the plan
+    MarketDataStats total;
+    std::uint64_t events = 0;
+    std::uint64_t applied = 0;
+    std::size_t failed = 0;
+    std::uint64_t steals = 0;
+    std::chrono::nanoseconds elapsed{0}; // wall clock for the whole run
+
+    double EventsPerSecond() const {
+        return elapsed.count() > 0 ? events * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+    }
+};
+
+namespace BacktestDetail {
+    template<typename Book>
+    void ReadTopOfBook(const Book &book, std::optional<LevelInfo> &bestBid, std::optional<LevelInfo> &bestAsk) {
+        LevelInfo best{};
+        bestBid = book.GetTopLevels(Side::Buy, std::span<LevelInfo>(&best, 1)) ? std::optional{best} : std::nullopt;
+        bestAsk = book.GetTopLevels(Side::Sell, std::span<LevelInfo>(&best, 1)) ? std::optional{best} : std::nullopt;
+    }
+
+    // Reads only the header, so planning a large capture set does not map every file.
+    // Empty when the file does not start with a compatible capture header.
+    inline std::optional<CaptureHeader> ReadHeader(const std::filesystem::path &path, std::uint64_t &records) {
+        std::ifstream in(path, std::ios::binary);
+        CaptureHeader header{};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!in || !header.IsValid()) return std::nullopt;
+        records = (std::filesystem::file_size(path) - sizeof(CaptureHeader)) / sizeof(MarketDataEvent);
+        return header;
+    }
+}
+
+// Turns files and directories (their regular files, not recursing) into one job per
+// symbol and session date. Files of the same job are replayed in path order. Throws
+// std::runtime_error on a missing path or a named file that is not a capture. Other
+// files found in a directory, such as the CSV a previous run wrote there, are left
+// out and listed in `skipped` when it is given.
+inline std::vector<BacktestJob> PlanBacktest(std::span<const std::filesystem::path> inputs,
+                                             std::vector<std::filesystem::path> *skipped = nullptr) {
+    std::vector<std::pair<std::filesystem::path, bool>> files; // path, named explicitly
+    for (const auto &input: inputs) {
+        if (std::filesystem::is_directory(input)) {
+            for (const auto &entry: std::filesystem::directory_iterator(input)) {
+                if (entry.is_regular_file()) files.emplace_back(entry.path(), false);
+            }
+        } else if (std::filesystem::is_regular_file(input)) {
+            files.emplace_back(input, true);
+        } else {
+            throw std::runtime_error("No such capture file or directory: " + input.string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::map<std::pair<std::string, std::string>, BacktestJob> jobs;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        // A file both named and found in a directory comes last as named; plan it once.
+        if (i + 1 < files.size() && files[i + 1].first == files[i].first) continue;
+        const auto &[file, named] = files[i];
+        std::uint64_t records = 0;
+        const std::optional<CaptureHeader> header = BacktestDetail::ReadHeader(file, records);
+        if (!header) {
+            if (named) throw std::runtime_error("Not a compatible capture file: " + file.string());
+            if (skipped) skipped->push_back(file);
+            continue;
+        }
+        BacktestJob &job = jobs[{header->GetSymbol(), header->GetSessionDate()}];
+        job.symbol = header->GetSymbol();
+        job.sessionDate = header->GetSessionDate();
+        job.files.push_back(file);
+        job.events += records;
+    }
+
+    std::vector<BacktestJob> plan;
+    plan.reserve(jobs.size());
+    for (auto &[key, job]: jobs) plan.push_back(std::move(job));
+    return plan;
+}
+
+template<typename Book = BacktestBook>
+BacktestResult RunBacktestJob(const BacktestJob &job, const ReplayOptions &options) {
+    BacktestResult result;
+    result.symbol = job.symbol;
+    result.sessionDate = job.sessionDate;
+    auto book = std::make_unique<Book>();
+    result.captures.reserve(job.files.size());
+    try {
+        for (const auto &file: job.files) {
+            const std::uint64_t tradesBefore = book->GetMarketDataStats().trades;
+            CaptureReader reader(file);
+            BacktestFileResult capture;
+            capture.file = file;
+            capture.replay = ReplayCapture(*book, reader, options);
+            capture.trades = book->GetMarketDataStats().trades - tradesBefore;
+            BacktestDetail::ReadTopOfBook(*book, capture.bestBid, capture.bestAsk);
+            result.replay.events += capture.replay.events;
+            result.replay.applied += capture.replay.applied;
+            result.replay.elapsed += capture.replay.elapsed;
+            result.captures.push_back(std::move(capture));
+            ++result.files;
+        }
+    } catch (const std::exception &e) {
+        result.error = e.what();
+    }
+
+    result.stats = book->GetMarketDataStats();
+    result.restingOrders = book->Size();
+    result.bidLevels = book->GetLevelCount(Side::Buy);
+    result.askLevels = book->GetLevelCount(Side::Sell);
+    BacktestDetail::ReadTopOfBook(*book, result.bestBid, result.bestAsk);
+    return result;
+}
+
+// Runs every job on a pool of options.threads workers. Jobs are submitted largest
+// first, so the long days start early and work stealing evens out the short tail.
+template<typename Book = BacktestBook>
+BacktestSummary RunBacktest(std::span<const BacktestJob> jobs, const BacktestOptions &options = {}) {
+    BacktestSummary summary;
+    summary.results.resize(jobs.size());
+
+    std::vector<std::size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(),
+                     [&jobs](std::size_t lhs, std::size_t rhs) { return jobs[lhs].events > jobs[rhs].events; });
+
+    const auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(std::max<std::size_t>(1, std::min(options.threads, std::max<std::size_t>(1, jobs.size()))),
+                              options.pinCores);
+        for (std::size_t index: order) {
+            pool.Submit([&summary, &jobs, &options, index] {
+                summary.results[index] = RunBacktestJob<Book>(jobs[index], options.replay);
+            });
+        }
+        pool.Wait();
+        summary.steals = pool.GetStealCount();
+    }
+    summary.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+    for (const BacktestResult &result: summary.results) {
+        summary.total.Merge(result.stats);
+        summary.events += result.replay.events;
+        summary.applied += result.replay.applied;
+        if (!result.Ok()) ++summary.failed;
+    }
+    return summary;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "OrderType.h"
+#include "PriceLevel.h"
+#include "Types.h"
+
+// Book side policies. Orderbook is parameterised over one of these and only talks
+// to a side through the small interface below, always best price first:
+//   Empty, LevelCount, BestPrice, BestLevel, CanHold, Find, GetOrCreate, Erase,
+//   Clear, ForEachLevel(fn(Price, const PriceLevel &) -> bool keepGoing),
+//   AllocatedBytes
+// A side never erases levels on its own; the book erases a level once it empties.
+// Neither side keeps slack once a level is erased, so there is nothing to compact.
+
+struct MapBookSideConfig {
+};
+
+template<Side S>
+class MapBookSide {
+    // Price levels in an ordered map. Unbounded price range, O(log n) level access.
+public:
+    using Config = MapBookSideConfig;
+
+    explicit MapBookSide(const Config & = {}) {
+    }
+
+    bool Empty() const { return levels_.empty(); }
+    std::size_t LevelCount() const { return levels_.size(); }
+    Price BestPrice() const { return levels_.begin()->first; }
+    PriceLevel &BestLevel() { return levels_.begin()->second; }
+
+    bool CanHold(Price) const { return true; }
+
+    PriceLevel *Find(Price price) {
+        auto it = levels_.find(price);
+        return it == levels_.end() ? nullptr : &it->second;
+    }
+
+    PriceLevel &GetOrCreate(Price price) { return levels_[price]; }
+    void Erase(Price price) { levels_.erase(price); }
+    void Clear() { levels_.clear(); }
+
+    template<typename Fn>
+    void ForEachLevel(Fn &&fn) const {
+        for (const auto &[price, level]: levels_) {
+            if (!fn(price, level)) break;
+        }
+    }
+
+    // Estimated: a red-black tree node holds the entry plus three links and a colour,
+    // padded here to four pointers.
+    std::size_t AllocatedBytes() const {
+        return levels_.size() * (sizeof(std::pair<const Price, PriceLevel>) + 4 * sizeof(void *));
+    }
+
+private:
+    using Compare = std::conditional_t<S == Side::Buy, std::greater<Price>, std::less<Price> >;
+
+    std::map<Price, PriceLevel, Compare> levels_;
+};
+
+struct LadderConfig {
+    // Price band covered by a LadderBookSide: levelCount ticks starting at basePrice.
+    // tickSize should match ExchangeRules::tickSize so every valid price has a slot.
+    Price basePrice = 0;
+    Price tickSize = 1;
+    std::size_t levelCount = 0;
+
+    static LadderConfig FromBand(Price low, Price high, Price tickSize) {
+        return LadderConfig{low, tickSize, static_cast<std::size_t>((high - low) / tickSize) + 1};
+    }
+};
+
+template<Side S>
+class LadderBookSide {
+    // Price levels in a contiguous array indexed by (price - basePrice) / tickSize,
+    // with a bitmap of non-empty levels so the next level after the best one is
+    // found with word-wide scans. Prices outside the band are rejected via CanHold.
+public:
+    using Config = LadderConfig;
+
+    explicit LadderBookSide(const Config &config = {})
+        : basePrice_{config.basePrice}
+          , tickSize_{config.tickSize}
+          , levels_(config.levelCount)
+          , occupied_((config.levelCount + 63) / 64, 0) {
+    }
+
+    bool Empty() const { return best_ == NoLevel; }
+    std::size_t LevelCount() const { return levelCount_; }
+    Price BestPrice() const { return PriceAt(best_); }
+    PriceLevel &BestLevel() { return levels_[best_]; }
+
+    bool CanHold(Price price) const {
+        if (price < basePrice_) return false;
+        const std::int64_t offset = static_cast<std::int64_t>(price) - basePrice_;
+        return offset % tickSize_ == 0 && static_cast<std::size_t>(offset / tickSize_) < levels_.size();
+    }
+
+    PriceLevel *Find(Price price) {
+        if (!CanHold(price)) return nullptr;
+        const std::size_t index = IndexOf(price);
+        return IsOccupied(index) ? &levels_[index] : nullptr;
+    }
+
+    PriceLevel &GetOrCreate(Price price) {
+        const std::size_t index = IndexOf(price);
+        if (!IsOccupied(index)) {
+            occupied_[index >> 6] |= std::uint64_t{1} << (index & 63);
+            ++levelCount_;
+            if (best_ == NoLevel || IsBetter(index, best_)) best_ = index;
+        }
+        return levels_[index];
+    }
+
+    void Erase(Price price) {
+        const std::size_t index = IndexOf(price);
+        occupied_[index >> 6] &= ~(std::uint64_t{1} << (index & 63));
+        levels_[index] = PriceLevel{};
+        --levelCount_;
+        if (index == best_) best_ = NextOccupied(index);
+    }
+
+    void Clear() {
+        std::fill(levels_.begin(), levels_.end(), PriceLevel{});
+        std::fill(occupied_.begin(), occupied_.end(), 0);
+        best_ = NoLevel;
+        levelCount_ = 0;
+    }
+
+    template<typename Fn>
+    void ForEachLevel(Fn &&fn) const {
+        for (std::size_t index = best_; index != NoLevel; index = NextOccupied(index)) {
+            if (!fn(PriceAt(index), levels_[index])) break;
+        }
+    }
+
+    // The whole band is allocated up front, whatever the number of levels in use.
+    std::size_t AllocatedBytes() const {
+        return levels_.capacity() * sizeof(PriceLevel) + occupied_.capacity() * sizeof(std::uint64_t);
+    }
+
+private:
+    static constexpr std::size_t NoLevel = std::numeric_limits<std::size_t>::max();
+
+    Price basePrice_;
+    Price tickSize_;
+    std::vector<PriceLevel> levels_;
+    std::vector<std::uint64_t> occupied_;
+    std::size_t best_ = NoLevel;
+    std::size_t levelCount_ = 0;
+
+    std::size_t IndexOf(Price price) const {
+        return static_cast<std::size_t>((static_cast<std::int64_t>(price) - basePrice_) / tickSize_);
+    }
+
+    Price PriceAt(std::size_t index) const {
+        return static_cast<Price>(basePrice_ + static_cast<std::int64_t>(index) * tickSize_);
+    }
+
+    bool IsOccupied(std::size_t index) const {
+        return (occupied_[index >> 6] >> (index & 63)) & 1;
+    }
+
+    // Bids are best at the highest index, asks at the lowest.
+    static bool IsBetter(std::size_t lhs, std::size_t rhs) {
+        return (S == Side::Buy) ? lhs > rhs : lhs < rhs;
+    }
+
+    // First non-empty level strictly behind `index` in priority order.
+    std::size_t NextOccupied(std::size_t index) const {
+        if constexpr (S == Side::Buy) {
+            if (index == 0) return NoLevel;
+            std::size_t start = index - 1;
+            std::size_t word = start >> 6;
+            std::uint64_t bits = occupied_[word] & (~std::uint64_t{0} >> (63 - (start & 63)));
+            while (true) {
+                if (bits) return word * 64 + 63 - std::countl_zero(bits);
+                if (word == 0) return NoLevel;
+                bits = occupied_[--word];
+            }
+        } else {
+            std::size_t start = index + 1;
+            if (start >= levels_.size()) return NoLevel;
+            std::size_t word = start >> 6;
+            std::uint64_t bits = occupied_[word] & (~std::uint64_t{0} << (start & 63));
+            while (true) {
+                if (bits) return word * 64 + std::countr_zero(bits);
+                if (++word == occupied_.size()) return NoLevel;
+                bits = occupied_[word];
+            }
+        }
+    }
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "MarketDataFeed.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Capture file format: a 64-byte CaptureHeader followed by back-to-back
+// MarketDataEvent records in host byte order. Snapshots are stored as record runs
+// (see EventKind). Files are append-only; a record cut short by a crash while
+// writing is ignored on replay. Because records are fixed-size and trivially
+// copyable, a mapped file can be handed to ProcessMarketDataBatch as-is.
+
+struct CaptureHeader {
+    static constexpr char MagicValue[8] = {'O', 'B', 'C', 'A', 'P', 'T', 'R', '\0'};
+    static constexpr std::uint32_t CurrentVersion = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;    // sizeof(MarketDataEvent) when written
+    std::int64_t createdNs;      // system_clock nanoseconds since epoch
+    char symbol[24];             // NUL-padded
+    char sessionDate[16];        // "YYYY-MM-DD", NUL-padded
+
+    static CaptureHeader Make(const std::string &symbol, const std::string &sessionDate) {
+        CaptureHeader header{};
+        std::memcpy(header.magic, MagicValue, sizeof(magic));
+        header.version = CurrentVersion;
+        header.recordSize = sizeof(MarketDataEvent);
+        header.createdNs = MarketDataEvent::ToNanos(std::chrono::system_clock::now());
+        std::memcpy(header.symbol, symbol.data(), std::min(symbol.size(), sizeof(header.symbol) - 1));
+        std::memcpy(header.sessionDate, sessionDate.data(),
+                    std::min(sessionDate.size(), sizeof(header.sessionDate) - 1));
+        return header;
+    }
+
+    bool IsValid() const {
+        return std::memcmp(magic, MagicValue, sizeof(magic)) == 0 &&
+               version == CurrentVersion && recordSize == sizeof(MarketDataEvent);
+    }
+
+    std::string GetSymbol() const { return std::string(symbol, strnlen(symbol, sizeof(symbol))); }
+    std::string GetSessionDate() const { return std::string(sessionDate, strnlen(sessionDate, sizeof(sessionDate))); }
+};
+
+static_assert(sizeof(CaptureHeader) == 64);
+static_assert(std::is_trivially_copyable_v<CaptureHeader>);
+
+class CaptureWriter {
+    // Appends records to a capture file. A new file gets a header first; an existing
+    // one is checked for a compatible header and extended. Writes are buffered;
+    // call Flush() at checkpoints you want to survive a crash.
+public:
+    CaptureWriter(const std::filesystem::path &path, const std::string &symbol, const std::string &sessionDate) {
+        std::error_code ec;
+        const auto existingSize = std::filesystem::file_size(path, ec);
+        const bool exists = !ec && existingSize >= sizeof(CaptureHeader);
+
+        if (exists) {
+            CaptureHeader header{};
+            std::ifstream in(path, std::ios::binary);
+            in.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (!in || !header.IsValid()) {
+                throw std::runtime_error("Not a compatible capture file: " + path.string());
+            }
+            header_ = header;
+            // Drop a torn trailing record so appends stay aligned
+            const auto whole = sizeof(CaptureHeader) +
+                               (existingSize - sizeof(CaptureHeader)) / sizeof(MarketDataEvent) * sizeof(MarketDataEvent);
+            if (whole != existingSize) std::filesystem::resize_file(path, whole);
+        } else {
+            header_ = CaptureHeader::Make(symbol, sessionDate);
+        }
+
+        out_.open(path, exists ? (std::ios::binary | std::ios::app) : (std::ios::binary | std::ios::trunc));
+        if (!out_) throw std::runtime_error("Cannot open capture file: " + path.string());
+        if (!exists) out_.write(reinterpret_cast<const char *>(&header_), sizeof(header_));
+        buffer_.reserve(BufferRecords);
+    }
+
+    ~CaptureWriter() {
+        try {
+            Flush();
+        } catch (...) {
+        }
+    }
+
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+    void Write(const MarketDataEvent &event) {
+        buffer_.push_back(event);
+        if (buffer_.size() == BufferRecords) Flush();
+    }
+
+    void Write(const MarketDataMessage &message) {
+        AppendMarketDataEvents(message, buffer_);
+        if (buffer_.size() >= BufferRecords) Flush();
+    }
+
+    void Flush() {
+        if (!buffer_.empty()) {
+            out_.write(reinterpret_cast<const char *>(buffer_.data()),
+                       static_cast<std::streamsize>(buffer_.size() * sizeof(MarketDataEvent)));
+            recordsWritten_ += buffer_.size();
+            buffer_.clear();
+        }
+        out_.flush();
+        if (!out_) throw std::runtime_error("Capture write failed");
+    }
+
+    const CaptureHeader &GetHeader() const { return header_; }
+    std::uint64_t GetRecordsWritten() const { return recordsWritten_ + buffer_.size(); }
+
+private:
+    static constexpr std::size_t BufferRecords = 4096;
+
+    std::ofstream out_;
+    CaptureHeader header_{};
+    std::vector<MarketDataEvent> buffer_;
+    std::uint64_t recordsWritten_ = 0;
+};
+
+class CaptureReader {
+    // Read-only memory mapping of a capture file. Events() points straight into the
+    // mapping, so nothing is copied or parsed; pages are faulted in as they are read.
+public:
+    explicit CaptureReader(const std::filesystem::path &path) {
+        Map(path);
+        if (size_ < sizeof(CaptureHeader)) {
+            Unmap();
+            throw std::runtime_error("Capture file too small: " + path.string());
+        }
+        std::memcpy(&header_, data_, sizeof(header_));
+        if (!header_.IsValid()) {
+            Unmap();
+            throw std::runtime_error("Not a compatible capture file: " + path.string());
+        }
+        recordCount_ = (size_ - sizeof(CaptureHeader)) / sizeof(MarketDataEvent);
+    }
+
+    ~CaptureReader() { Unmap(); }
+
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader &operator=(const CaptureReader &) = delete;
+
+    const CaptureHeader &GetHeader() const { return header_; }
+
+    // The header is 64 bytes and mappings are page aligned, so records are suitably
+    // aligned for MarketDataEvent.
+    std::span<const MarketDataEvent> Events() const {
+        if (recordCount_ == 0) return {};
+        return std::span<const MarketDataEvent>(
+            reinterpret_cast<const MarketDataEvent *>(static_cast<const std::byte *>(data_) + sizeof(CaptureHeader)),
+            recordCount_);
+    }
+
+private:
+    const void *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t recordCount_ = 0;
+    CaptureHeader header_{};
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+
+    void Map(const std::filesystem::path &path) {
+#ifdef _WIN32
+        file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open capture file: " + path.string());
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file_, &fileSize);
+        size_ = static_cast<std::size_t>(fileSize.QuadPart);
+        if (size_ == 0) return;
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_) data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+        if (!data_) {
+            Unmap();
+            throw std::runtime_error("Cannot map capture file: " + path.string());
+        }
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Cannot open capture file: " + path.string());
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot stat capture file: " + path.string());
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ > 0) {
+            void *mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map capture file: " + path.string());
+            }
+            ::madvise(mapped, size_, MADV_SEQUENTIAL);
+            data_ = mapped;
+        }
+        ::close(fd); // the mapping keeps the file alive
+#endif
+    }
+
+    void Unmap() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) ::munmap(const_cast<void *>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+};
+
+struct ReplayOptions {
+    std::size_t batchSize = 4096;
+    // 0 replays as fast as possible; 1.0 reproduces the recorded gaps between
+    // events, 2.0 runs twice as fast, and so on.
+    double speed = 0.0;
+    // Moves the book's clock to each batch's first timestamp before applying it, so
+    // GoodForDay orders expire at the recorded session close (to batch granularity).
+    bool advanceTime = false;
+};
+
+struct ReplayResult {
+    std::uint64_t events = 0;
+    std::uint64_t applied = 0; // events the book accepted
+    std::chrono::nanoseconds elapsed{0};
+
+    double EventsPerSecond() const {
+        return elapsed.count() > 0 ? events * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+    }
+};
+
+// Feeds a record stream to book.ProcessMarketDataBatch in place, either flat out or
+// paced to the recorded timestamps, optionally driving book.AdvanceTime as it goes.
+template<typename Book>
+ReplayResult ReplayCapture(Book &book, std::span<const MarketDataEvent> events, const ReplayOptions &options = {}) {
+    ReplayResult result;
+    const std::size_t batchSize = std::max<std::size_t>(1, options.batchSize);
+    const auto start = std::chrono::steady_clock::now();
+    const std::int64_t firstTimestamp = events.empty() ? 0 : events.front().timestampNs;
+
+    std::size_t offset = 0;
+    while (offset < events.size()) {
+        std::size_t count = std::min(batchSize, events.size() - offset);
+
+        if (options.speed > 0.0) {
+            // Release only events that are due, waiting for the next one if none is.
+            auto dueOffset = [&](std::size_t index) {
+                return std::chrono::nanoseconds(static_cast<std::int64_t>(
+                    (events[index].timestampNs - firstTimestamp) / options.speed));
+            };
+            const auto now = std::chrono::steady_clock::now() - start;
+            if (dueOffset(offset) > now) {
+                std::this_thread::sleep_until(start + dueOffset(offset));
+                continue;
+            }
+            std::size_t due = 1;
+            while (due < count && dueOffset(offset + due) <= now) ++due;
+            count = due;
+        }
+
+        if (options.advanceTime) book.AdvanceTime(events[offset].timestampNs);
+        result.applied += book.ProcessMarketDataBatch(events.subspan(offset, count));
+        offset += count;
+    }
+
+    result.events = events.size();
+    result.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+template<typename Book>
+ReplayResult ReplayCapture(Book &book, const CaptureReader &reader, const ReplayOptions &options = {}) {
+    return ReplayCapture(book, reader.Events(), options);
+}
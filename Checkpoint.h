@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include "ExchangeRules.h"
+#include "MarketDataFeed.h"
+#include "Order.h"
+#include "OrderType.h"
+#include "Types.h"
+
+// Checkpoint image format (see BasicOrderbook::SaveCheckpoint): a 64-byte
+// CheckpointHeader, the book's ExchangeRules, its CheckpointCounters, then
+// orderCount CheckpointOrder records in host byte order. Bids come first, best
+// level first, then asks the same way; within a level records are in FIFO order,
+// and consecutive records with the same side and price make up one level, so queue
+// position survives a restart without any level records.
+
+// The message counters of MarketDataStats; latency histograms are not carried over.
+struct CheckpointCounters {
+    std::uint64_t messagesProcessed;
+    std::uint64_t newOrders;
+    std::uint64_t cancellations;
+    std::uint64_t modifications;
+    std::uint64_t trades;
+    std::uint64_t snapshots;
+    std::uint64_t depthUpdates;
+    std::uint64_t errors;
+    std::uint64_t sequenceGaps;
+
+    static CheckpointCounters From(const MarketDataStats &stats) {
+        return CheckpointCounters{
+            stats.messagesProcessed, stats.newOrders, stats.cancellations, stats.modifications, stats.trades,
+            stats.snapshots, stats.depthUpdates, stats.errors, stats.sequenceGaps
+        };
+    }
+
+    void ApplyTo(MarketDataStats &stats) const {
+        stats.messagesProcessed = messagesProcessed;
+        stats.newOrders = newOrders;
+        stats.cancellations = cancellations;
+        stats.modifications = modifications;
+        stats.trades = trades;
+        stats.snapshots = snapshots;
+        stats.depthUpdates = depthUpdates;
+        stats.errors = errors;
+        stats.sequenceGaps = sequenceGaps;
+    }
+};
+
+struct CheckpointOrder {
+    OrderId orderId;
+    Price price;
+    Quantity initialQuantity;
+    Quantity remainingQuantity;
+    std::uint8_t orderType;
+    std::uint8_t side;
+    std::uint8_t isMarket;
+    std::uint8_t reserved;
+
+    static CheckpointOrder From(const Order &order) {
+        return CheckpointOrder{
+            order.GetOrderId(), order.GetPrice(), order.GetInitialQuantity(), order.GetRemainingQuantity(),
+            static_cast<std::uint8_t>(order.GetOrderType()), static_cast<std::uint8_t>(order.GetSide()),
+            static_cast<std::uint8_t>(order.IsMarket()), 0
+        };
+    }
+
+    Side GetSide() const { return static_cast<Side>(side); }
+
+    // Rebuilds the resting order, partial fill and market flag included.
+    Order ToOrder() const {
+        if (orderType > static_cast<std::uint8_t>(OrderType::FillOrKill) ||
+            side > static_cast<std::uint8_t>(Side::Sell) ||
+            remainingQuantity == 0 || remainingQuantity > initialQuantity) {
+            throw std::runtime_error("Corrupt checkpoint order record");
+        }
+        const OrderType type = isMarket ? OrderType::Market : static_cast<OrderType>(orderType);
+        Order order{type, orderId, GetSide(), price, initialQuantity};
+        if (isMarket) order.ToGoodTillCancel(price);
+        order.Fill(initialQuantity - remainingQuantity);
+        return order;
+    }
+};
+
+static_assert(sizeof(CheckpointOrder) == 24);
+static_assert(std::is_trivially_copyable_v<CheckpointOrder>);
+
+struct CheckpointHeader {
+    static constexpr char MagicValue[8] = {'O', 'B', 'C', 'H', 'K', 'P', 'T', '\0'};
+    static constexpr std::uint32_t CurrentVersion = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;        // sizeof(CheckpointOrder) when written
+    std::uint64_t orderCount;
+    std::uint64_t lastSequenceNumber;
+    std::uint64_t nextSyntheticId;
+    std::int64_t nextDayResetNs;
+    std::int32_t dayResetMinutes;    // session close, minutes after midnight
+    std::int32_t utcOffsetMinutes;
+    std::uint32_t rulesSize;         // sizeof(ExchangeRules) when written
+    std::uint8_t isInitialized;
+    std::uint8_t reserved[3];
+
+    static CheckpointHeader Make() {
+        CheckpointHeader header{};
+        std::memcpy(header.magic, MagicValue, sizeof(magic));
+        header.version = CurrentVersion;
+        header.recordSize = sizeof(CheckpointOrder);
+        header.rulesSize = sizeof(ExchangeRules);
+        return header;
+    }
+
+    bool IsValid() const {
+        return std::memcmp(magic, MagicValue, sizeof(magic)) == 0 && version == CurrentVersion &&
+               recordSize == sizeof(CheckpointOrder) && rulesSize == sizeof(ExchangeRules);
+    }
+};
+
+static_assert(sizeof(CheckpointHeader) == 64);
+static_assert(std::is_trivially_copyable_v<CheckpointHeader>);
+static_assert(std::is_trivially_copyable_v<ExchangeRules>);
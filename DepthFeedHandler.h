@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <utility>
+#include "MarketDataFeed.h"
+
+struct DepthSyncStats {
+    std::uint64_t updatesReceived = 0;
+    std::uint64_t updatesForwarded = 0;
+    std::uint64_t updatesDropped = 0;   // stale, or discarded while the buffer was full
+    std::uint64_t gaps = 0;             // sequence breaks seen while live
+    std::uint64_t resyncs = 0;
+    std::uint64_t snapshotsFetched = 0;
+};
+
+class DepthFeedHandler {
+    // Turns an incremental depth stream into a consistent message sequence for one
+    // book, following the usual exchange recipe: buffer deltas, fetch one REST
+    // snapshot, drop the deltas it already covers, then forward the rest in order.
+    // Once live, each delta must start at the previous lastSequence + 1. A gap is
+    // still forwarded so the book records it in MarketDataStats::sequenceGaps, and
+    // the handler falls back to buffering until a fresh snapshot lines up again.
+    //
+    // Transport-agnostic: the caller feeds decoded updates from whatever socket it
+    // owns. Not thread-safe; call from the feed thread only.
+public:
+    using SnapshotFetcher = std::function<std::optional<BookSnapshotMessage>()>;
+    using MessageSink = std::function<bool(MarketDataMessage)>;
+
+    DepthFeedHandler(SnapshotFetcher fetchSnapshot, MessageSink sink, std::size_t maxBuffered = 10000)
+        : fetchSnapshot_{std::move(fetchSnapshot)}
+          , sink_{std::move(sink)}
+          , maxBuffered_{maxBuffered} {
+    }
+
+    void OnDepthUpdate(DepthUpdateMessage update) {
+        ++stats_.updatesReceived;
+        if (live_) {
+            if (update.lastSequence <= lastSequence_) {
+                ++stats_.updatesDropped;
+                return;
+            }
+            if (update.firstSequence <= lastSequence_ + 1) {
+                const std::uint64_t last = update.lastSequence;
+                if (Forward(std::move(update))) {
+                    lastSequence_ = last;
+                } else {
+                    // The book missed this delta; the next update starts a resync.
+                    ++stats_.updatesDropped;
+                    StartResync();
+                }
+                return;
+            }
+            ++stats_.gaps;
+            Forward(update);
+            StartResync();
+        }
+        Buffer(std::move(update));
+        TrySync();
+    }
+
+    bool IsLive() const { return live_; }
+    std::uint64_t GetLastSequence() const { return lastSequence_; }
+    std::size_t GetBufferedCount() const { return buffered_.size(); }
+    const DepthSyncStats &GetStats() const { return stats_; }
+
+private:
+    SnapshotFetcher fetchSnapshot_;
+    MessageSink sink_;
+    std::size_t maxBuffered_;
+
+    std::deque<DepthUpdateMessage> buffered_;
+    std::optional<BookSnapshotMessage> snapshot_;
+    std::uint64_t lastSequence_ = 0;
+    bool live_ = false;
+    DepthSyncStats stats_;
+
+    bool Forward(MarketDataMessage message) {
+        if (!sink_(std::move(message))) return false;
+        ++stats_.updatesForwarded;
+        return true;
+    }
+
+    void StartResync() {
+        live_ = false;
+        snapshot_.reset();
+        ++stats_.resyncs;
+    }
+
+    void Buffer(DepthUpdateMessage update) {
+        if (buffered_.size() == maxBuffered_) {
+            buffered_.pop_front();
+            ++stats_.updatesDropped;
+        }
+        buffered_.push_back(std::move(update));
+    }
+
+    // Called with at least one update buffered. Fetches a snapshot if none is held,
+    // then goes live once the earliest delta newer than the snapshot continues it.
+    void TrySync() {
+        if (!snapshot_) {
+            snapshot_ = fetchSnapshot_();
+            if (!snapshot_) return;
+            ++stats_.snapshotsFetched;
+        }
+
+        const std::uint64_t snapshotSequence = snapshot_->sequenceNumber;
+        while (!buffered_.empty() && buffered_.front().lastSequence <= snapshotSequence) {
+            buffered_.pop_front();
+            ++stats_.updatesDropped;
+        }
+        if (buffered_.empty()) return; // the snapshot is ahead of the stream; wait for it
+        if (buffered_.front().firstSequence > snapshotSequence + 1) {
+            // Deltas between the snapshot and the buffer were lost; try a newer snapshot
+            // on the next update.
+            snapshot_.reset();
+            return;
+        }
+
+        if (!sink_(std::move(*snapshot_))) {
+            snapshot_.reset();
+            return;
+        }
+        snapshot_.reset();
+        lastSequence_ = snapshotSequence;
+        live_ = true;
+
+        while (!buffered_.empty()) {
+            const DepthUpdateMessage &front = buffered_.front();
+            if (front.lastSequence <= lastSequence_) {
+                buffered_.pop_front();
+                ++stats_.updatesDropped;
+                continue;
+            }
+            if (front.firstSequence > lastSequence_ + 1) {
+                // The stream broke while we were buffering; what is left cannot be
+                // applied on top of what was forwarded, so wait for a newer snapshot.
+                ++stats_.gaps;
+                StartResync();
+                return;
+            }
+            const std::uint64_t last = front.lastSequence;
+            if (!Forward(std::move(buffered_.front()))) {
+                buffered_.pop_front();
+                StartResync();
+                return;
+            }
+            buffered_.pop_front();
+            lastSequence_ = last;
+        }
+    }
+};
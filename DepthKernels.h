@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "Types.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Analytic kernels over one side of the book held as contiguous per-level arrays,
+// best level first, as filled by BasicOrderbook::GetTopLevels(side, prices,
+// quantities). With AVX2 enabled at build time (ORDERBOOK_AVX2 in CMake, or any
+// -mavx2 / -march that defines __AVX2__) the unsuffixed functions use 256-bit
+// kernels; otherwise they are the scalar versions, which are always available
+// under a Scalar suffix and give identical results.
+
+struct SweepCost {
+    std::uint64_t filled = 0;  // quantity available up to the requested size
+    std::int64_t notional = 0; // sum of price * quantity over what was filled
+    std::size_t levels = 0;    // levels touched, the last possibly in part
+
+    double AveragePrice() const { return filled ? static_cast<double>(notional) / static_cast<double>(filled) : 0.0; }
+};
+
+// Total quantity of the first `levels` levels (all of them if fewer).
+inline std::uint64_t CumulativeDepthScalar(std::span<const Quantity> quantities, std::size_t levels) {
+    const std::size_t count = std::min(levels, quantities.size());
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < count; ++i) total += quantities[i];
+    return total;
+}
+
+// Index of the first level at which the running quantity reaches threshold, or
+// quantities.size() if the whole side holds less. `before` receives the quantity
+// of the levels ahead of that index.
+inline std::size_t FirstLevelReachingScalar(std::span<const Quantity> quantities, std::uint64_t threshold,
+                                            std::uint64_t &before) {
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < quantities.size(); ++i) {
+        if (total + quantities[i] >= threshold) {
+            before = total;
+            return i;
+        }
+        total += quantities[i];
+    }
+    before = total;
+    return quantities.size();
+}
+
+inline std::size_t FirstLevelReachingScalar(std::span<const Quantity> quantities, std::uint64_t threshold) {
+    std::uint64_t before;
+    return FirstLevelReachingScalar(quantities, threshold, before);
+}
+
+// Sum of price * quantity over the first `levels` levels (all of them if fewer, and
+// no more than the shorter of the two arrays holds).
+inline std::int64_t NotionalScalar(std::span<const Price> prices, std::span<const Quantity> quantities,
+                                   std::size_t levels) {
+    const std::size_t count = std::min({levels, prices.size(), quantities.size()});
+    std::int64_t notional = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        notional += static_cast<std::int64_t>(prices[i]) * static_cast<std::int64_t>(quantities[i]);
+    }
+    return notional;
+}
+
+#if defined(__AVX2__)
+
+namespace DepthKernelsDetail {
+    inline std::uint64_t HorizontalSum(__m256i v) {
+        const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        return static_cast<std::uint64_t>(_mm_cvtsi128_si64(sum)) +
+               static_cast<std::uint64_t>(_mm_extract_epi64(sum, 1));
+    }
+
+    // Eight 32-bit quantities widened to 64 bits and summed into two accumulators.
+    inline __m256i AddQuantities(__m256i accumulator, const Quantity *quantities) {
+        const __m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(quantities));
+        accumulator = _mm256_add_epi64(accumulator, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(packed)));
+        return _mm256_add_epi64(accumulator, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(packed, 1)));
+    }
+}
+
+inline std::uint64_t CumulativeDepthAvx2(std::span<const Quantity> quantities, std::size_t levels) {
+    const std::size_t count = std::min(levels, quantities.size());
+    __m256i accumulator = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) accumulator = DepthKernelsDetail::AddQuantities(accumulator, quantities.data() + i);
+    std::uint64_t total = DepthKernelsDetail::HorizontalSum(accumulator);
+    for (; i < count; ++i) total += quantities[i];
+    return total;
+}
+
+// Skips whole blocks of eight levels while the running total stays short of the
+// threshold, then finds the exact level inside the block that reaches it.
+inline std::size_t FirstLevelReachingAvx2(std::span<const Quantity> quantities, std::uint64_t threshold,
+                                          std::uint64_t &before) {
+    std::uint64_t total = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= quantities.size(); i += 8) {
+        const std::uint64_t block = DepthKernelsDetail::HorizontalSum(
+            DepthKernelsDetail::AddQuantities(_mm256_setzero_si256(), quantities.data() + i));
+        if (total + block >= threshold) break;
+        total += block;
+    }
+    for (; i < quantities.size(); ++i) {
+        if (total + quantities[i] >= threshold) {
+            before = total;
+            return i;
+        }
+        total += quantities[i];
+    }
+    before = total;
+    return quantities.size();
+}
+
+// Signed 32-bit prices times unsigned 32-bit quantities, four lanes at a time. The
+// sign-extended price is split into its low and high halves so the product is exact
+// modulo 2^64 with the unsigned 32x32 multiply.
+inline std::int64_t NotionalAvx2(std::span<const Price> prices, std::span<const Quantity> quantities,
+                                 std::size_t levels) {
+    const std::size_t count = std::min({levels, prices.size(), quantities.size()});
+    __m256i accumulator = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i price = _mm256_cvtepi32_epi64(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(prices.data() + i)));
+        const __m256i quantity = _mm256_cvtepu32_epi64(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(quantities.data() + i)));
+        const __m256i low = _mm256_mul_epu32(price, quantity);
+        const __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(price, 32), quantity);
+        accumulator = _mm256_add_epi64(accumulator, _mm256_add_epi64(low, _mm256_slli_epi64(high, 32)));
+    }
+    std::int64_t notional = static_cast<std::int64_t>(DepthKernelsDetail::HorizontalSum(accumulator));
+    for (; i < count; ++i) {
+        notional += static_cast<std::int64_t>(prices[i]) * static_cast<std::int64_t>(quantities[i]);
+    }
+    return notional;
+}
+
+inline std::uint64_t CumulativeDepth(std::span<const Quantity> quantities, std::size_t levels) {
+    return CumulativeDepthAvx2(quantities, levels);
+}
+
+inline std::size_t FirstLevelReaching(std::span<const Quantity> quantities, std::uint64_t threshold,
+                                      std::uint64_t &before) {
+    return FirstLevelReachingAvx2(quantities, threshold, before);
+}
+
+inline std::int64_t Notional(std::span<const Price> prices, std::span<const Quantity> quantities, std::size_t levels) {
+    return NotionalAvx2(prices, quantities, levels);
+}
+
+#else
+
+inline std::uint64_t CumulativeDepth(std::span<const Quantity> quantities, std::size_t levels) {
+    return CumulativeDepthScalar(quantities, levels);
+}
+
+inline std::size_t FirstLevelReaching(std::span<const Quantity> quantities, std::uint64_t threshold,
+                                      std::uint64_t &before) {
+    return FirstLevelReachingScalar(quantities, threshold, before);
+}
+
+inline std::int64_t Notional(std::span<const Price> prices, std::span<const Quantity> quantities, std::size_t levels) {
+    return NotionalScalar(prices, quantities, levels);
+}
+
+#endif
+
+inline std::size_t FirstLevelReaching(std::span<const Quantity> quantities, std::uint64_t threshold) {
+    std::uint64_t before;
+    return FirstLevelReaching(quantities, threshold, before);
+}
+
+// What taking `size` from the side would cost: the level that completes it is
+// found first, then the notional of the whole levels ahead of it is one dot product.
+inline SweepCost CostToSweep(std::span<const Price> prices, std::span<const Quantity> quantities, std::uint64_t size) {
+    const std::size_t count = std::min(prices.size(), quantities.size());
+    quantities = quantities.first(count);
+    if (size == 0) return {};
+
+    std::uint64_t before = 0;
+    const std::size_t last = FirstLevelReaching(quantities, size, before);
+    SweepCost cost;
+    cost.notional = Notional(prices, quantities, last);
+    if (last == count) {
+        cost.filled = before;
+        cost.levels = count;
+        return cost;
+    }
+    cost.filled = size;
+    cost.notional += static_cast<std::int64_t>(prices[last]) * static_cast<std::int64_t>(size - before);
+    cost.levels = last + 1;
+    return cost;
+}
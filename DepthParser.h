@@ -0,0 +1,233 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ExchangeRules.h"
+#include "MarketDataFeed.h"
+#include "Types.h"
+
+// Converts a decimal string such as "187.2500" to a fixed-point integer with the
+// given number of decimals ("187.2500" at 2 decimals is 18725). Digits beyond the
+// scale are rounded half up, so "0.285" at 2 decimals is 29. Returns false on
+// anything that is not a plain non-negative decimal or does not fit in max.
+inline bool ParseFixedPoint(std::string_view text, int decimals, std::uint64_t max, std::uint64_t &value) {
+    std::uint64_t result = 0;
+    std::size_t i = 0;
+    bool anyDigit = false;
+    constexpr std::uint64_t Limit = std::numeric_limits<std::uint64_t>::max() / 10 - 9;
+
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+        if (result > Limit) return false;
+        result = result * 10 + static_cast<std::uint64_t>(text[i] - '0');
+        anyDigit = true;
+    }
+
+    int fractionDigits = 0;
+    bool roundUp = false;
+    if (i < text.size() && text[i] == '.') {
+        for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i) {
+            anyDigit = true;
+            if (fractionDigits < decimals) {
+                if (result > Limit) return false;
+                result = result * 10 + static_cast<std::uint64_t>(text[i] - '0');
+                ++fractionDigits;
+            } else if (fractionDigits == decimals) {
+                roundUp = text[i] >= '5';
+                ++fractionDigits; // look at the first dropped digit only
+            }
+        }
+    }
+    if (!anyDigit || i != text.size()) return false;
+
+    for (; fractionDigits < decimals; ++fractionDigits) {
+        if (result > Limit) return false;
+        result *= 10;
+    }
+    if (roundUp) ++result;
+    if (result > max) return false;
+    value = result;
+    return true;
+}
+
+class DepthParser {
+    // Single-pass scanner for exchange depth payloads (Binance REST snapshots and
+    // diff-depth stream events). It walks the JSON text in place: no DOM, no
+    // temporary strings, and prices and quantities go straight from their decimal
+    // text to fixed-point Price/Quantity at the scale set by ExchangeRules. Keys it
+    // does not use are skipped. Output vectors are cleared but keep their capacity,
+    // so a reused message parses without allocating once it has grown.
+    //
+    // Malformed input throws std::invalid_argument.
+public:
+    explicit DepthParser(const ExchangeRules &rules = {})
+        : priceDecimals_{rules.priceDecimals}
+          , quantityDecimals_{rules.quantityDecimals} {
+    }
+
+    // {"lastUpdateId":N,"bids":[["price","qty"],...],"asks":[...]}
+    void ParseSnapshot(std::string_view json, BookSnapshotMessage &snapshot) const {
+        snapshot.bids.clear();
+        snapshot.asks.clear();
+        snapshot.sequenceNumber = 0;
+        snapshot.timestamp = std::chrono::system_clock::now();
+
+        Scanner scanner{json};
+        ForEachKey(scanner, [&](std::string_view key) {
+            if (key == "lastUpdateId") snapshot.sequenceNumber = scanner.Unsigned();
+            else if (key == "bids") ParseLevels(scanner, snapshot.bids);
+            else if (key == "asks") ParseLevels(scanner, snapshot.asks);
+            else scanner.SkipValue();
+        });
+    }
+
+    // {"e":"depthUpdate","E":..,"s":"..","U":first,"u":last,"b":[...],"a":[...]}
+    void ParseDepthUpdate(std::string_view json, DepthUpdateMessage &update) const {
+        update.bids.clear();
+        update.asks.clear();
+        update.firstSequence = 0;
+        update.lastSequence = 0;
+        update.timestamp = std::chrono::system_clock::now();
+
+        Scanner scanner{json};
+        ForEachKey(scanner, [&](std::string_view key) {
+            if (key == "U") update.firstSequence = scanner.Unsigned();
+            else if (key == "u") update.lastSequence = scanner.Unsigned();
+            else if (key == "b") ParseLevels(scanner, update.bids);
+            else if (key == "a") ParseLevels(scanner, update.asks);
+            else scanner.SkipValue();
+        });
+    }
+
+    BookSnapshotMessage ParseSnapshot(std::string_view json) const {
+        BookSnapshotMessage snapshot;
+        ParseSnapshot(json, snapshot);
+        return snapshot;
+    }
+
+    DepthUpdateMessage ParseDepthUpdate(std::string_view json) const {
+        DepthUpdateMessage update;
+        ParseDepthUpdate(json, update);
+        return update;
+    }
+
+private:
+    int priceDecimals_;
+    int quantityDecimals_;
+
+    struct Scanner {
+        std::string_view text;
+        std::size_t pos = 0;
+
+        [[noreturn]] void Fail(const char *what) const {
+            throw std::invalid_argument(std::string("Malformed depth payload: ") + what +
+                                        " at offset " + std::to_string(pos));
+        }
+
+        void SkipSpace() {
+            while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+                                         text[pos] == '\r' || text[pos] == '\t')) {
+                ++pos;
+            }
+        }
+
+        char Peek() {
+            SkipSpace();
+            if (pos == text.size()) Fail("unexpected end");
+            return text[pos];
+        }
+
+        void Expect(char c) {
+            if (Peek() != c) Fail("unexpected character");
+            ++pos;
+        }
+
+        bool Consume(char c) {
+            if (Peek() != c) return false;
+            ++pos;
+            return true;
+        }
+
+        // Contents of a string without escape processing; depth payloads never
+        // escape anything in the fields that are read.
+        std::string_view String() {
+            Expect('"');
+            const std::size_t start = pos;
+            while (pos < text.size() && text[pos] != '"') {
+                if (text[pos] == '\\') ++pos;
+                ++pos;
+            }
+            if (pos >= text.size()) Fail("unterminated string");
+            return text.substr(start, pos++ - start);
+        }
+
+        std::uint64_t Unsigned() {
+            SkipSpace();
+            const std::size_t start = pos;
+            std::uint64_t value = 0;
+            while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+                value = value * 10 + static_cast<std::uint64_t>(text[pos++] - '0');
+            }
+            if (pos == start || pos - start > 19) Fail("expected an integer");
+            return value;
+        }
+
+        void SkipValue() {
+            const char c = Peek();
+            if (c == '"') {
+                String();
+            } else if (c == '{' || c == '[') {
+                int depth = 0;
+                do {
+                    const char d = Peek();
+                    if (d == '"') {
+                        String();
+                        continue;
+                    }
+                    if (d == '{' || d == '[') ++depth;
+                    else if (d == '}' || d == ']') --depth;
+                    ++pos;
+                } while (depth > 0);
+            } else {
+                while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']') ++pos;
+            }
+        }
+    };
+
+    template<typename OnKey>
+    static void ForEachKey(Scanner &scanner, OnKey &&onKey) {
+        scanner.Expect('{');
+        if (scanner.Consume('}')) return;
+        do {
+            std::string_view key = scanner.String();
+            scanner.Expect(':');
+            onKey(key);
+        } while (scanner.Consume(','));
+        scanner.Expect('}');
+    }
+
+    void ParseLevels(Scanner &scanner, std::vector<SnapshotLevel> &levels) const {
+        scanner.Expect('[');
+        if (scanner.Consume(']')) return;
+        do {
+            scanner.Expect('[');
+            std::uint64_t price = 0;
+            std::uint64_t quantity = 0;
+            if (!ParseFixedPoint(scanner.String(), priceDecimals_, std::numeric_limits<Price>::max(), price)) {
+                scanner.Fail("bad price");
+            }
+            scanner.Expect(',');
+            if (!ParseFixedPoint(scanner.String(), quantityDecimals_, std::numeric_limits<Quantity>::max(), quantity)) {
+                scanner.Fail("bad quantity");
+            }
+            scanner.Expect(']');
+            levels.push_back(SnapshotLevel{static_cast<Price>(price), static_cast<Quantity>(quantity), 1});
+        } while (scanner.Consume(','));
+        scanner.Expect(']');
+    }
+};
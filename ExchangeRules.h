@@ -9,6 +9,8 @@ struct ExchangeRules {
     Quantity minQuantity = 1; // min order size
     Quantity maxQuantity = 1000000; // max order size
     Price minNotional = 0; // min order value (price * quantity)
+    int priceDecimals = 2; // fixed-point scale of Price: feed prices are stored as price * 10^priceDecimals
+    int quantityDecimals = 2; // fixed-point scale of Quantity, likewise
 
     bool IsValidPrice(Price price) const {
         if (price <= 0) return false;
@@ -51,7 +53,8 @@ enum class RejectReason {
     BelowMinNotional,
     DuplicateOrderId,
     InvalidOrderType,
-    EmptyBook
+    EmptyBook,
+    PriceOutOfRange // outside the band a bounded book side can hold
 };
 
 // Structure to hold order validation result
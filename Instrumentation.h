@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "LatencyClock.h"
+#include "LatencyHistogram.h"
+
+// Instrumentation policies for BasicOrderbook. Every hook in the book is guarded by
+// `if constexpr` on these flags, so a disabled feature costs nothing at run time:
+//   CountMessages - MarketDataStats counters (messages, new orders, cancels, ...)
+//   TimeMessages  - per-message latency histograms in MarketDataStats
+//   TimePhases    - per-phase histograms (validate, level lookup, match, cancel)
+// Clock is the timing source for both kinds of timer.
+
+struct NoInstrumentation {
+    using Clock = SteadyClock;
+    static constexpr bool CountMessages = false;
+    static constexpr bool TimeMessages = false;
+    static constexpr bool TimePhases = false;
+};
+
+struct CountingInstrumentation {
+    using Clock = SteadyClock;
+    static constexpr bool CountMessages = true;
+    static constexpr bool TimeMessages = false;
+    static constexpr bool TimePhases = false;
+};
+
+// Counters plus one timer around each message: two clock reads per message. The
+// default for Orderbook.
+template<typename ClockT = SteadyClock>
+struct MessageInstrumentation {
+    using Clock = ClockT;
+    static constexpr bool CountMessages = true;
+    static constexpr bool TimeMessages = true;
+    static constexpr bool TimePhases = false;
+};
+
+// Adds the phase timers, several more clock reads per order; opt in when profiling.
+template<typename ClockT = SteadyClock>
+struct FullInstrumentation {
+    using Clock = ClockT;
+    static constexpr bool CountMessages = true;
+    static constexpr bool TimeMessages = true;
+    static constexpr bool TimePhases = true;
+};
+
+enum class Phase : std::uint8_t {
+    Validate,
+    LevelLookup,
+    Match,
+    Cancel
+};
+
+template<bool Enabled, typename Clock>
+class PhaseLatencies {
+    // One histogram per Phase. Time() returns a scope guard that records the time
+    // until it is destroyed, so early returns are still measured.
+public:
+    static constexpr std::size_t PhaseCount = static_cast<std::size_t>(Phase::Cancel) + 1;
+
+    class Scope {
+    public:
+        Scope(LatencyHistogram &histogram) : histogram_{histogram}, start_{Clock::Now()} {
+        }
+
+        ~Scope() { histogram_.Record(Clock::ToNanos(Clock::Now() - start_)); }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        LatencyHistogram &histogram_;
+        typename Clock::Ticks start_;
+    };
+
+    Scope Time(Phase phase) { return Scope{histograms_[static_cast<std::size_t>(phase)]}; }
+
+    const LatencyHistogram &Get(Phase phase) const { return histograms_[static_cast<std::size_t>(phase)]; }
+
+    void Reset() {
+        for (auto &histogram: histograms_) histogram.Reset();
+    }
+
+private:
+    std::array<LatencyHistogram, PhaseCount> histograms_{};
+};
+
+template<typename Clock>
+class PhaseLatencies<false, Clock> {
+    // Disabled: no storage, and Time() compiles to nothing.
+public:
+    struct Scope {
+    };
+
+    Scope Time(Phase) { return {}; }
+    void Reset() {}
+};
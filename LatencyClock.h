@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ORDERBOOK_HAS_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// Timing sources for latency measurement. A clock exposes
+//   static Ticks Now();                    raw, monotonic timestamp
+//   static std::uint64_t ToNanos(Ticks);   converts a difference of two Now() values
+// so the book can take two cheap readings per message and convert only once.
+
+struct SteadyClock {
+    using Ticks = std::int64_t;
+
+    static Ticks Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static std::uint64_t ToNanos(Ticks elapsed) { return elapsed > 0 ? static_cast<std::uint64_t>(elapsed) : 0; }
+};
+
+struct TscClock {
+    // Reads the CPU timestamp counter (rdtsc). Assumes an invariant TSC, as on any
+    // recent x86; the tick rate is calibrated once against steady_clock. Falls back
+    // to steady_clock on other architectures.
+    using Ticks = std::int64_t;
+
+    static Ticks Now() {
+#ifdef ORDERBOOK_HAS_TSC
+        return static_cast<Ticks>(__rdtsc());
+#else
+        return SteadyClock::Now();
+#endif
+    }
+
+    static std::uint64_t ToNanos(Ticks elapsed) {
+        if (elapsed <= 0) return 0;
+#ifdef ORDERBOOK_HAS_TSC
+        return static_cast<std::uint64_t>(static_cast<double>(elapsed) * NanosPerTick());
+#else
+        return static_cast<std::uint64_t>(elapsed);
+#endif
+    }
+
+    static double NanosPerTick() {
+        static const double nanosPerTick = Calibrate();
+        return nanosPerTick;
+    }
+
+private:
+    static double Calibrate() {
+#ifdef ORDERBOOK_HAS_TSC
+        const auto wallStart = std::chrono::steady_clock::now();
+        const Ticks tscStart = Now();
+        auto wallEnd = wallStart;
+        while (wallEnd - wallStart < std::chrono::milliseconds(10)) wallEnd = std::chrono::steady_clock::now();
+        const Ticks tscEnd = Now();
+        const auto wallNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(wallEnd - wallStart).count();
+        return tscEnd > tscStart ? static_cast<double>(wallNanos) / static_cast<double>(tscEnd - tscStart) : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+};
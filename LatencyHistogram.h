@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+class LatencyHistogram {
+    // Log-linear histogram of nanosecond latencies in the style of HdrHistogram.
+    // Every power-of-two range is split into 32 linear sub-buckets, so a recorded
+    // value is reported to within ~3% of its true value. Values below 32 ns are
+    // exact; anything at or above MaxTrackable lands in the last bucket, though the
+    // exact min and max are tracked separately. Fixed size, no allocation: recording
+    // is a bit scan and an increment, and merging adds bucket arrays.
+public:
+    static constexpr unsigned SubBucketBits = 5;
+    static constexpr std::uint64_t SubBucketCount = std::uint64_t{1} << SubBucketBits;
+    static constexpr unsigned MaxValueBits = 36; // ~68.7 s
+    static constexpr std::uint64_t MaxTrackable = (std::uint64_t{1} << MaxValueBits) - 1;
+    static constexpr std::size_t BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+    void Record(std::uint64_t nanos, std::uint64_t count = 1) {
+        if (count == 0) return;
+        buckets_[IndexOf(std::min(nanos, MaxTrackable))] += count;
+        count_ += count;
+        sum_ += nanos * count;
+        min_ = std::min(min_, nanos);
+        max_ = std::max(max_, nanos);
+    }
+
+    void Merge(const LatencyHistogram &other) {
+        for (std::size_t i = 0; i < BucketCount; ++i) buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void Reset() { *this = LatencyHistogram{}; }
+
+    std::uint64_t Count() const { return count_; }
+    std::uint64_t Min() const { return count_ ? min_ : 0; }
+    std::uint64_t Max() const { return max_; }
+    double Mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+    // Smallest bucket value at or above the given percentile (0-100), capped at Max().
+    std::uint64_t ValueAtPercentile(double percentile) const {
+        if (count_ == 0) return 0;
+        const double clamped = std::clamp(percentile, 0.0, 100.0);
+        std::uint64_t target = static_cast<std::uint64_t>(clamped / 100.0 * count_ + 0.5);
+        target = std::clamp<std::uint64_t>(target, 1, count_);
+
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < BucketCount; ++i) {
+            seen += buckets_[i];
+            if (seen >= target) return std::clamp(HighestInBucket(i), Min(), max_);
+        }
+        return max_;
+    }
+
+    std::uint64_t P50() const { return ValueAtPercentile(50.0); }
+    std::uint64_t P99() const { return ValueAtPercentile(99.0); }
+    std::uint64_t P999() const { return ValueAtPercentile(99.9); }
+
+    static std::size_t IndexOf(std::uint64_t value) {
+        if (value < SubBucketCount) return static_cast<std::size_t>(value);
+        const unsigned msb = static_cast<unsigned>(std::bit_width(value)) - 1;
+        const unsigned shift = msb - SubBucketBits;
+        return static_cast<std::size_t>((shift + 1) * SubBucketCount + ((value >> shift) - SubBucketCount));
+    }
+
+    static std::uint64_t LowestInBucket(std::size_t index) {
+        if (index < SubBucketCount) return index;
+        const std::uint64_t group = index / SubBucketCount; // >= 1
+        const std::uint64_t sub = index % SubBucketCount;
+        return (SubBucketCount + sub) << (group - 1);
+    }
+
+    static std::uint64_t HighestInBucket(std::size_t index) {
+        if (index < SubBucketCount) return index;
+        const std::uint64_t group = index / SubBucketCount;
+        return LowestInBucket(index) + (std::uint64_t{1} << (group - 1)) - 1;
+    }
+
+private:
+    std::array<std::uint64_t, BucketCount> buckets_{};
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t min_ = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max_ = 0;
+};
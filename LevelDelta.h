@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include "OrderType.h"
+#include "Types.h"
+
+// New state of one price level after an update to the book. quantity 0 means the
+// level is gone. Every delta of one update carries the same sequence; sequences
+// count updates that changed at least one level, from 1, with no gaps, so a
+// consumer that sees a jump knows it missed deltas and must rebuild from a full view.
+struct LevelDelta {
+    std::uint64_t sequence;
+    Price price;
+    Quantity quantity;          // new aggregate quantity at the price
+    std::uint32_t orderCount;
+    Side side;
+
+    bool IsRemoval() const { return quantity == 0; }
+};
+
+// Called on the book's thread once per update with that update's deltas, bids
+// first then asks, each in ascending price. The span is only valid during the call.
+using LevelDeltaSink = std::function<void(std::span<const LevelDelta>)>;
@@ -6,6 +6,7 @@
 struct LevelInfo {
     Price price_;
     Quantity quantity_;
+    std::uint32_t orderCount_ = 0;
 };
 
 using LevelInfos = std::vector<LevelInfo>;
@@ -1,12 +1,25 @@
 #include <iostream>
 #include <curl/curl.h>
-#include <nlohmann/json.hpp>
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
 #include <chrono>
 #include <iomanip>
 #include <ctime>
 #include <sstream>
+#include <span>
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <map>
+#include <vector>
 #include "OrderBook.h"
+#include "OrderbookManager.h"
+#include "SpscQueue.h"
+#include "Capture.h"
+#include "DepthFeedHandler.h"
+#include "DepthParser.h"
 
 // Callback function for libcurl to write response data
 size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *userp) {
@@ -15,63 +28,250 @@ size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *use
     return totalSize;
 }
 
+std::string BinanceDepthUrl(const std::string &symbol, int limit) {
+    return "https://api.binance.com/api/v3/depth?symbol=" + symbol + "&limit=" + std::to_string(limit);
+}
+
+// Options shared by every REST handle. Keep-alive holds the connection open between
+// polls; libcurl caches the TLS session on the handle, so a reconnect resumes it.
+void ConfigureRestHandle(CURL *curl, std::string *body) {
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, body);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // whatever compression libcurl supports
+}
+
+// Blocking GET over one easy handle kept for the client's lifetime, so only the first
+// request pays for the TCP and TLS handshakes. Use from one thread at a time.
+class HttpClient {
+public:
+    HttpClient() : curl_(curl_easy_init()) {
+        if (curl_) ConfigureRestHandle(curl_, &body_);
+    }
+
+    ~HttpClient() {
+        if (curl_) curl_easy_cleanup(curl_);
+    }
+
+    HttpClient(const HttpClient &) = delete;
+    HttpClient &operator=(const HttpClient &) = delete;
+
+    // Returns the response body, or an empty string on failure.
+    std::string Get(const std::string &url) {
+        body_.clear();
+        if (!curl_) return body_;
+        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+        CURLcode res = curl_easy_perform(curl_);
+        long status = 0;
+        curl_easy_getinfo(curl_, CURLINFO_RESPONSE_CODE, &status);
+        if (res != CURLE_OK || status != 200) {
+            std::cerr << "GET " << url << " failed: "
+                    << (res != CURLE_OK ? curl_easy_strerror(res) : ("HTTP " + std::to_string(status)).c_str())
+                    << std::endl;
+            body_.clear();
+        }
+        return std::move(body_);
+    }
+
+private:
+    CURL *curl_;
+    std::string body_;
+};
+
 // Fetch orderbook snapshot from Binance REST API
-std::string FetchBinanceOrderbook(const std::string &symbol, int limit = 20) {
-    CURL *curl;
-    CURLcode res;
-    std::string readBuffer;
+std::string FetchBinanceOrderbook(HttpClient &client, const std::string &symbol, int limit = 20) {
+    return client.Get(BinanceDepthUrl(symbol, limit));
+}
+
+class DepthPoller {
+    // Polls the REST depth endpoint for many symbols concurrently on a fixed cadence.
+    // Every symbol keeps its own easy handle, and so its connection and TLS session,
+    // for the poller's lifetime; one multi handle drives them all from the thread
+    // that calls Run. A round starts at start + k * interval however long the last
+    // one took, and a symbol whose previous request is still in flight sits that
+    // round out. Bodies go to onResponse on the polling thread, which should only
+    // hand them on: parsing belongs elsewhere.
+public:
+    using OnResponse = std::function<void(std::size_t symbolIndex, std::string body)>;
+
+    DepthPoller(const std::vector<std::string> &symbols, int limit, std::chrono::milliseconds interval,
+                OnResponse onResponse)
+        : multi_(curl_multi_init())
+          , interval_(interval)
+          , onResponse_(std::move(onResponse)) {
+        for (const auto &symbol: symbols) {
+            auto request = std::make_unique<Request>();
+            request->url = BinanceDepthUrl(symbol, limit);
+            request->curl = curl_easy_init();
+            if (request->curl) {
+                ConfigureRestHandle(request->curl, &request->body);
+                curl_easy_setopt(request->curl, CURLOPT_URL, request->url.c_str());
+                curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request.get());
+            }
+            request->index = requests_.size();
+            requests_.push_back(std::move(request));
+        }
+    }
 
-    curl = curl_easy_init();
-    if (curl) {
-        std::string url = "https://api.binance.com/api/v3/depth?symbol=" + symbol + "&limit=" + std::to_string(limit);
+    ~DepthPoller() {
+        for (auto &request: requests_) {
+            if (request->inFlight) curl_multi_remove_handle(multi_, request->curl);
+            if (request->curl) curl_easy_cleanup(request->curl);
+        }
+        if (multi_) curl_multi_cleanup(multi_);
+    }
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    DepthPoller(const DepthPoller &) = delete;
+    DepthPoller &operator=(const DepthPoller &) = delete;
+
+    // Polls until running turns false, checking it at least every MaxWaitMs.
+    void Run(const std::atomic<bool> &running) {
+        if (!multi_) return;
+        auto nextRound = std::chrono::steady_clock::now();
+        while (running.load()) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= nextRound) {
+                StartRound();
+                while (nextRound <= now) nextRound += interval_;
+            }
 
-        res = curl_easy_perform(curl);
+            int active = 0;
+            curl_multi_perform(multi_, &active);
+            CollectFinished();
 
-        if (res != CURLE_OK) {
-            std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
+            const auto untilNextRound = std::chrono::duration_cast<std::chrono::milliseconds>(
+                nextRound - std::chrono::steady_clock::now());
+            const int waitMs = static_cast<int>(std::clamp<std::int64_t>(untilNextRound.count(), 0, MaxWaitMs));
+            curl_multi_poll(multi_, nullptr, 0, waitMs, nullptr);
         }
+    }
 
-        curl_easy_cleanup(curl);
+private:
+    static constexpr std::int64_t MaxWaitMs = 100;
+
+    struct Request {
+        std::string url;
+        CURL *curl = nullptr;
+        std::string body;
+        std::size_t index = 0;
+        bool inFlight = false;
+    };
+
+    CURLM *multi_;
+    std::chrono::milliseconds interval_;
+    OnResponse onResponse_;
+    std::vector<std::unique_ptr<Request> > requests_;
+
+    void StartRound() {
+        for (auto &request: requests_) {
+            if (!request->curl || request->inFlight) continue;
+            request->body.clear();
+            if (curl_multi_add_handle(multi_, request->curl) == CURLM_OK) request->inFlight = true;
+        }
     }
 
-    return readBuffer;
-}
+    void CollectFinished() {
+        int queued = 0;
+        while (CURLMsg *message = curl_multi_info_read(multi_, &queued)) {
+            if (message->msg != CURLMSG_DONE) continue;
+            Request *request = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &request);
+            const CURLcode res = message->data.result;
+            curl_multi_remove_handle(multi_, message->easy_handle);
+            if (!request) continue;
+            request->inFlight = false;
+
+            long status = 0;
+            curl_easy_getinfo(request->curl, CURLINFO_RESPONSE_CODE, &status);
+            if (res == CURLE_OK && status == 200) {
+                onResponse_(request->index, std::move(request->body));
+            } else {
+                std::cerr << "GET " << request->url << " failed: "
+                        << (res != CURLE_OK ? curl_easy_strerror(res) : ("HTTP " + std::to_string(status)).c_str())
+                        << std::endl;
+            }
+        }
+    }
+};
+
+// Binance quotes prices and quantities with up to 8 decimals; the book keeps 2.
+const DepthParser binanceParser{ExchangeRules{}};
 
 // Convert Binance JSON response to BookSnapshotMessage
 BookSnapshotMessage ParseBinanceSnapshot(const std::string &jsonStr) {
-    auto json = nlohmann::json::parse(jsonStr);
+    return binanceParser.ParseSnapshot(jsonStr);
+}
 
-    BookSnapshotMessage snapshot;
-    snapshot.timestamp = std::chrono::system_clock::now();
-    snapshot.sequenceNumber = json["lastUpdateId"];
+// Convert a Binance diff-depth event to DepthUpdateMessage. Quantities are absolute
+// per level, 0 meaning the level is gone.
+DepthUpdateMessage ParseBinanceDepthUpdate(const std::string &jsonStr) {
+    return binanceParser.ParseDepthUpdate(jsonStr);
+}
 
-    // Parse bids (buy orders)
-    for (const auto &bid: json["bids"]) {
-        SnapshotLevel level;
-        level.price = static_cast<Price>(std::stod(bid[0].get<std::string>()) * 100); // Convert to cents
-        level.quantity = static_cast<Quantity>(std::stod(bid[1].get<std::string>()) * 100); // Convert to smallest unit
-        level.orderCount = 1; // Binance doesn't provide this
-        snapshot.bids.push_back(level);
+// Binance diff-depth WebSocket stream over libcurl's WebSocket support. libcurl
+// answers pings itself; Receive() reassembles frames into whole text messages.
+class BinanceDepthStream {
+public:
+    ~BinanceDepthStream() {
+        if (curl_) curl_easy_cleanup(curl_);
     }
 
-    // Parse asks (sell orders)
-    for (const auto &ask: json["asks"]) {
-        SnapshotLevel level;
-        level.price = static_cast<Price>(std::stod(ask[0].get<std::string>()) * 100);
-        level.quantity = static_cast<Quantity>(std::stod(ask[1].get<std::string>()) * 100);
-        level.orderCount = 1;
-        snapshot.asks.push_back(level);
+    bool Connect(const std::string &symbol) {
+        std::string stream = symbol;
+        std::transform(stream.begin(), stream.end(), stream.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        const std::string url = "wss://stream.binance.com:9443/ws/" + stream + "@depth@100ms";
+
+        curl_ = curl_easy_init();
+        if (!curl_) return false;
+        curl_easy_setopt(curl_, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl_, CURLOPT_CONNECT_ONLY, 2L); // WebSocket mode
+        curl_easy_setopt(curl_, CURLOPT_TIMEOUT, 10L);
+
+        CURLcode res = curl_easy_perform(curl_);
+        if (res != CURLE_OK) {
+            std::cerr << "WebSocket connect failed: " << curl_easy_strerror(res) << std::endl;
+            curl_easy_cleanup(curl_);
+            curl_ = nullptr;
+            return false;
+        }
+        return true;
     }
 
-    return snapshot;
-}
+    // Blocks until one complete text message arrives. Returns false when the
+    // connection closes or fails, or when running turns false.
+    bool Receive(std::string &message, const std::atomic<bool> &running) {
+        message.clear();
+        char buffer[16384];
+        while (running.load()) {
+            size_t received = 0;
+            const struct curl_ws_frame *meta = nullptr;
+            CURLcode res = curl_ws_recv(curl_, buffer, sizeof(buffer), &received, &meta);
+            if (res == CURLE_AGAIN) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            if (res != CURLE_OK || !meta) {
+                std::cerr << "WebSocket receive failed: " << curl_easy_strerror(res) << std::endl;
+                return false;
+            }
+            if (meta->flags & CURLWS_CLOSE) return false;
+            if (!(meta->flags & (CURLWS_TEXT | CURLWS_CONT))) continue; // ping, pong, binary
+
+            message.append(buffer, received);
+            if (meta->bytesleft == 0 && !(meta->flags & CURLWS_CONT)) return true;
+        }
+        return false;
+    }
+
+private:
+    CURL *curl_ = nullptr;
+};
 
 // Format timestamp for display
 std::string FormatTimestamp(const std::chrono::system_clock::time_point &tp) {
@@ -81,10 +281,64 @@ std::string FormatTimestamp(const std::chrono::system_clock::time_point &tp) {
     return ss.str();
 }
 
-void PrintOrderbook(const Orderbook &orderbook, const std::string &symbol, int levels = 10) {
-    auto infos = orderbook.GetOrderInfos();
-    const auto &bids = infos.GetBids();
-    const auto &asks = infos.GetAsks();
+// What the matching thread hands the render loop: the level deltas the book emitted
+// since the last refresh, plus the latest counters.
+struct BookUpdates {
+    std::vector<LevelDelta> deltas;
+    std::size_t orderCount = 0;
+    MarketDataStats stats;
+    bool ready = false;
+};
+
+// What the render loop shows. It keeps its own L2 mirror built from deltas alone, so
+// the matching thread only ever passes on the levels that changed; the buffers are
+// allocated once and their size sets how many levels are shown.
+struct BookView {
+    LevelInfos bids;
+    LevelInfos asks;
+    std::size_t bidCount = 0;
+    std::size_t askCount = 0;
+    std::size_t orderCount = 0;
+    std::size_t changedLevels = 0; // deltas applied at the last refresh
+    MarketDataStats stats;
+    PipelineStats pipeline;
+    bool ready = false;
+
+    explicit BookView(int levels) : bids(levels), asks(levels) {
+    }
+
+    void Apply(std::span<const LevelDelta> deltas) {
+        for (const LevelDelta &delta: deltas) {
+            if (delta.side == Side::Buy) Apply(bidLevels_, delta);
+            else                         Apply(askLevels_, delta);
+        }
+        changedLevels = deltas.size();
+        bidCount = CopyTop(bidLevels_, bids);
+        askCount = CopyTop(askLevels_, asks);
+    }
+
+private:
+    std::map<Price, LevelInfo, std::greater<Price> > bidLevels_;
+    std::map<Price, LevelInfo> askLevels_;
+
+    template<typename Levels>
+    static void Apply(Levels &levels, const LevelDelta &delta) {
+        if (delta.IsRemoval()) levels.erase(delta.price);
+        else                   levels[delta.price] = LevelInfo{delta.price, delta.quantity, delta.orderCount};
+    }
+
+    template<typename Levels>
+    static std::size_t CopyTop(const Levels &levels, LevelInfos &out) {
+        std::size_t count = 0;
+        for (auto it = levels.begin(); it != levels.end() && count < out.size(); ++it) out[count++] = it->second;
+        return count;
+    }
+};
+
+void PrintOrderbook(const BookView &view, const std::string &symbol) {
+    const int levels = static_cast<int>(view.bids.size());
+    std::span<const LevelInfo> bids(view.bids.data(), view.bidCount);
+    std::span<const LevelInfo> asks(view.asks.data(), view.askCount);
 
     // Clear screen
 #ifdef _WIN32
@@ -149,91 +403,286 @@ void PrintOrderbook(const Orderbook &orderbook, const std::string &symbol, int l
         std::cout << "Mid Price: $" << std::setprecision(2) << midPrice << "\n";
     }
 
-    std::cout << "\nOrderbook Size: " << orderbook.Size() << " orders\n";
+    std::cout << "\nOrderbook Size: " << view.orderCount << " orders\n";
 
     // Display market data stats
-    const auto &stats = orderbook.GetMarketDataStats();
+    const auto &stats = view.stats;
     std::cout << "Messages Processed: " << stats.messagesProcessed << "\n";
     std::cout << "Average Latency: " << std::fixed << std::setprecision(3)
             << stats.GetAverageLatencyMicros() << " μs\n";
+    const auto &snapshotLatency = stats.GetLatency(MessageType::BookSnapshot);
+    std::cout << "Snapshot Latency: p50 " << snapshotLatency.P50() << " ns, p99 " << snapshotLatency.P99()
+            << " ns, max " << snapshotLatency.Max() << " ns\n";
+    std::cout << "Level Deltas: " << view.changedLevels << " since last refresh\n";
+    std::cout << "Queue Depth: " << view.pipeline.depth << " (max " << view.pipeline.maxDepth
+            << "), Dropped: " << view.pipeline.dropped << "\n";
 
     std::cout << "========================================\n";
     std::cout << "\nPress Ctrl+C to exit...\n";
 }
 
+// Best bid and ask of every polled symbol, under the primary symbol's ladder.
+void PrintSymbolSummary(const std::vector<std::string> &symbols, const std::vector<BookView> &views) {
+    std::cout << "\n" << std::left << std::setw(12) << "SYMBOL" << std::right << std::setw(12) << "BID"
+            << std::setw(12) << "ASK" << std::setw(10) << "SPREAD" << "\n";
+    for (std::size_t i = 0; i < symbols.size(); ++i) {
+        const BookView &view = views[i];
+        std::cout << std::left << std::setw(12) << symbols[i] << std::right;
+        if (view.bidCount == 0 || view.askCount == 0) {
+            std::cout << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(10) << "-" << "\n";
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(2) << std::setw(12) << view.bids[0].price_ / 100.0
+                << std::setw(12) << view.asks[0].price_ / 100.0
+                << std::setw(10) << (view.asks[0].price_ - view.bids[0].price_) / 100.0 << "\n";
+    }
+}
+
+std::vector<std::string> SplitSymbols(const std::string &list) {
+    std::vector<std::string> symbols;
+    std::stringstream in(list);
+    for (std::string symbol; std::getline(in, symbol, ',');) {
+        if (!symbol.empty() && std::find(symbols.begin(), symbols.end(), symbol) == symbols.end()) {
+            symbols.push_back(symbol);
+        }
+    }
+    return symbols;
+}
+
+// What one symbol's shard hands the render loop. The book itself lives in the
+// OrderbookManager; this collects its deltas and counters as the shard applies them.
+struct SymbolFeed {
+    SymbolId id = 0;
+    std::mutex mutex;
+    BookUpdates updates;
+
+    SymbolFeed(OrderbookManager &manager, const std::string &symbol) : id{manager.AddSymbol(symbol)} {
+        manager.GetBook(id).SetLevelDeltaSink([this](std::span<const LevelDelta> deltas) {
+            std::lock_guard lock(mutex);
+            updates.deltas.insert(updates.deltas.end(), deltas.begin(), deltas.end());
+        });
+    }
+
+    void OnApplied(const Orderbook &applied) {
+        std::lock_guard lock(mutex);
+        updates.orderCount = applied.Size();
+        updates.stats = applied.GetMarketDataStats();
+        updates.ready = true;
+    }
+};
+
+// The books run on a fixed set of matching threads, at most one per spare core,
+// however many symbols are polled. Shards are not pinned since they share the
+// machine with the network, parse and render threads, and an idle shard sleeps
+// between polls: REST snapshots arrive about once a second, so spinning on an
+// empty ring would only burn a core per shard.
+std::size_t LiveShardCount(std::size_t symbolCount) {
+    const std::size_t spareCores = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    return std::min(symbolCount, spareCores);
+}
+
+// A REST body on its way from the polling thread to the parse thread.
+struct PolledResponse {
+    std::size_t symbolIndex = 0;
+    std::string body;
+};
+
 int main(int argc, char *argv[]) {
     // Initialize curl
     curl_global_init(CURL_GLOBAL_DEFAULT);
 
-    // Default to SOL/USDT, but allow command line override
-    std::string symbol = "SOLUSDT";
+    // Default to SOL/USDT, but allow command line override. A comma-separated list
+    // polls every symbol over REST; the first one gets the full ladder.
+    std::vector<std::string> symbols{"SOLUSDT"};
     int refreshInterval = 1; // seconds
     int displayLevels = 50;
 
     if (argc > 1) {
-        symbol = argv[1];
+        symbols = SplitSymbols(argv[1]);
+        if (symbols.empty()) symbols = {"SOLUSDT"};
     }
     if (argc > 2) {
-        refreshInterval = std::stoi(argv[2]);
+        refreshInterval = std::max(1, std::stoi(argv[2]));
     }
     if (argc > 3) {
         displayLevels = std::stoi(argv[3]);
     }
+    std::string capturePath; // optional: record every snapshot for later replay
+    if (argc > 4) {
+        capturePath = argv[4];
+    }
+    const std::string &symbol = symbols.front();
+    const bool multiSymbol = symbols.size() > 1;
 
     std::cout << "========================================\n";
     std::cout << "  Binance Live Market Data Feed\n";
     std::cout << "========================================\n";
-    std::cout << "Symbol: " << symbol << "\n";
-    std::cout << "Refresh Interval: " << refreshInterval << " seconds\n";
+    std::cout << "Symbol" << (multiSymbol ? "s: " : ": ");
+    for (std::size_t i = 0; i < symbols.size(); ++i) std::cout << (i ? "," : "") << symbols[i];
+    std::cout << "\n";
+    std::cout << "Refresh Interval: " << refreshInterval << " seconds (display, and REST polling)\n";
     std::cout << "Display Levels: " << displayLevels << "\n";
+    if (!capturePath.empty()) {
+        std::cout << "Recording To: " << capturePath << " (" << symbol << ")\n";
+    }
     std::cout << "\nConnecting to Binance API...\n\n";
-    std::cout << "Usage: ./LiveMarketData [SYMBOL] [REFRESH_SECONDS] [LEVELS]\n";
+    std::cout << "Usage: ./LiveMarketData [SYMBOL[,SYMBOL...]] [REFRESH_SECONDS] [LEVELS] [CAPTURE_FILE]\n";
     std::cout << "Example: ./LiveMarketData ETHUSDT 1 15\n\n";
 
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
-    Orderbook orderbook;
-
-    try {
-        // Main loop, fetch and display orderbook
-        while (true) {
-            // Fetch snapshot from Binance
-            std::string jsonResponse = FetchBinanceOrderbook(symbol, displayLevels);
+    OrderbookManager manager(LiveShardCount(symbols.size()), 1024);
+    std::vector<std::unique_ptr<SymbolFeed> > feeds;
+    for (const std::string &name: symbols) feeds.push_back(std::make_unique<SymbolFeed>(manager, name));
+    manager.SetOnApplied([&feeds](SymbolId id, const Orderbook &applied, const MarketDataMessage &) {
+        feeds[id]->OnApplied(applied);
+    });
+    manager.SetIdleSleep(std::chrono::milliseconds(1));
+    manager.Start(false);
+    const SymbolId primary = feeds.front()->id;
+
+    std::unique_ptr<CaptureWriter> recorder;
+    if (!capturePath.empty()) {
+        std::string sessionDate = FormatTimestamp(std::chrono::system_clock::now()).substr(0, 10);
+        recorder = std::make_unique<CaptureWriter>(capturePath, symbol, sessionDate);
+    }
 
-            if (jsonResponse.empty()) {
-                std::cerr << "Failed to fetch orderbook data\n";
-                std::this_thread::sleep_for(std::chrono::seconds(refreshInterval));
+    // Parse thread: REST bodies from the poller become snapshots routed to each symbol's shard,
+    // so the polling thread never waits on JSON and keeps its cadence.
+    std::atomic<bool> running{true};
+    std::atomic<bool> streaming{false};
+    SpscQueue<PolledResponse> responses(256);
+    std::thread parseThread([&] {
+        PolledResponse response;
+        while (running.load() || !responses.Empty()) {
+            if (!responses.TryPop(response)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
                 continue;
             }
-
-            // Parse and process
             try {
-                BookSnapshotMessage snapshot = ParseBinanceSnapshot(jsonResponse);
-
-                if (orderbook.ProcessMarketData(snapshot)) {
-                    // Display the orderbook
-                    PrintOrderbook(orderbook, symbol, displayLevels);
-                } else {
-                    std::cerr << "Failed to process market data\n";
+                BookSnapshotMessage snapshot = ParseBinanceSnapshot(response.body);
+                if (recorder && response.symbolIndex == 0) {
+                    recorder->Write(MarketDataMessage{snapshot});
+                    recorder->Flush();
+                }
+                if (!manager.Route(feeds[response.symbolIndex]->id, std::move(snapshot))) {
+                    std::cerr << "Ingestion queue full, snapshot dropped\n";
                 }
-            } catch (const nlohmann::json::exception &e) {
+            } catch (const std::invalid_argument &e) {
                 std::cerr << "JSON parsing error: " << e.what() << "\n";
-                std::cerr << "Response: " << jsonResponse.substr(0, 200) << "...\n";
+                std::cerr << "Response: " << response.body.substr(0, 200) << "...\n";
             } catch (const std::exception &e) {
                 std::cerr << "Error processing data: " << e.what() << "\n";
             }
+        }
+    });
+
+    // Feed handler thread: network I/O only. A single symbol prefers the diff-depth
+    // stream; one deep REST snapshot seeds it and is fetched again only after a
+    // sequence gap. Several symbols, or a stream that closes, are polled over REST.
+    DepthFeedHandler depthHandler(
+        [&, client = std::make_shared<HttpClient>()]() -> std::optional<BookSnapshotMessage> {
+            std::string jsonResponse = FetchBinanceOrderbook(*client, symbol, 1000);
+            if (jsonResponse.empty()) return std::nullopt;
+            try {
+                BookSnapshotMessage snapshot = ParseBinanceSnapshot(jsonResponse);
+                if (recorder) recorder->Write(MarketDataMessage{snapshot});
+                return snapshot;
+            } catch (const std::exception &e) {
+                std::cerr << "Snapshot error: " << e.what() << "\n";
+                return std::nullopt;
+            }
+        },
+        [&](MarketDataMessage message) { return manager.Route(primary, std::move(message)); });
+
+    std::thread feedThread([&] {
+        if (!multiSymbol) {
+            BinanceDepthStream stream;
+            if (stream.Connect(symbol)) {
+                streaming = true;
+                std::string text;
+                auto lastFlush = std::chrono::steady_clock::now();
+                while (stream.Receive(text, running)) {
+                    try {
+                        DepthUpdateMessage update = ParseBinanceDepthUpdate(text);
+                        if (recorder) {
+                            recorder->Write(MarketDataMessage{update});
+                            if (std::chrono::steady_clock::now() - lastFlush >= std::chrono::seconds(refreshInterval)) {
+                                recorder->Flush();
+                                lastFlush = std::chrono::steady_clock::now();
+                            }
+                        }
+                        depthHandler.OnDepthUpdate(std::move(update));
+                    } catch (const std::exception &e) {
+                        std::cerr << "Error processing depth update: " << e.what() << "\n";
+                    }
+                }
+                streaming = false;
+                if (recorder) recorder->Flush();
+                if (!running.load()) return;
+                std::cerr << "Depth stream closed, falling back to REST polling\n";
+            }
+        }
+
+        DepthPoller poller(symbols, displayLevels, std::chrono::seconds(refreshInterval),
+                           [&](std::size_t symbolIndex, std::string body) {
+                               if (!responses.TryPush(PolledResponse{symbolIndex, std::move(body)})) {
+                                   std::cerr << "Parse queue full, response dropped\n";
+                               }
+                           });
+        poller.Run(running);
+    });
+
+    auto shutdown = [&] {
+        running = false;
+        feedThread.join();
+        parseThread.join();
+        manager.Stop();
+    };
 
-            // Wait before next update
-            std::this_thread::sleep_for(std::chrono::seconds(refreshInterval));
+    try {
+        // Render loop on a fixed cadence, display whatever the matching threads last applied
+        std::vector<BookView> views;
+        for (std::size_t i = 0; i < symbols.size(); ++i) views.emplace_back(i == 0 ? displayLevels : 1);
+        std::vector<LevelDelta> received;
+        auto nextFrame = std::chrono::steady_clock::now();
+        while (true) {
+            for (std::size_t i = 0; i < feeds.size(); ++i) {
+                SymbolFeed &feed = *feeds[i];
+                BookView &view = views[i];
+                {
+                    std::lock_guard lock(feed.mutex);
+                    received.swap(feed.updates.deltas);
+                    view.orderCount = feed.updates.orderCount;
+                    view.stats = feed.updates.stats;
+                    view.ready = feed.updates.ready;
+                }
+                view.Apply(received);
+                received.clear();
+                view.pipeline = manager.GetShardStats(manager.ShardOf(feed.id));
+            }
+            BookView &view = views.front();
+            if (view.ready) {
+                PrintOrderbook(view, symbol);
+                std::cout << "Feed: " << (streaming.load() ? "diff-depth stream" : "REST polling")
+                        << ", Sequence Gaps: " << view.stats.sequenceGaps << "\n";
+                if (multiSymbol) PrintSymbolSummary(symbols, views);
+            }
+
+            nextFrame += std::chrono::seconds(refreshInterval);
+            std::this_thread::sleep_until(nextFrame);
         }
     } catch (const std::exception &e) {
         std::cerr << "Fatal error: " << e.what() << "\n";
+        shutdown();
         curl_global_cleanup();
         return 1;
     }
 
+    shutdown();
+
     // Cleanup
     curl_global_cleanup();
 
     return 0;
-}
\ No newline at end of file
+}
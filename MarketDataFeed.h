@@ -1,17 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <variant>
 #include <string>
 #include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include <array>
 #include "Types.h"
 #include "OrderType.h"
+#include "LatencyHistogram.h"
 
 enum class MessageType {
     NewOrder,
     CancelOrder,
     ModifyOrder,
     Trade,
-    BookSnapshot
+    BookSnapshot,
+    DepthUpdate
 };
 
 struct NewOrderMessage {
@@ -62,44 +71,330 @@ struct BookSnapshotMessage {
     uint64_t sequenceNumber; // To detect gaps in feed
 };
 
+// Aggregated depth delta covering feed sequence numbers [firstSequence, lastSequence].
+// Each level carries the new absolute quantity at its price; 0 removes the level.
+struct DepthUpdateMessage {
+    MessageType type = MessageType::DepthUpdate;
+    std::vector<SnapshotLevel> bids;
+    std::vector<SnapshotLevel> asks;
+    std::chrono::system_clock::time_point timestamp;
+    uint64_t firstSequence;
+    uint64_t lastSequence;
+};
+
 // Variant type that can hold any market data message
 using MarketDataMessage = std::variant<
     NewOrderMessage,
     CancelOrderMessage,
     ModifyOrderMessage,
     TradeMessage,
-    BookSnapshotMessage
+    BookSnapshotMessage,
+    DepthUpdateMessage
 >;
 
+// Alternatives are declared in MessageType order.
+inline MessageType GetMessageType(const MarketDataMessage &message) {
+    return static_cast<MessageType>(message.index());
+}
+
+// Compact wire encoding of the incremental message types. Fixed-size and trivially
+// copyable, so a stream of events can be memcpy'd, memory-mapped or placed in a
+// shared-memory queue as-is. Snapshots and depth updates have no single-record
+// form; when they have to travel in-stream (e.g. in a capture file) they are spelled
+// out as a run of records: a Begin record, one Level record per level, an End record.
+enum class EventKind : std::uint8_t {
+    NewOrder,
+    CancelOrder,
+    ModifyOrder,
+    Trade,
+    SnapshotBegin, // orderId = sequence number; starts a snapshot run
+    SnapshotLevel, // side, price, quantity; otherOrderId = order count. Rests as the level's one synthetic order
+    SnapshotEnd,   // orderId = sequence number; levels the run did not list are removed
+    DepthBegin,    // orderId = first sequence, otherOrderId = last sequence
+    DepthLevel,    // side, price, new absolute quantity
+    DepthEnd       // orderId = first sequence, otherOrderId = last sequence
+};
+
+struct MarketDataEvent {
+    std::int64_t timestampNs; // system_clock nanoseconds since epoch
+    OrderId orderId;          // buy order for trades
+    OrderId otherOrderId;     // sell order for trades, unused otherwise
+    Price price;              // new price for modifies
+    Quantity quantity;        // new quantity for modifies
+    EventKind kind;
+    std::uint8_t side;        // Side
+    std::uint8_t orderType;   // OrderType, new orders only
+
+    Side GetSide() const { return static_cast<Side>(side); }
+    OrderType GetOrderType() const { return static_cast<OrderType>(orderType); }
+    std::chrono::system_clock::time_point GetTimestamp() const {
+        return std::chrono::system_clock::time_point{
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds{timestampNs})
+        };
+    }
+
+    static std::int64_t ToNanos(std::chrono::system_clock::time_point timestamp) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+    }
+
+    static MarketDataEvent NewOrder(OrderId orderId, Side side, Price price, Quantity quantity,
+                                    OrderType orderType, std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, orderId, 0, price, quantity, EventKind::NewOrder,
+                               static_cast<std::uint8_t>(side), static_cast<std::uint8_t>(orderType)};
+    }
+
+    static MarketDataEvent Cancel(OrderId orderId, std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, orderId, 0, 0, 0, EventKind::CancelOrder, 0, 0};
+    }
+
+    static MarketDataEvent Modify(OrderId orderId, Side side, Price newPrice, Quantity newQuantity,
+                                  std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, orderId, 0, newPrice, newQuantity, EventKind::ModifyOrder,
+                               static_cast<std::uint8_t>(side), 0};
+    }
+
+    static MarketDataEvent Trade(OrderId buyOrderId, OrderId sellOrderId, Price price, Quantity quantity,
+                                 std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, buyOrderId, sellOrderId, price, quantity, EventKind::Trade, 0, 0};
+    }
+
+    static MarketDataEvent SnapshotBegin(std::uint64_t sequenceNumber, std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, sequenceNumber, 0, 0, 0, EventKind::SnapshotBegin, 0, 0};
+    }
+
+    static MarketDataEvent SnapshotLevel(Side side, Price price, Quantity quantity, std::uint32_t orderCount,
+                                         std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, 0, orderCount, price, quantity, EventKind::SnapshotLevel,
+                               static_cast<std::uint8_t>(side), 0};
+    }
+
+    static MarketDataEvent SnapshotEnd(std::uint64_t sequenceNumber, std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, sequenceNumber, 0, 0, 0, EventKind::SnapshotEnd, 0, 0};
+    }
+
+    static MarketDataEvent DepthBegin(std::uint64_t firstSequence, std::uint64_t lastSequence,
+                                      std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, firstSequence, lastSequence, 0, 0, EventKind::DepthBegin, 0, 0};
+    }
+
+    static MarketDataEvent DepthLevel(Side side, Price price, Quantity quantity, std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, 0, 0, price, quantity, EventKind::DepthLevel,
+                               static_cast<std::uint8_t>(side), 0};
+    }
+
+    static MarketDataEvent DepthEnd(std::uint64_t firstSequence, std::uint64_t lastSequence,
+                                    std::int64_t timestampNs = 0) {
+        return MarketDataEvent{timestampNs, firstSequence, lastSequence, 0, 0, EventKind::DepthEnd, 0, 0};
+    }
+
+    bool IsSnapshotRecord() const {
+        return kind == EventKind::SnapshotBegin || kind == EventKind::SnapshotLevel || kind == EventKind::SnapshotEnd;
+    }
+
+    bool IsDepthRecord() const {
+        return kind == EventKind::DepthBegin || kind == EventKind::DepthLevel || kind == EventKind::DepthEnd;
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<MarketDataEvent>);
+static_assert(std::is_standard_layout_v<MarketDataEvent>);
+static_assert(sizeof(MarketDataEvent) == 40);
+
+// Encodes a single-record message; snapshots and depth updates return nullopt.
+inline std::optional<MarketDataEvent> ToMarketDataEvent(const MarketDataMessage &message) {
+    if (auto *msg = std::get_if<NewOrderMessage>(&message)) {
+        return MarketDataEvent::NewOrder(msg->orderId, msg->side, msg->price, msg->quantity,
+                                         msg->orderType, MarketDataEvent::ToNanos(msg->timestamp));
+    }
+    if (auto *msg = std::get_if<CancelOrderMessage>(&message)) {
+        return MarketDataEvent::Cancel(msg->orderId, MarketDataEvent::ToNanos(msg->timestamp));
+    }
+    if (auto *msg = std::get_if<ModifyOrderMessage>(&message)) {
+        return MarketDataEvent::Modify(msg->orderId, msg->side, msg->newPrice, msg->newQuantity,
+                                       MarketDataEvent::ToNanos(msg->timestamp));
+    }
+    if (auto *msg = std::get_if<TradeMessage>(&message)) {
+        return MarketDataEvent::Trade(msg->buyOrderId, msg->sellOrderId, msg->price, msg->quantity,
+                                      MarketDataEvent::ToNanos(msg->timestamp));
+    }
+    return std::nullopt;
+}
+
+// Appends the record(s) for any message, spelling snapshots out as a record run.
+inline void AppendMarketDataEvents(const MarketDataMessage &message, std::vector<MarketDataEvent> &out) {
+    if (auto event = ToMarketDataEvent(message)) {
+        out.push_back(*event);
+        return;
+    }
+    if (auto *update = std::get_if<DepthUpdateMessage>(&message)) {
+        const std::int64_t timestampNs = MarketDataEvent::ToNanos(update->timestamp);
+        out.push_back(MarketDataEvent::DepthBegin(update->firstSequence, update->lastSequence, timestampNs));
+        for (const auto &level: update->bids) {
+            out.push_back(MarketDataEvent::DepthLevel(Side::Buy, level.price, level.quantity, timestampNs));
+        }
+        for (const auto &level: update->asks) {
+            out.push_back(MarketDataEvent::DepthLevel(Side::Sell, level.price, level.quantity, timestampNs));
+        }
+        out.push_back(MarketDataEvent::DepthEnd(update->firstSequence, update->lastSequence, timestampNs));
+        return;
+    }
+    const auto &snapshot = std::get<BookSnapshotMessage>(message);
+    const std::int64_t timestampNs = MarketDataEvent::ToNanos(snapshot.timestamp);
+    out.push_back(MarketDataEvent::SnapshotBegin(snapshot.sequenceNumber, timestampNs));
+    for (const auto &level: snapshot.bids) {
+        out.push_back(MarketDataEvent::SnapshotLevel(Side::Buy, level.price, level.quantity,
+                                                     static_cast<std::uint32_t>(level.orderCount), timestampNs));
+    }
+    for (const auto &level: snapshot.asks) {
+        out.push_back(MarketDataEvent::SnapshotLevel(Side::Sell, level.price, level.quantity,
+                                                     static_cast<std::uint32_t>(level.orderCount), timestampNs));
+    }
+    out.push_back(MarketDataEvent::SnapshotEnd(snapshot.sequenceNumber, timestampNs));
+}
+
+// Decodes a single-record event. Snapshot and depth records only make sense as a
+// run; use DecodeMarketDataEvents for streams that may contain them.
+inline MarketDataMessage ToMarketDataMessage(const MarketDataEvent &event) {
+    switch (event.kind) {
+        case EventKind::NewOrder:
+            return NewOrderMessage{MessageType::NewOrder, event.orderId, event.GetSide(), event.price,
+                                   event.quantity, event.GetOrderType(), event.GetTimestamp()};
+        case EventKind::CancelOrder:
+            return CancelOrderMessage{MessageType::CancelOrder, event.orderId, event.GetTimestamp()};
+        case EventKind::ModifyOrder:
+            return ModifyOrderMessage{MessageType::ModifyOrder, event.orderId, event.GetSide(), event.price,
+                                      event.quantity, event.GetTimestamp()};
+        case EventKind::Trade:
+        default:
+            return TradeMessage{MessageType::Trade, event.orderId, event.otherOrderId, event.price,
+                                event.quantity, event.GetTimestamp()};
+    }
+}
+
+// Inverse of AppendMarketDataEvents over a whole stream. An unterminated trailing
+// run is dropped.
+inline std::vector<MarketDataMessage> DecodeMarketDataEvents(std::span<const MarketDataEvent> events) {
+    std::vector<MarketDataMessage> messages;
+    messages.reserve(events.size());
+    std::optional<BookSnapshotMessage> snapshot;
+    std::optional<DepthUpdateMessage> depth;
+    for (const auto &event: events) {
+        switch (event.kind) {
+            case EventKind::SnapshotBegin:
+                snapshot.emplace();
+                snapshot->timestamp = event.GetTimestamp();
+                snapshot->sequenceNumber = event.orderId;
+                break;
+            case EventKind::SnapshotLevel:
+                if (snapshot) {
+                    SnapshotLevel level{event.price, event.quantity, static_cast<int>(event.otherOrderId)};
+                    (event.GetSide() == Side::Buy ? snapshot->bids : snapshot->asks).push_back(level);
+                }
+                break;
+            case EventKind::SnapshotEnd:
+                if (snapshot) messages.push_back(std::move(*snapshot));
+                snapshot.reset();
+                break;
+            case EventKind::DepthBegin:
+                depth.emplace();
+                depth->timestamp = event.GetTimestamp();
+                depth->firstSequence = event.orderId;
+                depth->lastSequence = event.otherOrderId;
+                break;
+            case EventKind::DepthLevel:
+                if (depth) {
+                    SnapshotLevel level{event.price, event.quantity, 0};
+                    (event.GetSide() == Side::Buy ? depth->bids : depth->asks).push_back(level);
+                }
+                break;
+            case EventKind::DepthEnd:
+                if (depth) messages.push_back(std::move(*depth));
+                depth.reset();
+                break;
+            default:
+                messages.push_back(ToMarketDataMessage(event));
+                break;
+        }
+    }
+    return messages;
+}
+
+inline MessageType ToMessageType(EventKind kind) {
+    switch (kind) {
+        case EventKind::NewOrder:    return MessageType::NewOrder;
+        case EventKind::CancelOrder: return MessageType::CancelOrder;
+        case EventKind::ModifyOrder: return MessageType::ModifyOrder;
+        case EventKind::Trade:       return MessageType::Trade;
+        case EventKind::DepthBegin:
+        case EventKind::DepthLevel:
+        case EventKind::DepthEnd:    return MessageType::DepthUpdate;
+        default:                     return MessageType::BookSnapshot;
+    }
+}
+
 struct MarketDataStats {
+    static constexpr std::size_t MessageTypeCount = static_cast<std::size_t>(MessageType::DepthUpdate) + 1;
+
     uint64_t messagesProcessed = 0;
     uint64_t newOrders = 0;
     uint64_t cancellations = 0;
     uint64_t modifications = 0;
     uint64_t trades = 0;
     uint64_t snapshots = 0;
+    uint64_t depthUpdates = 0;
     uint64_t errors = 0;
     uint64_t sequenceGaps = 0;
-    std::chrono::microseconds totalProcessingTime{0};
-    std::chrono::microseconds maxLatency{0};
-    std::chrono::microseconds minLatency{std::chrono::microseconds::max()};
+    std::chrono::nanoseconds totalProcessingTime{0};
+    std::chrono::nanoseconds maxLatency{0};
+    std::chrono::nanoseconds minLatency{std::chrono::nanoseconds::max()};
+    std::array<LatencyHistogram, MessageTypeCount> latencyByType{}; // indexed by MessageType
+
+    void RecordLatency(MessageType type, std::uint64_t nanos, std::uint64_t count = 1) {
+        const std::chrono::nanoseconds latency{static_cast<std::int64_t>(nanos)};
+        totalProcessingTime += latency * static_cast<std::int64_t>(count);
+        maxLatency = std::max(maxLatency, latency);
+        minLatency = std::min(minLatency, latency);
+        latencyByType[static_cast<std::size_t>(type)].Record(nanos, count);
+    }
+
+    const LatencyHistogram &GetLatency(MessageType type) const {
+        return latencyByType[static_cast<std::size_t>(type)];
+    }
+
+    // All message types merged into one distribution.
+    LatencyHistogram GetCombinedLatency() const {
+        LatencyHistogram combined;
+        for (const auto &histogram: latencyByType) combined.Merge(histogram);
+        return combined;
+    }
 
     void Reset() {
-        messagesProcessed = 0;
-        newOrders = 0;
-        cancellations = 0;
-        modifications = 0;
-        trades = 0;
-        snapshots = 0;
-        errors = 0;
-        sequenceGaps = 0;
-        totalProcessingTime = std::chrono::microseconds{0};
-        maxLatency = std::chrono::microseconds{0};
-        minLatency = std::chrono::microseconds::max();
+        *this = MarketDataStats{};
     }
 
-    double GetAverageLatencyMicros() const {
+    // Adds another book's counters and latencies, e.g. to total a set of replays.
+    void Merge(const MarketDataStats &other) {
+        messagesProcessed += other.messagesProcessed;
+        newOrders += other.newOrders;
+        cancellations += other.cancellations;
+        modifications += other.modifications;
+        trades += other.trades;
+        snapshots += other.snapshots;
+        depthUpdates += other.depthUpdates;
+        errors += other.errors;
+        sequenceGaps += other.sequenceGaps;
+        totalProcessingTime += other.totalProcessingTime;
+        maxLatency = std::max(maxLatency, other.maxLatency);
+        minLatency = std::min(minLatency, other.minLatency);
+        for (std::size_t i = 0; i < MessageTypeCount; ++i) latencyByType[i].Merge(other.latencyByType[i]);
+    }
+
+    double GetAverageLatencyNanos() const {
         if (messagesProcessed == 0) return 0.0;
         return static_cast<double>(totalProcessingTime.count()) / messagesProcessed;
     }
-};
\ No newline at end of file
+
+    double GetAverageLatencyMicros() const {
+        return GetAverageLatencyNanos() / 1000.0;
+    }
+};
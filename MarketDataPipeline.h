@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <thread>
+#include "MarketDataFeed.h"
+#include "OrderBook.h"
+#include "SpscQueue.h"
+#include "ThreadAffinity.h"
+
+struct PipelineStats {
+    std::uint64_t enqueued = 0;
+    std::uint64_t dropped = 0;   // rejected because the ring was full
+    std::uint64_t processed = 0; // handed to the book by the matching thread
+    std::size_t depth = 0;       // messages waiting at the time of the query
+    std::size_t maxDepth = 0;    // high-water mark observed by the producer
+};
+
+template<typename Book = Orderbook>
+class MarketDataPipeline {
+    // Decouples feed handling from book updates. A single feed-handler thread calls
+    // Publish; a dedicated matching thread owns the book and drains the ring into
+    // ProcessMarketData. Publish never blocks: when the ring is full the message is
+    // dropped and counted, so slow matching shows up as drops instead of as back
+    // pressure on the network thread.
+    //
+    // While the pipeline is running the book belongs to the matching thread. Read it
+    // from the OnApplied callback (which runs on that thread) or after Stop().
+public:
+    using OnApplied = std::function<void(const Book &, const MarketDataMessage &)>;
+
+    explicit MarketDataPipeline(Book &book, std::size_t queueCapacity = 65536)
+        : book_{book}
+          , queue_{queueCapacity} {
+    }
+
+    ~MarketDataPipeline() { Stop(); }
+
+    MarketDataPipeline(const MarketDataPipeline &) = delete;
+    MarketDataPipeline &operator=(const MarketDataPipeline &) = delete;
+
+    void SetOnApplied(OnApplied callback) { onApplied_ = std::move(callback); }
+
+    // Lets the matching thread compact the book (see BasicOrderbook::Compact) in
+    // slices of this length whenever the ring runs dry after traffic, until the book
+    // reports nothing left to reclaim. A message that arrives waits for at most one
+    // slice, or for the release of the old order index when a rebuilt one replaces
+    // it. Zero, the default, never compacts. Set before Start().
+    void SetCompactionSlice(std::chrono::nanoseconds slice) { compactionSlice_ = slice; }
+
+    // Starts the matching thread, optionally pinned to one CPU.
+    void Start(std::optional<unsigned> cpu = std::nullopt) {
+        if (running_.exchange(true)) return;
+        worker_ = std::thread([this] { Run(); });
+        if (cpu) PinThreadToCpu(worker_, *cpu);
+    }
+
+    // Stops the matching thread after it has drained everything already published.
+    void Stop() {
+        if (!running_.exchange(false)) return;
+        if (worker_.joinable()) worker_.join();
+    }
+
+    bool IsRunning() const { return running_.load(std::memory_order_relaxed); }
+
+    // Producer side; call from a single thread only.
+    bool Publish(MarketDataMessage message) {
+        if (!queue_.TryPush(std::move(message))) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        enqueued_.fetch_add(1, std::memory_order_relaxed);
+        const std::size_t depth = queue_.Size();
+        if (depth > maxDepth_.load(std::memory_order_relaxed)) {
+            maxDepth_.store(depth, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    PipelineStats GetStats() const {
+        PipelineStats stats;
+        stats.enqueued = enqueued_.load(std::memory_order_relaxed);
+        stats.dropped = dropped_.load(std::memory_order_relaxed);
+        stats.processed = processed_.load(std::memory_order_relaxed);
+        stats.depth = queue_.Size();
+        stats.maxDepth = maxDepth_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    std::size_t Capacity() const { return queue_.Capacity(); }
+
+private:
+    // Empty polls before the matching thread starts yielding the CPU.
+    static constexpr int SpinLimit = 1024;
+
+    Book &book_;
+    SpscQueue<MarketDataMessage> queue_;
+    OnApplied onApplied_;
+    std::chrono::nanoseconds compactionSlice_{0};
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+    std::atomic<std::uint64_t> enqueued_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::atomic<std::uint64_t> processed_{0};
+    std::atomic<std::size_t> maxDepth_{0};
+
+    void Run() {
+        MarketDataMessage message;
+        int idlePolls = 0;
+        bool compactionPending = false;
+        while (true) {
+            if (queue_.TryPop(message)) {
+                idlePolls = 0;
+                book_.ProcessMarketData(message);
+                processed_.fetch_add(1, std::memory_order_relaxed);
+                if (onApplied_) onApplied_(book_, message);
+                compactionPending = compactionSlice_.count() > 0;
+                continue;
+            }
+            // Check running_ only once the ring is empty so Stop() drains first.
+            if (!running_.load(std::memory_order_acquire) && queue_.Empty()) break;
+            if (compactionPending) {
+                compactionPending = !book_.Compact(compactionSlice_);
+                continue;
+            }
+            if (++idlePolls > SpinLimit) std::this_thread::yield();
+        }
+    }
+};
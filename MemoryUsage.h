@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+// Heap bytes held by one book, by component (see BasicOrderbook::GetMemoryUsage).
+// Container tables are counted at their capacity; allocator overhead per allocation
+// is not, so the total is a lower bound on what the process holds for the book.
+struct MemoryUsage {
+    std::size_t levels = 0;     // price levels of both sides
+    std::size_t orderIndex = 0; // id -> order lookup
+    std::size_t orders = 0;     // pool slots holding resting orders
+    std::size_t pools = 0;      // pool slots free for reuse, plus the pool's chunk tables
+    std::size_t buffers = 0;    // GoodForDay ids and the snapshot and delta scratch buffers
+
+    std::size_t Total() const { return levels + orderIndex + orders + pools + buffers; }
+
+    MemoryUsage &operator+=(const MemoryUsage &other) {
+        levels += other.levels;
+        orderIndex += other.orderIndex;
+        orders += other.orders;
+        pools += other.pools;
+        buffers += other.buffers;
+        return *this;
+    }
+};
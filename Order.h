@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <list>
 #include <format>
@@ -10,14 +11,18 @@
 
 class Order {
     // represents one individual order
+    //
+    // Laid out for the matching loop: the fields a sweep touches on every resting
+    // order (remaining quantity, id) come first, and type, side and market-ness share
+    // one flags byte, so the whole order is 24 bytes and fits with its queue links in
+    // a single 32-byte pool slot.
 public:
     Order(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity)
-        : orderType_{orderType}
-          , orderId_{orderId}
-          , side_{side}
+        : remainingQuantity_{quantity}
           , price_{price}
+          , orderId_{orderId}
           , initialQuantity_{quantity}
-          , remainingQuantity_{quantity} {
+          , flags_{PackFlags(orderType, side)} {
         if (quantity == 0) {
             throw std::invalid_argument("Order quantity must be greater than zero");
         }
@@ -28,9 +33,12 @@ public:
     }
 
     OrderId GetOrderId() const { return orderId_; }
-    Side GetSide() const { return side_; }
+    Side GetSide() const { return (flags_ & SellFlag) ? Side::Sell : Side::Buy; }
     Price GetPrice() const { return price_; }
-    OrderType GetOrderType() const { return orderType_; }
+    OrderType GetOrderType() const { return static_cast<OrderType>(flags_ & TypeMask); }
+    // Set once when a market order is converted to an aggressive limit on entry; the
+    // matching loop reads this instead of comparing the price against the extremes.
+    bool IsMarket() const { return (flags_ & MarketFlag) != 0; }
     Quantity GetInitialQuantity() const { return initialQuantity_; }
     Quantity GetRemainingQuantity() const { return remainingQuantity_; }
     Quantity GetFilledQuantity() const { return GetInitialQuantity() - GetRemainingQuantity(); }
@@ -45,20 +53,39 @@ public:
         remainingQuantity_ -= quantity;
     }
 
+    void Restate(Quantity quantity) {
+        // Replaces the order's size outright, for synthetic orders standing in for an
+        // aggregated level whose quantity the feed reports as a new absolute value.
+        initialQuantity_ = quantity;
+        remainingQuantity_ = quantity;
+    }
+
     void ToGoodTillCancel(Price price) {
-        if (orderType_ != OrderType::Market) {
+        if (GetOrderType() != OrderType::Market) {
             throw std::logic_error("Cannot convert non-market order to GoodTillCancel");
         }
 
         price_ = price;
-        orderType_ = OrderType::GoodTillCancel;
+        flags_ = PackFlags(OrderType::GoodTillCancel, GetSide()) | MarketFlag;
     }
 
 private:
-    OrderType orderType_;
-    OrderId orderId_;
-    Side side_;
+    static constexpr std::uint8_t TypeMask = 0x07;
+    static constexpr std::uint8_t SellFlag = 0x08;
+    static constexpr std::uint8_t MarketFlag = 0x10;
+
+    static std::uint8_t PackFlags(OrderType orderType, Side side) {
+        return static_cast<std::uint8_t>(static_cast<std::uint8_t>(orderType) |
+                                         (side == Side::Sell ? SellFlag : 0));
+    }
+
+    // hot: read or written for every fill
+    Quantity remainingQuantity_;
     Price price_;
+    OrderId orderId_;
+    // cold: reporting and entry-time checks only
     Quantity initialQuantity_;
-    Quantity remainingQuantity_;
-};
\ No newline at end of file
+    std::uint8_t flags_;
+};
+
+static_assert(sizeof(Order) == 24, "Order is expected to pack into 24 bytes");
\ No newline at end of file
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "OrderPool.h"
+#include "Types.h"
+
+// Order index policies: OrderId -> OrderHandle of the resting order. Orderbook is
+// parameterised over one of these and uses only this interface:
+//   Find(id) -> handle or OrderPool::InvalidHandle, Contains, Insert (id must be
+//   absent), Extract(id) -> handle removed or InvalidHandle, Erase, Size, Clear,
+//   Reserve(count), ForEach(fn(OrderId, OrderHandle)), AllocatedBytes,
+//   static BytesToHold(count)
+// Find and Extract answer in a single probe, so a cancel costs one lookup.
+// AllocatedBytes counts the index's own tables (node-based ones estimate their
+// nodes) and leaves out allocator overhead. BytesToHold(count) is what AllocatedBytes
+// would report for a fresh index reserved for and holding count entries, so the book
+// can tell an oversized index without building a replacement first.
+
+class StdOrderIndex {
+    // std::unordered_map: node per order, works for any id distribution.
+public:
+    OrderHandle Find(OrderId orderId) const {
+        auto it = map_.find(orderId);
+        return it == map_.end() ? OrderPool::InvalidHandle : it->second;
+    }
+
+    bool Contains(OrderId orderId) const { return map_.contains(orderId); }
+    void Insert(OrderId orderId, OrderHandle handle) { map_.emplace(orderId, handle); }
+
+    OrderHandle Extract(OrderId orderId) {
+        auto it = map_.find(orderId);
+        if (it == map_.end()) return OrderPool::InvalidHandle;
+        const OrderHandle handle = it->second;
+        map_.erase(it);
+        return handle;
+    }
+
+    void Erase(OrderId orderId) { map_.erase(orderId); }
+    std::size_t Size() const { return map_.size(); }
+    void Clear() { map_.clear(); }
+    void Reserve(std::size_t count) { map_.reserve(count); }
+
+    // Bucket array plus one node (entry and next pointer) per entry.
+    std::size_t AllocatedBytes() const {
+        return map_.bucket_count() * sizeof(void *) +
+               map_.size() * (sizeof(std::pair<const OrderId, OrderHandle>) + sizeof(void *));
+    }
+
+    static std::size_t BytesToHold(std::size_t count) {
+        return count * (sizeof(void *) + sizeof(std::pair<const OrderId, OrderHandle>) + sizeof(void *));
+    }
+
+    template<typename Fn>
+    void ForEach(Fn &&fn) const {
+        for (const auto &[orderId, handle]: map_) fn(orderId, handle);
+    }
+
+private:
+    std::unordered_map<OrderId, OrderHandle> map_;
+};
+
+class FlatOrderIndex {
+    // Open addressing with linear probing over one flat slot array, kept at most half
+    // full. Ids are spread with Fibonacci hashing, so sequential ids land on distinct
+    // slots. Erase shifts the rest of the probe run back instead of leaving
+    // tombstones, so lookups never slow down under add/cancel churn.
+public:
+    explicit FlatOrderIndex(std::size_t capacityHint = 0) {
+        Rehash(std::bit_ceil(std::max<std::size_t>(MinCapacity, capacityHint * 2)));
+    }
+
+    OrderHandle Find(OrderId orderId) const {
+        for (std::size_t i = HomeOf(orderId);; i = (i + 1) & mask_) {
+            const Slot &slot = slots_[i];
+            if (slot.handle == OrderPool::InvalidHandle) return OrderPool::InvalidHandle;
+            if (slot.orderId == orderId) return slot.handle;
+        }
+    }
+
+    bool Contains(OrderId orderId) const { return Find(orderId) != OrderPool::InvalidHandle; }
+
+    void Insert(OrderId orderId, OrderHandle handle) {
+        if ((size_ + 1) * 2 > slots_.size()) Rehash(slots_.size() * 2);
+        std::size_t i = HomeOf(orderId);
+        while (slots_[i].handle != OrderPool::InvalidHandle) i = (i + 1) & mask_;
+        slots_[i] = Slot{orderId, handle};
+        ++size_;
+    }
+
+    OrderHandle Extract(OrderId orderId) {
+        for (std::size_t i = HomeOf(orderId);; i = (i + 1) & mask_) {
+            const OrderHandle handle = slots_[i].handle;
+            if (handle == OrderPool::InvalidHandle) return OrderPool::InvalidHandle;
+            if (slots_[i].orderId == orderId) {
+                EraseSlot(i);
+                return handle;
+            }
+        }
+    }
+
+    void Erase(OrderId orderId) { Extract(orderId); }
+    std::size_t Size() const { return size_; }
+
+    void Clear() {
+        std::fill(slots_.begin(), slots_.end(), Slot{});
+        size_ = 0;
+    }
+
+    // Grows the table once so count entries fit without rehashing on the way.
+    void Reserve(std::size_t count) {
+        if (count * 2 > slots_.size()) Rehash(std::bit_ceil(count * 2));
+    }
+
+    std::size_t AllocatedBytes() const { return slots_.capacity() * sizeof(Slot); }
+
+    static std::size_t BytesToHold(std::size_t count) {
+        return std::bit_ceil(std::max<std::size_t>(MinCapacity, count * 2)) * sizeof(Slot);
+    }
+
+    template<typename Fn>
+    void ForEach(Fn &&fn) const {
+        for (const Slot &slot: slots_) {
+            if (slot.handle != OrderPool::InvalidHandle) fn(slot.orderId, slot.handle);
+        }
+    }
+
+private:
+    static constexpr std::size_t MinCapacity = 16;
+
+    struct Slot {
+        OrderId orderId = 0;
+        OrderHandle handle = OrderPool::InvalidHandle; // InvalidHandle marks an empty slot
+    };
+
+    std::vector<Slot> slots_;
+    std::size_t mask_ = 0;
+    int shift_ = 0;
+    std::size_t size_ = 0;
+
+    std::size_t HomeOf(OrderId orderId) const {
+        return static_cast<std::size_t>((orderId * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    void EraseSlot(std::size_t hole) {
+        for (std::size_t next = (hole + 1) & mask_;; next = (next + 1) & mask_) {
+            if (slots_[next].handle == OrderPool::InvalidHandle) break;
+            // An entry may fill the hole unless its home lies cyclically in (hole, next].
+            const std::size_t home = HomeOf(slots_[next].orderId);
+            const bool staysPut = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+            if (staysPut) continue;
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+        slots_[hole] = Slot{};
+        --size_;
+    }
+
+    void Rehash(std::size_t capacity) {
+        std::vector<Slot> old = std::move(slots_);
+        slots_.assign(capacity, Slot{});
+        mask_ = capacity - 1;
+        shift_ = 64 - std::countr_zero(capacity);
+        size_ = 0;
+        for (const Slot &slot: old) {
+            if (slot.handle != OrderPool::InvalidHandle) Insert(slot.orderId, slot.handle);
+        }
+    }
+};
+
+class DenseOrderIndex {
+    // Direct-indexed table for venues that assign dense, increasing ids: the handle
+    // for id lives at table_[id - baseId_], so a lookup is one array read. The window
+    // starts at the first id inserted into an empty index and grows up to MaxWindow
+    // entries. When newer ids outrun it, the window slides forward by half; the few
+    // orders still resting in the part left behind move to the overflow
+    // FlatOrderIndex, which also takes ids below the window and ids far above it
+    // (such as synthetic snapshot ids).
+public:
+    static constexpr std::size_t MaxWindow = std::size_t{1} << 22; // 16 MiB of handles
+
+    // An id can sit in the overflow even once the window covers it, if it arrived
+    // while still far ahead; a miss in the table therefore checks the overflow too.
+    OrderHandle Find(OrderId orderId) const {
+        if (InWindow(orderId)) {
+            const OrderHandle handle = table_[orderId - baseId_];
+            if (handle != OrderPool::InvalidHandle) return handle;
+        }
+        return overflow_.Size() == 0 ? OrderPool::InvalidHandle : overflow_.Find(orderId);
+    }
+
+    bool Contains(OrderId orderId) const { return Find(orderId) != OrderPool::InvalidHandle; }
+
+    void Insert(OrderId orderId, OrderHandle handle) {
+        if (size_ == 0 && overflow_.Size() == 0) baseId_ = orderId;
+        if (!InWindow(orderId) && orderId >= baseId_ && orderId - baseId_ < MaxWindow * 2) Extend(orderId);
+        if (InWindow(orderId)) {
+            table_[orderId - baseId_] = handle;
+            ++size_;
+        } else {
+            overflow_.Insert(orderId, handle);
+        }
+    }
+
+    OrderHandle Extract(OrderId orderId) {
+        if (InWindow(orderId)) {
+            OrderHandle &slot = table_[orderId - baseId_];
+            const OrderHandle handle = slot;
+            if (handle != OrderPool::InvalidHandle) {
+                slot = OrderPool::InvalidHandle;
+                --size_;
+                return handle;
+            }
+        }
+        return overflow_.Size() == 0 ? OrderPool::InvalidHandle : overflow_.Extract(orderId);
+    }
+
+    void Erase(OrderId orderId) { Extract(orderId); }
+    std::size_t Size() const { return size_ + overflow_.Size(); }
+
+    void Clear() {
+        table_.clear();
+        overflow_.Clear();
+        size_ = 0;
+    }
+
+    // The window sizes itself from the ids it sees, so only the table's capacity is
+    // set aside here.
+    void Reserve(std::size_t count) { table_.reserve(std::min(MaxWindow, count)); }
+
+    std::size_t AllocatedBytes() const {
+        return table_.capacity() * sizeof(OrderHandle) + overflow_.AllocatedBytes();
+    }
+
+    // Assumes the ids are dense, as the window does; scattered ones spill into the
+    // overflow table and cost more.
+    static std::size_t BytesToHold(std::size_t count) {
+        return std::min(MaxWindow, count) * sizeof(OrderHandle) + FlatOrderIndex::BytesToHold(0);
+    }
+
+    template<typename Fn>
+    void ForEach(Fn &&fn) const {
+        for (std::size_t i = 0; i < table_.size(); ++i) {
+            if (table_[i] != OrderPool::InvalidHandle) fn(baseId_ + i, table_[i]);
+        }
+        overflow_.ForEach(fn);
+    }
+
+private:
+    std::vector<OrderHandle> table_;
+    OrderId baseId_ = 0;
+    std::size_t size_ = 0; // entries in table_
+    FlatOrderIndex overflow_;
+
+    bool InWindow(OrderId orderId) const {
+        return orderId >= baseId_ && orderId - baseId_ < table_.size();
+    }
+
+    // Makes room for orderId, which lies above the window but within two windows of
+    // baseId_: grow while under MaxWindow, then slide.
+    void Extend(OrderId orderId) {
+        const std::size_t needed = static_cast<std::size_t>(orderId - baseId_) + 1;
+        if (needed <= MaxWindow) {
+            table_.resize(std::min(MaxWindow, std::bit_ceil(std::max<std::size_t>(needed, 1024))),
+                          OrderPool::InvalidHandle);
+            return;
+        }
+        table_.resize(MaxWindow, OrderPool::InvalidHandle);
+        while (!InWindow(orderId)) Slide(MaxWindow / 2);
+    }
+
+    void Slide(std::size_t by) {
+        for (std::size_t i = 0; i < by; ++i) {
+            if (table_[i] != OrderPool::InvalidHandle) {
+                overflow_.Insert(baseId_ + i, table_[i]);
+                --size_;
+            }
+        }
+        std::move(table_.begin() + by, table_.end(), table_.begin());
+        std::fill(table_.end() - by, table_.end(), OrderPool::InvalidHandle);
+        baseId_ += by;
+    }
+};
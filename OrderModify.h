@@ -18,9 +18,13 @@ public:
     Side GetSide() const { return side_; }
     Quantity GetQuantity() const { return quantity_; }
 
-    OrderPointer ToOrderPointer(OrderType type) const {
+    Order ToOrder(OrderType type) const {
         // Converts modification to new order
-        return std::make_shared<Order>(type, GetOrderId(), GetSide(), GetPrice(), GetQuantity());
+        return Order{type, GetOrderId(), GetSide(), GetPrice(), GetQuantity()};
+    }
+
+    OrderPointer ToOrderPointer(OrderType type) const {
+        return std::make_shared<Order>(ToOrder(type));
     }
 
 private:
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "Order.h"
+#include "Types.h"
+
+class OrderPool {
+    // Slab allocator for resting orders. Orders live in fixed-size chunks that are
+    // never moved while the pool is alive, so a handle (and any reference obtained
+    // through it) stays valid until the order is released or relocated. Every slot
+    // also carries prev/next links: price levels use them for their FIFO queue, and
+    // released slots are threaded onto their chunk's free list through the same next
+    // link.
+    //
+    // Acquire always takes a slot from the lowest chunk with room, so once a peak
+    // has passed the orders gather in the low chunks and the top ones drain. Relocate
+    // moves the stragglers down and ReleaseTopChunk hands a drained chunk back to the
+    // heap; the book drives both from its compaction pass.
+public:
+    static constexpr OrderHandle InvalidHandle = std::numeric_limits<OrderHandle>::max();
+    static constexpr std::size_t ChunkShift = 12; // 4096 orders per chunk
+    static constexpr std::size_t ChunkSize = std::size_t{1} << ChunkShift;
+
+    explicit OrderPool(std::size_t capacityHint = 0) {
+        Reserve(capacityHint);
+    }
+
+    OrderPool(const OrderPool &) = delete;
+    OrderPool &operator=(const OrderPool &) = delete;
+
+    template<typename... Args>
+    OrderHandle Acquire(Args &&... args) {
+        const OrderHandle handle = TakeSlot();
+
+        // Construct before bumping size_ so a throwing constructor (e.g. zero
+        // quantity) leaves the slot reusable.
+        try {
+            ::new(SlotAt(handle).storage) Order(std::forward<Args>(args)...);
+        } catch (...) {
+            PushFree(handle);
+            throw;
+        }
+        SlotAt(handle).prev_ = InvalidHandle;
+        SlotAt(handle).next_ = InvalidHandle;
+        ++size_;
+        return handle;
+    }
+
+    void Release(OrderHandle handle) {
+        // Order is trivially destructible, so releasing is just a free-list push.
+        PushFree(handle);
+        --size_;
+    }
+
+    Order &Get(OrderHandle handle) {
+        return *std::launder(reinterpret_cast<Order *>(SlotAt(handle).storage));
+    }
+
+    const Order &Get(OrderHandle handle) const {
+        return *std::launder(reinterpret_cast<const Order *>(SlotAt(handle).storage));
+    }
+
+    OrderHandle Next(OrderHandle handle) const { return SlotAt(handle).next_; }
+    OrderHandle Prev(OrderHandle handle) const { return SlotAt(handle).prev_; }
+    void SetNext(OrderHandle handle, OrderHandle next) { SlotAt(handle).next_ = next; }
+    void SetPrev(OrderHandle handle, OrderHandle prev) { SlotAt(handle).prev_ = prev; }
+
+    void Reserve(std::size_t capacity) {
+        while (Capacity() < capacity) AddChunk();
+    }
+
+    // Forgets every live order but keeps the chunks for reuse.
+    void Clear() {
+        for (ChunkState &state: states_) state = ChunkState{};
+        for (std::size_t chunk = 0; chunk < states_.size(); ++chunk) MarkRoom(chunk);
+        size_ = 0;
+    }
+
+    std::size_t Size() const { return size_; }
+    std::size_t Capacity() const { return chunks_.size() * ChunkSize; }
+    std::size_t ChunkCount() const { return chunks_.size(); }
+
+    // Heap bytes held by the chunks and the tables that keep track of them.
+    std::size_t AllocatedBytes() const {
+        return Capacity() * sizeof(Slot) + chunks_.capacity() * sizeof(chunks_[0]) +
+               states_.capacity() * sizeof(ChunkState) + room_.capacity() * sizeof(std::uint64_t);
+    }
+
+    // Bytes of one slot, links included.
+    static constexpr std::size_t SlotBytes() { return sizeof(Slot); }
+
+    std::size_t LiveInChunk(std::size_t chunk) const { return states_[chunk].live; }
+
+    // Handles of a chunk that have ever been handed out: [ChunkBegin, ChunkEnd).
+    static OrderHandle ChunkBegin(std::size_t chunk) { return static_cast<OrderHandle>(chunk << ChunkShift); }
+    OrderHandle ChunkEnd(std::size_t chunk) const { return ChunkBegin(chunk) + states_[chunk].used; }
+
+    bool IsLive(OrderHandle handle) const {
+        return (handle & ChunkMask) < states_[handle >> ChunkShift].used && SlotAt(handle).prev_ != FreeMark;
+    }
+
+    // Moves a live order, links included, to a free slot in the lowest chunk with
+    // room and returns its new handle; the old one is released. Its queue neighbours
+    // are relinked here, but the price level's head and tail and the order index are
+    // the caller's to update. Orders only move down: if no lower chunk has room, the
+    // order stays put and its handle is returned unchanged.
+    OrderHandle Relocate(OrderHandle from) {
+        if (LowestChunkWithRoom() >= (from >> ChunkShift)) return from;
+        const OrderHandle to = TakeSlot();
+        Slot &target = SlotAt(to);
+        const Slot &source = SlotAt(from);
+        ::new(target.storage) Order(Get(from));
+        target.prev_ = source.prev_;
+        target.next_ = source.next_;
+        if (target.prev_ != InvalidHandle) SetNext(target.prev_, to);
+        if (target.next_ != InvalidHandle) SetPrev(target.next_, to);
+        PushFree(from);
+        return to;
+    }
+
+    // Frees the last chunk if no order lives in it anymore.
+    bool ReleaseTopChunk() {
+        if (chunks_.empty() || states_.back().live != 0) return false;
+        const std::size_t chunk = chunks_.size() - 1;
+        room_[chunk >> 6] &= ~(std::uint64_t{1} << (chunk & 63));
+        chunks_.pop_back();
+        states_.pop_back();
+        return true;
+    }
+
+    // Trims the chunk tables after chunks were released.
+    void ShrinkToFit() {
+        chunks_.shrink_to_fit();
+        states_.shrink_to_fit();
+        room_.resize((chunks_.size() + 63) / 64);
+        room_.shrink_to_fit();
+    }
+
+private:
+    static_assert(std::is_trivially_destructible_v<Order>,
+                  "OrderPool never runs destructors on released orders");
+
+    static constexpr std::size_t ChunkMask = ChunkSize - 1;
+
+    // Stored in prev_ of a released slot, so a chunk scan can tell live orders from
+    // free slots. A resting order's prev_ is a real handle or InvalidHandle.
+    static constexpr OrderHandle FreeMark = InvalidHandle - 1;
+
+    // 32-byte aligned so an order and its links never straddle a cache line: a sweep
+    // touches exactly one line per resting order, two orders per line.
+    struct alignas(32) Slot {
+        alignas(Order) std::byte storage[sizeof(Order)];
+        OrderHandle prev_;
+        OrderHandle next_;
+    };
+
+    static_assert(sizeof(Slot) == 32, "order slot should be half a cache line");
+
+    // Per chunk: its free list, how many of its slots have ever been handed out
+    // (slots past that are taken in order once the free list is empty), and how
+    // many hold an order. room_ has a bit set for every chunk with a free slot.
+    struct ChunkState {
+        OrderHandle freeHead = InvalidHandle;
+        std::uint32_t used = 0;
+        std::uint32_t live = 0;
+    };
+
+    std::vector<std::unique_ptr<Slot[]> > chunks_;
+    std::vector<ChunkState> states_;
+    std::vector<std::uint64_t> room_;
+    std::size_t size_ = 0;
+
+    Slot &SlotAt(OrderHandle handle) {
+        return chunks_[handle >> ChunkShift][handle & ChunkMask];
+    }
+
+    const Slot &SlotAt(OrderHandle handle) const {
+        return chunks_[handle >> ChunkShift][handle & ChunkMask];
+    }
+
+    std::size_t LowestChunkWithRoom() const {
+        for (std::size_t word = 0; word < room_.size(); ++word) {
+            if (room_[word]) return word * 64 + std::countr_zero(room_[word]);
+        }
+        return chunks_.size();
+    }
+
+    void MarkRoom(std::size_t chunk) {
+        room_[chunk >> 6] |= std::uint64_t{1} << (chunk & 63);
+    }
+
+    OrderHandle TakeSlot() {
+        const std::size_t chunk = LowestChunkWithRoom();
+        if (chunk == chunks_.size()) AddChunk();
+        ChunkState &state = states_[chunk];
+        OrderHandle handle;
+        if (state.freeHead != InvalidHandle) {
+            handle = state.freeHead;
+            state.freeHead = SlotAt(handle).next_;
+        } else {
+            handle = ChunkBegin(chunk) + state.used++;
+        }
+        if (++state.live == ChunkSize) room_[chunk >> 6] &= ~(std::uint64_t{1} << (chunk & 63));
+        return handle;
+    }
+
+    void PushFree(OrderHandle handle) {
+        const std::size_t chunk = handle >> ChunkShift;
+        ChunkState &state = states_[chunk];
+        Slot &slot = SlotAt(handle);
+        slot.prev_ = FreeMark;
+        slot.next_ = state.freeHead;
+        state.freeHead = handle;
+        if (state.live-- == ChunkSize) MarkRoom(chunk);
+    }
+
+    void AddChunk() {
+        chunks_.push_back(std::make_unique<Slot[]>(ChunkSize));
+        states_.emplace_back();
+        if (room_.size() * 64 < chunks_.size()) room_.push_back(0);
+        MarkRoom(chunks_.size() - 1);
+    }
+};
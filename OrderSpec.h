@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Order.h"
+#include "Types.h"
+#include "OrderType.h"
+
+// One resting order for BasicOrderbook::BulkLoad. Specs for the same side and
+// price keep the order they are given in, which becomes their queue order.
+struct OrderSpec {
+    OrderType orderType = OrderType::GoodTillCancel;
+    OrderId orderId = 0;
+    Side side = Side::Buy;
+    Price price = 0;
+    Quantity quantity = 0;
+
+    Order ToOrder() const { return Order{orderType, orderId, side, price, quantity}; }
+};
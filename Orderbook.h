@@ -1,17 +1,23 @@
 #pragma once
 
 #include <map>
-#include <unordered_map>
 #include <algorithm>
 #include <numeric>
 #include <chrono>
 #include <vector>
+#include <unordered_map>
 #include <optional>
+#include <array>
+#include <span>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
 #include "Order.h"
 #include "OrderModify.h"
+#include "OrderSpec.h"
 #include "Trade.h"
 #include "LevelInfo.h"
 #include "Types.h"
@@ -19,67 +25,431 @@
 #include "Constants.h"
 #include "MarketDataFeed.h"
 #include "ExchangeRules.h"
+#include "OrderPool.h"
+#include "PriceLevel.h"
+#include "BookSide.h"
+#include "OrderIndex.h"
+#include "Instrumentation.h"
+#include "Checkpoint.h"
+#include "LevelDelta.h"
+#include "TopOfBook.h"
+#include "MemoryUsage.h"
+
+// BookSide selects how each side stores its price levels: MapBookSide (ordered map,
+// any price) or LadderBookSide (flat array over a fixed tick band). Instrumentation
+// selects which stats and timers are compiled in (see Instrumentation.h); backtests
+// can use NoInstrumentation and pay nothing for them. OrderIndex maps ids to resting
+// orders (see OrderIndex.h); DenseOrderIndex suits venues with sequential ids.
+template<template<Side> class BookSide = MapBookSide, typename Instrumentation = MessageInstrumentation<>,
+    typename OrderIndex = FlatOrderIndex>
+class BasicOrderbook {
+public:
+    using BookSideConfig = typename BookSide<Side::Buy>::Config;
+    using Clock = typename Instrumentation::Clock;
 
-class Orderbook {
 private:
-    struct OrderEntry {
-        OrderPointer order_{nullptr};
-        std::size_t location_; // index into the price level vector
-    };
-
-    std::map<Price, OrderPointers, std::greater<Price> > bids_;
-    std::map<Price, OrderPointers, std::less<Price> > asks_;
-    std::unordered_map<OrderId, OrderEntry> orders_;
-
-    std::chrono::system_clock::time_point lastDayReset_;
-    std::chrono::hours dayResetHour_{15};
-    int dayResetMinute_{59};
+    // Resting orders live in pool_; price levels and orders_ only hold handles
+    // (a handle is also the order's node in its price level), so adding, cancelling
+    // and filling orders never touches the heap once the pool has warmed up.
+    OrderPool pool_;
+    BookSide<Side::Buy> bids_;
+    BookSide<Side::Sell> asks_;
+    OrderIndex orders_;
+
+    // GoodForDay expiry. goodForDayIds_ lists ids that were GoodForDay when they were
+    // rested; entries are not removed on cancel or fill but skipped at expiry, and the
+    // list is compacted once it is mostly stale. Session close is computed from the
+    // timestamps passed to AdvanceTime, never from the wall clock.
+    std::vector<OrderId> goodForDayIds_;
+    std::size_t restingGoodForDay_ = 0;
+    std::chrono::minutes dayResetTime_{15 * 60 + 59}; // session close, minutes after midnight
+    std::chrono::minutes utcOffset_{0};               // of the session's local time
+    std::int64_t nextDayResetNs_ = NoDayReset;
+    static constexpr std::int64_t NoDayReset = std::numeric_limits<std::int64_t>::min();
 
     MarketDataStats stats_;
+    static constexpr OrderId SyntheticIdBase = 0x8000000000000000ULL; // ids of snapshot orders
+    static constexpr std::size_t CheckpointBufferRecords = 4096;
+    static constexpr std::size_t UncheckedReserveLimit = std::size_t{1} << 20; // orders, for unseekable streams
+    OrderId nextSyntheticId_ = SyntheticIdBase;
+    bool applyingDepth_ = false; // inside a DepthBegin..DepthEnd record run that passed the sequence check
+    bool applyingSnapshot_ = false; // inside a SnapshotBegin..SnapshotEnd record run
+    std::array<std::vector<Price>, 3> snapshotPrices_; // bids and asks seen in the current snapshot, then scratch
+    std::array<bool, 2> snapshotOrdered_{true, true};
+    [[no_unique_address]] PhaseLatencies<Instrumentation::TimePhases, Clock> phases_;
     uint64_t lastSequenceNumber_ = 0;
     bool isInitialized_ = false;
 
+    // Top-of-book publication. Every public mutator opens an UpdateScope; when the
+    // outermost one closes, the attached publisher (if any) is handed the book, so a
+    // batch or a message that runs several internal updates publishes once. It is
+    // only handed over when a touched level lies inside the published depth or the
+    // sequence number moved, and only the touched sides are read again.
+    TopOfBookPublisher *topOfBook_ = nullptr;
+    int updateDepth_ = 0;
+
+    // L2 deltas. While a sink or a publisher is attached, every level an update
+    // touches is noted in touchedLevels_ (side and price packed as in LevelKey) with
+    // its aggregate before the first touch; the outermost UpdateScope then reports
+    // each distinct one whose aggregate differs after the update. Both buffers keep
+    // their capacity, so steady-state updates do not allocate.
+    struct TouchedLevel {
+        std::uint64_t key;
+        Quantity quantity;
+        std::uint32_t orderCount;
+    };
+    LevelDeltaSink levelDeltaSink_;
+    std::vector<TouchedLevel> touchedLevels_;
+    std::vector<LevelDelta> levelDeltas_;
+    std::uint64_t deltaSequence_ = 0;
+
+    // Compaction (see Compact). compactCursor_ is where the scan of the pool's top
+    // chunk resumes in the next slice.
+    static constexpr std::size_t CompactionClockInterval = 64; // slots scanned between clock reads
+    static constexpr std::size_t BufferKeepCapacity = 1024;
+    OrderHandle compactCursor_ = 0;
+
+    // Order index rebuild (see Compact), spread over slices: the replacement table and
+    // how far the pool scan filling it has got. Orders at handles below the cursor are
+    // already in it, so inserts and releases there are mirrored into it until it
+    // takes over from orders_.
+    std::optional<OrderIndex> indexRebuild_;
+    OrderHandle indexRebuildCursor_ = 0;
+
+    class UpdateScope {
+    public:
+        explicit UpdateScope(BasicOrderbook &book) : book_(book) { ++book_.updateDepth_; }
+        ~UpdateScope() {
+            if (--book_.updateDepth_ != 0) return;
+            if (book_.topOfBook_ != nullptr) book_.PublishTopOfBook();
+            if (book_.levelDeltaSink_) {
+                if (!book_.touchedLevels_.empty()) book_.FlushLevelDeltas();
+            } else {
+                book_.touchedLevels_.clear();
+            }
+        }
+        UpdateScope(const UpdateScope &) = delete;
+        UpdateScope &operator=(const UpdateScope &) = delete;
+
+    private:
+        BasicOrderbook &book_;
+    };
+
     ExchangeRules exchangeRules_;
 
+    static std::uint64_t LevelKey(Side side, Price price) {
+        return (static_cast<std::uint64_t>(side) << 32) | static_cast<std::uint32_t>(price);
+    }
+
+    // Notes that the level's aggregate is about to change; call it before changing
+    // the level, with nullptr for a level that does not exist yet. Consecutive touches
+    // of one level, as when a sweep fills several orders there, are kept once.
+    void TouchLevel(Side side, Price price, const PriceLevel *level) {
+        if (!levelDeltaSink_ && topOfBook_ == nullptr) return;
+        const std::uint64_t key = LevelKey(side, price);
+        if (!touchedLevels_.empty() && touchedLevels_.back().key == key) return;
+        touchedLevels_.push_back(TouchedLevel{
+            key, level ? level->GetTotalQuantity() : 0, level ? level->GetOrderCount() : 0
+        });
+    }
+
+    // With fromEmpty every level is reported, as to a consumer that has none yet.
+    void TouchAllLevels(bool fromEmpty = false) {
+        if (!levelDeltaSink_ && topOfBook_ == nullptr) return;
+        auto touch = [this, fromEmpty](Side side) {
+            return [this, fromEmpty, side](Price price, const PriceLevel &level) {
+                TouchLevel(side, price, fromEmpty ? nullptr : &level);
+                return true;
+            };
+        };
+        bids_.ForEachLevel(touch(Side::Buy));
+        asks_.ForEachLevel(touch(Side::Sell));
+    }
+
+    void PublishTopOfBook() {
+        bool bidsTouched = false;
+        bool asksTouched = false;
+        for (const TouchedLevel &touched: touchedLevels_) {
+            const Side side = static_cast<Side>(touched.key >> 32);
+            if (!topOfBook_->Covers(side, static_cast<Price>(static_cast<std::uint32_t>(touched.key)))) continue;
+            (side == Side::Buy ? bidsTouched : asksTouched) = true;
+            if (bidsTouched && asksTouched) break;
+        }
+        if (bidsTouched || asksTouched || lastSequenceNumber_ != topOfBook_->PublishedSequence()) {
+            topOfBook_->Publish(*this, bidsTouched, asksTouched);
+        }
+    }
+
+    // A level back at the aggregate it had before the update, as after an amend to
+    // the same size or an order added and cancelled in one batch, is left out; an
+    // update that changed no level at all takes no sequence number.
+    void FlushLevelDeltas() {
+        // The stable sort keeps each level's first touch, which holds its old aggregate, in front.
+        std::stable_sort(touchedLevels_.begin(), touchedLevels_.end(),
+                         [](const TouchedLevel &lhs, const TouchedLevel &rhs) { return lhs.key < rhs.key; });
+        const std::uint64_t sequence = deltaSequence_ + 1;
+        std::uint64_t previousKey = 0;
+        for (std::size_t i = 0; i < touchedLevels_.size(); ++i) {
+            const TouchedLevel &touched = touchedLevels_[i];
+            if (i > 0 && touched.key == previousKey) continue;
+            previousKey = touched.key;
+            const Side side = static_cast<Side>(touched.key >> 32);
+            const Price price = static_cast<Price>(static_cast<std::uint32_t>(touched.key));
+            const PriceLevel *level = (side == Side::Buy) ? bids_.Find(price) : asks_.Find(price);
+            const Quantity quantity = level ? level->GetTotalQuantity() : 0;
+            const std::uint32_t orderCount = level ? level->GetOrderCount() : 0;
+            if (quantity == touched.quantity && orderCount == touched.orderCount) continue;
+            levelDeltas_.push_back(LevelDelta{sequence, price, quantity, orderCount, side});
+        }
+        touchedLevels_.clear();
+        if (levelDeltas_.empty()) return;
+        deltaSequence_ = sequence;
+        levelDeltaSink_(std::span<const LevelDelta>(levelDeltas_));
+        levelDeltas_.clear();
+    }
+
+    static void Count(std::uint64_t &counter, std::uint64_t amount = 1) {
+        if constexpr (Instrumentation::CountMessages) counter += amount;
+    }
+
+    // Message timers read the clock only when TimeMessages is enabled.
+    static typename Clock::Ticks StartTimer() {
+        if constexpr (Instrumentation::TimeMessages) return Clock::Now();
+        else return {};
+    }
+
+    void RecordLatency(MessageType type, typename Clock::Ticks startTime) {
+        if constexpr (Instrumentation::TimeMessages) {
+            stats_.RecordLatency(type, Clock::ToNanos(Clock::Now() - startTime));
+        }
+    }
+
     bool CanMatch(Side side, Price price) const {
         if (side == Side::Buy) {
-            if (asks_.empty()) return false;
-            const auto &[bestAsk, _] = *asks_.begin();
-            return price >= bestAsk;
+            if (asks_.Empty()) return false;
+            return price >= asks_.BestPrice();
         } else {
-            if (bids_.empty()) return false;
-            const auto &[bestBid, _] = *bids_.begin();
-            return price <= bestBid;
+            if (bids_.Empty()) return false;
+            return price <= bids_.BestPrice();
         }
     }
 
-    OrderValidation ValidateOrder(OrderPointer order) const {
-        if (orders_.contains(order->GetOrderId())) {
-            return OrderValidation::Reject(RejectReason::DuplicateOrderId);
+    // Rests an already validated order at the back of its level, without matching.
+    void InsertOrder(const Order &order) {
+        PriceLevel *level;
+        {
+            [[maybe_unused]] auto timer = phases_.Time(Phase::LevelLookup);
+            level = (order.GetSide() == Side::Buy)
+                        ? &bids_.GetOrCreate(order.GetPrice())
+                        : &asks_.GetOrCreate(order.GetPrice());
         }
+        TouchLevel(order.GetSide(), order.GetPrice(), level);
+        const OrderHandle handle = pool_.Acquire(order);
+        level->PushBack(pool_, handle);
+        IndexOrder(order.GetOrderId(), handle);
+        if (order.GetOrderType() == OrderType::GoodForDay) TrackGoodForDay(order.GetOrderId());
+    }
+
+    // Rests an order at the back of a level without validation or matching; the
+    // caller has picked the level for the order's side and price and checked that
+    // the id is new.
+    void AppendResting(PriceLevel &level, const Order &order) {
+        const OrderHandle handle = pool_.Acquire(order);
+        level.PushBack(pool_, handle);
+        IndexOrder(order.GetOrderId(), handle);
+        if (order.GetOrderType() == OrderType::GoodForDay) TrackGoodForDay(order.GetOrderId());
+    }
+
+    void TrackGoodForDay(OrderId orderId) {
+        ++restingGoodForDay_;
+        if (goodForDayIds_.size() >= 64 && goodForDayIds_.size() > restingGoodForDay_ * 2) DropStaleGoodForDayIds();
+        goodForDayIds_.push_back(orderId);
+    }
+
+    void DropStaleGoodForDayIds() {
+        std::erase_if(goodForDayIds_, [this](OrderId id) { return !IsRestingGoodForDay(id); });
+        std::sort(goodForDayIds_.begin(), goodForDayIds_.end());
+        goodForDayIds_.erase(std::unique(goodForDayIds_.begin(), goodForDayIds_.end()), goodForDayIds_.end());
+    }
+
+    bool IsRestingGoodForDay(OrderId orderId) const {
+        const OrderHandle handle = orders_.Find(orderId);
+        return handle != OrderPool::InvalidHandle && pool_.Get(handle).GetOrderType() == OrderType::GoodForDay;
+    }
 
-        Price orderPrice = order->GetPrice();
-        bool isConvertedMarketOrder = (orderPrice == std::numeric_limits<Price>::max() ||
-                                       orderPrice == std::numeric_limits<Price>::min());
+    // Every order enters the index through here.
+    void IndexOrder(OrderId orderId, OrderHandle handle) {
+        orders_.Insert(orderId, handle);
+        if (indexRebuild_ && handle < indexRebuildCursor_) indexRebuild_->Insert(orderId, handle);
+    }
 
-        if (!isConvertedMarketOrder) {
+    // Every order leaves the book through here.
+    void ReleaseOrder(OrderHandle handle) {
+        if (pool_.Get(handle).GetOrderType() == OrderType::GoodForDay) --restingGoodForDay_;
+        if (indexRebuild_ && handle < indexRebuildCursor_) indexRebuild_->Erase(pool_.Get(handle).GetOrderId());
+        pool_.Release(handle);
+    }
+
+    PriceLevel &LevelAt(Side side, Price price) {
+        return (side == Side::Sell) ? *asks_.Find(price) : *bids_.Find(price);
+    }
+
+    // Unlinks an order from its level, drops it from the index and frees its slot.
+    // Leaves erasing an emptied level to the caller, which usually holds its iterator.
+    void RemoveOrder(PriceLevel &level, OrderHandle handle) {
+        orders_.Erase(pool_.Get(handle).GetOrderId());
+        level.Erase(pool_, handle);
+        ReleaseOrder(handle);
+    }
+
+    // A same-side, same-price amend that does not add quantity keeps the order's place
+    // in the queue and cannot cross, so it is applied as a restate of its size with
+    // no revalidation of price and no matching. Anything else is a cancel/replace.
+    bool TryAmendInPlace(OrderHandle handle, Side side, Price price, Quantity quantity) {
+        const Order &resting = pool_.Get(handle);
+        if (resting.GetSide() != side || resting.GetPrice() != price) return false;
+        if (quantity == 0 || quantity > resting.GetRemainingQuantity()) return false;
+        if (!exchangeRules_.IsValidQuantity(quantity) || !exchangeRules_.IsValidNotional(price, quantity)) return false;
+        PriceLevel &level = LevelAt(side, price);
+        TouchLevel(side, price, &level);
+        level.Restate(pool_, handle, quantity);
+        return true;
+    }
+
+    // Moves one resting order to a free slot lower in the pool; its place in the
+    // level's queue does not change.
+    void RelocateOrder(OrderHandle handle) {
+        const Order &order = pool_.Get(handle);
+        const OrderId orderId = order.GetOrderId();
+        PriceLevel &level = LevelAt(order.GetSide(), order.GetPrice());
+        const OrderHandle moved = pool_.Relocate(handle);
+        if (moved == handle) return;
+        level.Relink(handle, moved);
+        orders_.Extract(orderId);
+        if (indexRebuild_ && handle < indexRebuildCursor_) indexRebuild_->Erase(orderId);
+        IndexOrder(orderId, moved);
+    }
+
+    // Index tables only grow. A fresh one sized for the resting orders replaces one at
+    // least four times larger: StartOrderIndexRebuild sets it up if so, and
+    // ContinueOrderIndexRebuild fills it from the pool in handle order until deadline,
+    // then swaps it in once the scan reaches the pool's end. The book keeps using the
+    // old table until then.
+    bool StartOrderIndexRebuild() {
+        if (OrderIndex::BytesToHold(pool_.Size()) * 4 > orders_.AllocatedBytes()) return false;
+        indexRebuild_.emplace();
+        indexRebuild_->Reserve(pool_.Size());
+        indexRebuildCursor_ = 0;
+        return true;
+    }
+
+    // Returns false if deadline passed before the rebuild was swapped in.
+    bool ContinueOrderIndexRebuild(std::chrono::steady_clock::time_point deadline) {
+        std::size_t scanned = 0;
+        while ((indexRebuildCursor_ >> OrderPool::ChunkShift) < pool_.ChunkCount()) {
+            const std::size_t chunk = indexRebuildCursor_ >> OrderPool::ChunkShift;
+            if (indexRebuildCursor_ >= pool_.ChunkEnd(chunk)) {
+                indexRebuildCursor_ = OrderPool::ChunkBegin(chunk + 1);
+                continue;
+            }
+            if (++scanned % CompactionClockInterval == 0 && std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            if (pool_.IsLive(indexRebuildCursor_)) {
+                indexRebuild_->Insert(pool_.Get(indexRebuildCursor_).GetOrderId(), indexRebuildCursor_);
+            }
+            ++indexRebuildCursor_;
+        }
+        orders_ = std::move(*indexRebuild_);
+        indexRebuild_.reset();
+        return true;
+    }
+
+    // Gives back a buffer's capacity once it is far beyond what the book needs now.
+    template<typename T>
+    static void TrimBuffer(std::vector<T> &buffer, std::size_t needed) {
+        if (buffer.capacity() > std::max(BufferKeepCapacity, needed * 2)) buffer.shrink_to_fit();
+    }
+
+    // Whole checkpoint records between the read position and the end of the stream,
+    // or nullopt if the stream cannot seek.
+    static std::optional<std::uint64_t> CheckpointRecordsLeft(std::istream &in) {
+        const std::istream::pos_type here = in.tellg();
+        if (here == std::istream::pos_type(-1)) return std::nullopt;
+        in.seekg(0, std::ios::end);
+        const std::istream::pos_type end = in.tellg();
+        in.seekg(here);
+        if (!in || end == std::istream::pos_type(-1)) {
+            in.clear();
+            in.seekg(here);
+            return std::nullopt;
+        }
+        return static_cast<std::uint64_t>(end - here) / sizeof(CheckpointOrder);
+    }
+
+    // Drops every resting order and level; pool chunks are kept for reuse.
+    void ClearBook() {
+        TouchAllLevels();
+        bids_.Clear();
+        asks_.Clear();
+        orders_.Clear();
+        indexRebuild_.reset();
+        pool_.Clear();
+        goodForDayIds_.clear();
+        restingGoodForDay_ = 0;
+    }
+
+    // Cancels an order already taken out of the index, erasing its level if emptied.
+    void CancelExtracted(OrderHandle handle) {
+        // Copy the fields we need before the order's slot is released.
+        const Side side = pool_.Get(handle).GetSide();
+        const Price price = pool_.Get(handle).GetPrice();
+
+        // Unlinking from the level's FIFO queue is O(1) and leaves the relative
+        // order of everything else at that price untouched.
+        PriceLevel &level = LevelAt(side, price);
+        TouchLevel(side, price, &level);
+        level.Erase(pool_, handle);
+        ReleaseOrder(handle);
+        if (level.Empty()) {
+            if (side == Side::Sell) asks_.Erase(price);
+            else                    bids_.Erase(price);
+        }
+    }
+
+    OrderValidation ValidateOrder(const Order &order) const {
+        if (orders_.Contains(order.GetOrderId())) {
+            return OrderValidation::Reject(RejectReason::DuplicateOrderId);
+        }
+
+        // A market order only sweeps and never rests, so its extreme price need
+        // not fit the exchange's price grid or its own side's range.
+        Price orderPrice = order.GetPrice();
+        if (!order.IsMarket()) {
             if (!exchangeRules_.IsValidPrice(orderPrice)) {
                 return OrderValidation::Reject(RejectReason::InvalidPrice);
             }
+
+            const bool sideCanHold = (order.GetSide() == Side::Buy)
+                                         ? bids_.CanHold(orderPrice)
+                                         : asks_.CanHold(orderPrice);
+            if (!sideCanHold) {
+                return OrderValidation::Reject(RejectReason::PriceOutOfRange);
+            }
         }
 
-        if (!exchangeRules_.IsValidQuantity(order->GetRemainingQuantity())) {
-            if (order->GetRemainingQuantity() < exchangeRules_.minQuantity) {
+        if (!exchangeRules_.IsValidQuantity(order.GetRemainingQuantity())) {
+            if (order.GetRemainingQuantity() < exchangeRules_.minQuantity) {
                 return OrderValidation::Reject(RejectReason::BelowMinQuantity);
-            } else if (order->GetRemainingQuantity() > exchangeRules_.maxQuantity) {
+            } else if (order.GetRemainingQuantity() > exchangeRules_.maxQuantity) {
                 return OrderValidation::Reject(RejectReason::AboveMaxQuantity);
             } else {
                 return OrderValidation::Reject(RejectReason::InvalidQuantity);
             }
         }
 
-        if (!isConvertedMarketOrder) {
-            if (!exchangeRules_.IsValidNotional(order->GetPrice(), order->GetRemainingQuantity())) {
+        if (!order.IsMarket()) {
+            if (!exchangeRules_.IsValidNotional(order.GetPrice(), order.GetRemainingQuantity())) {
                 return OrderValidation::Reject(RejectReason::BelowMinNotional);
             }
         }
@@ -87,417 +457,1071 @@ private:
         return OrderValidation::Accept();
     }
 
-    void CheckAndResetDay() {
-        auto now = std::chrono::system_clock::now();
-        auto nowTime = std::chrono::system_clock::to_time_t(now);
-        auto lastResetTime = std::chrono::system_clock::to_time_t(lastDayReset_);
-
-        std::tm nowTm = *std::localtime(&nowTime);
+    // First session close strictly after timestampNs, in plain integer arithmetic.
+    std::int64_t NextDayResetAfter(std::int64_t timestampNs) const {
+        constexpr std::int64_t NanosPerMinute = 60'000'000'000LL;
+        constexpr std::int64_t NanosPerDay = 24 * 60 * NanosPerMinute;
+        const std::int64_t local = timestampNs + utcOffset_.count() * NanosPerMinute;
+        std::int64_t midnight = local / NanosPerDay * NanosPerDay;
+        if (midnight > local) midnight -= NanosPerDay; // floor for pre-epoch timestamps
+        std::int64_t reset = midnight + dayResetTime_.count() * NanosPerMinute;
+        if (reset <= local) reset += NanosPerDay;
+        return reset - utcOffset_.count() * NanosPerMinute;
+    }
 
-        std::tm todayResetTm = nowTm;
-        todayResetTm.tm_hour = dayResetHour_.count();
-        todayResetTm.tm_min = dayResetMinute_;
-        todayResetTm.tm_sec = 0;
-        auto todayResetTime = std::mktime(&todayResetTm);
+    // Feasibility check from the cached level totals: sums whole levels up to the
+    // limit price and never looks at individual orders.
+    bool CanFillCompletely(const Order &order) const {
+        const std::uint64_t wanted = order.GetRemainingQuantity();
+        std::uint64_t available = 0;
+        auto addLevel = [&](const PriceLevel &level) {
+            available += level.GetTotalQuantity();
+            return available < wanted;
+        };
 
-        if (lastResetTime < todayResetTime && nowTime >= todayResetTime) {
-            CancelGoodForDayOrders();
-            lastDayReset_ = now;
+        if (order.GetSide() == Side::Buy) {
+            asks_.ForEachLevel([&](Price askPrice, const PriceLevel &askLevel) {
+                return askPrice <= order.GetPrice() && addLevel(askLevel);
+            });
+        } else {
+            bids_.ForEachLevel([&](Price bidPrice, const PriceLevel &bidLevel) {
+                return bidPrice >= order.GetPrice() && addLevel(bidLevel);
+            });
         }
-    }
 
-    void CancelGoodForDayOrders() {
-        std::vector<OrderId> ordersToCancel;
-        for (const auto &[orderId, entry]: orders_) {
-            if (entry.order_->GetOrderType() == OrderType::GoodForDay) {
-                ordersToCancel.push_back(orderId);
-            }
-        }
-        for (const auto &orderId: ordersToCancel) {
-            CancelOrder(orderId);
-        }
+        return available >= wanted;
     }
 
-    std::vector<std::pair<OrderPointer, Quantity> > CollectMatchesForFillOrKill(
-        OrderPointer order,
-        Quantity &remainingQuantity) {
-
-        std::vector<std::pair<OrderPointer, Quantity> > matchingOrders;
-
-        if (order->GetSide() == Side::Buy) {
-            for (auto &[askPrice, askOrders]: asks_) {
-                if (askPrice > order->GetPrice()) break;
-                for (auto &ask: askOrders) {
-                    Quantity matchQty = std::min(remainingQuantity, ask->GetRemainingQuantity());
-                    matchingOrders.push_back({ask, matchQty});
-                    remainingQuantity -= matchQty;
-                    if (remainingQuantity == 0) break;
+    // Takes liquidity for an incoming order that is not in the book, best level first,
+    // until it is filled or the opposite side no longer crosses its limit. Filled
+    // resting orders are unlinked in the same pass; the order itself never rests.
+    template<typename TradeSink>
+    void Sweep(Order &order, TradeSink &sink) {
+        const bool isBuy = order.GetSide() == Side::Buy;
+        while (!order.IsFilled()) {
+            if (isBuy ? asks_.Empty() : bids_.Empty()) break;
+            const Price levelPrice = isBuy ? asks_.BestPrice() : bids_.BestPrice();
+            if (isBuy ? levelPrice > order.GetPrice() : levelPrice < order.GetPrice()) break;
+            PriceLevel &level = isBuy ? asks_.BestLevel() : bids_.BestLevel();
+            TouchLevel(isBuy ? Side::Sell : Side::Buy, levelPrice, &level);
+
+            while (!order.IsFilled() && !level.Empty()) {
+                const OrderHandle matchHandle = level.Front();
+                Order &matchOrder = pool_.Get(matchHandle);
+                Quantity quantity = std::min(order.GetRemainingQuantity(), matchOrder.GetRemainingQuantity());
+                order.Fill(quantity);
+                level.Fill(pool_, matchHandle, quantity);
+
+                if (isBuy) {
+                    sink(Trade{
+                        TradeInfo{order.GetOrderId(), levelPrice, quantity},
+                        TradeInfo{matchOrder.GetOrderId(), levelPrice, quantity}
+                    });
+                } else {
+                    sink(Trade{
+                        TradeInfo{matchOrder.GetOrderId(), levelPrice, quantity},
+                        TradeInfo{order.GetOrderId(), levelPrice, quantity}
+                    });
                 }
-                if (remainingQuantity == 0) break;
+
+                if (matchOrder.IsFilled()) RemoveOrder(level, matchHandle);
             }
-        } else {
-            for (auto &[bidPrice, bidOrders]: bids_) {
-                if (bidPrice < order->GetPrice()) break;
-                for (auto &bid: bidOrders) {
-                    Quantity matchQty = std::min(remainingQuantity, bid->GetRemainingQuantity());
-                    matchingOrders.push_back({bid, matchQty});
-                    remainingQuantity -= matchQty;
-                    if (remainingQuantity == 0) break;
-                }
-                if (remainingQuantity == 0) break;
+
+            if (level.Empty()) {
+                if (isBuy) asks_.Erase(levelPrice);
+                else       bids_.Erase(levelPrice);
             }
         }
+    }
 
-        return matchingOrders;
+    template<typename TradeSink>
+    void MatchFillOrKill(Order &order, TradeSink &sink) {
+        [[maybe_unused]] auto timer = phases_.Time(Phase::Match);
+        if (!CanFillCompletely(order)) return;
+        Sweep(order, sink);
     }
 
-    Trades ExecuteMatchesForFillOrKill(
-        OrderPointer order,
-        const std::vector<std::pair<OrderPointer, Quantity> > &matchingOrders) {
-        Trades trades;
+    // Trades are streamed into the sink as they happen; nothing is buffered here.
+    template<typename TradeSink>
+    void MatchOrders(TradeSink &sink) {
+        [[maybe_unused]] auto timer = phases_.Time(Phase::Match);
+        while (true) {
+            if (bids_.Empty() || asks_.Empty()) break;
 
-        for (auto &[matchOrder, quantity]: matchingOrders) {
-            Price tradePrice = matchOrder->GetPrice();
-            order->Fill(quantity);
-            matchOrder->Fill(quantity);
+            const Price bidPrice = bids_.BestPrice();
+            const Price askPrice = asks_.BestPrice();
+            PriceLevel &bids = bids_.BestLevel();
+            PriceLevel &asks = asks_.BestLevel();
 
-            if (order->GetSide() == Side::Buy) {
-                trades.push_back(Trade{
-                    TradeInfo{order->GetOrderId(), tradePrice, quantity},
-                    TradeInfo{matchOrder->GetOrderId(), tradePrice, quantity}
-                });
-            } else {
-                trades.push_back(Trade{
-                    TradeInfo{matchOrder->GetOrderId(), tradePrice, quantity},
-                    TradeInfo{order->GetOrderId(), tradePrice, quantity}
+            if (bidPrice < askPrice) break;
+            TouchLevel(Side::Buy, bidPrice, &bids);
+            TouchLevel(Side::Sell, askPrice, &asks);
+
+            // Both levels are FIFO queues: fully filled orders pop off the front in
+            // O(1), so nothing behind them has to be shifted or re-indexed.
+            while (!bids.Empty() && !asks.Empty()) {
+                const OrderHandle bidHandle = bids.Front();
+                const OrderHandle askHandle = asks.Front();
+                Order &bid = pool_.Get(bidHandle);
+                Order &ask = pool_.Get(askHandle);
+
+                Quantity quantity = std::min(bid.GetRemainingQuantity(), ask.GetRemainingQuantity());
+
+                // Level prices stand in for the orders' own: every order in a level
+                // shares it, so the price field is never read here.
+                const Price tradePrice = (ask.IsMarket() && !bid.IsMarket()) ? bidPrice : askPrice;
+
+                sink(Trade{
+                    TradeInfo{bid.GetOrderId(), tradePrice, quantity},
+                    TradeInfo{ask.GetOrderId(), tradePrice, quantity}
                 });
-            }
 
-            if (matchOrder->IsFilled()) {
-                CancelOrder(matchOrder->GetOrderId());
+                bids.Fill(pool_, bidHandle, quantity);
+                asks.Fill(pool_, askHandle, quantity);
+
+                if (bid.IsFilled()) RemoveOrder(bids, bidHandle);
+                if (ask.IsFilled()) RemoveOrder(asks, askHandle);
             }
+
+            if (bids.Empty()) bids_.Erase(bidPrice);
+            if (asks.Empty()) asks_.Erase(askPrice);
         }
+    }
 
-        return trades;
+    // Handlers shared by the MarketDataMessage and MarketDataEvent paths.
+    void ProcessNewOrder(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity) {
+        try {
+            std::size_t tradeCount = 0;
+            AddOrder(Order{
+                orderType, orderId, side, price, quantity
+            }, [&tradeCount](const Trade &) { ++tradeCount; });
+            Count(stats_.newOrders);
+            Count(stats_.trades, tradeCount);
+        } catch (const std::invalid_argument &) {
+            Count(stats_.errors);
+        }
     }
 
-    Trades MatchFillOrKill(OrderPointer order) {
-        Quantity remainingQuantity = order->GetRemainingQuantity();
-        auto matchingOrders = CollectMatchesForFillOrKill(order, remainingQuantity);
-        if (remainingQuantity > 0) return {};
-        return ExecuteMatchesForFillOrKill(order, matchingOrders);
+    void ProcessCancel(OrderId orderId) {
+        CancelOrder(orderId);
+        Count(stats_.cancellations);
     }
 
-    Trades MatchOrders(std::optional<OrderId> iocOrderId = {}) {
-        // No upfront reserve - the vast majority of AddOrder() calls (market maker
-        // quotes placed away from mid) produce zero trades. Reserving orders_.size()
-        // on every call was allocating ~25M times unnecessarily over a 1000yr run.
-        Trades trades;
+    void ProcessModify(OrderId orderId, Side side, Price newPrice, Quantity newQuantity) {
+        OrderModify modify(orderId, side, newPrice, newQuantity);
+        MatchOrder(modify, [](const Trade &) {});
+        Count(stats_.modifications);
+    }
 
-        while (true) {
-            if (bids_.empty() || asks_.empty()) break;
+    void ProcessTrade() {
+        Count(stats_.trades);
+    }
 
-            auto &[bidPrice, bids] = *bids_.begin();
-            auto &[askPrice, asks] = *asks_.begin();
+    // A kind byte outside EventKind means a corrupt or foreign record. It is thrown
+    // like the other malformed records, so the caller counts it as an error.
+    [[noreturn]] static void RejectEventKind(EventKind kind) {
+        throw std::invalid_argument(std::format("Unknown market data event kind {}", static_cast<int>(kind)));
+    }
 
-            if (bidPrice < askPrice) break;
+    void ProcessEvent(const MarketDataEvent &event) {
+        switch (event.kind) {
+            case EventKind::NewOrder:
+                ProcessNewOrder(event.GetOrderType(), event.orderId, event.GetSide(), event.price, event.quantity);
+                break;
+            case EventKind::CancelOrder: ProcessCancel(event.orderId); break;
+            case EventKind::ModifyOrder: ProcessModify(event.orderId, event.GetSide(), event.price, event.quantity); break;
+            case EventKind::Trade:       ProcessTrade(); break;
+            case EventKind::SnapshotBegin: BeginSnapshot(); break;
+            case EventKind::SnapshotLevel: AddSnapshotLevel(event.GetSide(), event.price, event.quantity); break;
+            case EventKind::SnapshotEnd:   EndSnapshot(event.orderId); break;
+            case EventKind::DepthBegin:
+            case EventKind::DepthLevel:
+            case EventKind::DepthEnd:      ApplyDepthRecord(event); break;
+            default:                       RejectEventKind(event.kind);
+        }
+    }
+
+    // Batch-mode handlers. Resting adds and re-priced modifies go straight into the
+    // book; if one of them crosses, crossed is set and matching is left to the end
+    // of the batch. Aggressive orders still match immediately, after the deferred
+    // crosses have been resolved so they see the same book a sequential run would.
+    void DeferNewOrder(OrderType orderType, OrderId orderId, Side side, Price price, Quantity quantity,
+                       bool &crossed) {
+        const bool rests = orderType == OrderType::GoodTillCancel ||
+                           orderType == OrderType::GoodForDay;
+        if (!rests) {
+            ResolveDeferredCross(crossed);
+            ProcessNewOrder(orderType, orderId, side, price, quantity);
+            return;
+        }
 
-            // Cursors into the front of each price level vector.
-            // Filled orders are collected and erased in one shot after the inner loop
-            // to avoid repeated O(n) shifts during matching.
-            std::size_t bidIdx = 0, askIdx = 0;
-            std::vector<OrderId> filledOrders;
+        try {
+            Order order{orderType, orderId, side, price, quantity};
+            Count(stats_.newOrders);
+            if (!ValidateOrder(order).isValid) return;
+            crossed = crossed || CanMatch(order.GetSide(), order.GetPrice());
+            InsertOrder(order);
+        } catch (const std::invalid_argument &) {
+            Count(stats_.errors);
+        }
+    }
 
-            while (bidIdx < bids.size() && askIdx < asks.size()) {
-                auto &bid = bids[bidIdx];
-                auto &ask = asks[askIdx];
+    void DeferModify(OrderId orderId, Side side, Price newPrice, Quantity newQuantity, bool &crossed) {
+        Count(stats_.modifications);
+        const OrderHandle handle = orders_.Find(orderId);
+        if (handle == OrderPool::InvalidHandle) return;
+        if (TryAmendInPlace(handle, side, newPrice, newQuantity)) return;
+
+        const OrderType existingType = pool_.Get(handle).GetOrderType();
+        orders_.Erase(orderId);
+        CancelExtracted(handle);
+        Order order = OrderModify(orderId, side, newPrice, newQuantity).ToOrder(existingType);
+        if (!ValidateOrder(order).isValid) return;
+        crossed = crossed || CanMatch(order.GetSide(), order.GetPrice());
+        InsertOrder(order);
+    }
 
-                Quantity quantity = std::min(bid->GetRemainingQuantity(), ask->GetRemainingQuantity());
+    void ResolveDeferredCross(bool &crossed) {
+        if (!crossed) return;
+        std::size_t tradeCount = 0;
+        auto countTrades = [&tradeCount](const Trade &) { ++tradeCount; };
+        MatchOrders(countTrades);
+        Count(stats_.trades, tradeCount);
+        crossed = false;
+    }
 
-                Price tradePrice;
-                bool bidIsMarket = (bid->GetPrice() == std::numeric_limits<Price>::max() ||
-                                    bid->GetPrice() == std::numeric_limits<Price>::min());
-                bool askIsMarket = (ask->GetPrice() == std::numeric_limits<Price>::max() ||
-                                    ask->GetPrice() == std::numeric_limits<Price>::min());
+    void DeferMessage(const MarketDataMessage &message, bool &crossed) {
+        if (auto *msg = std::get_if<NewOrderMessage>(&message)) {
+            DeferNewOrder(msg->orderType, msg->orderId, msg->side, msg->price, msg->quantity, crossed);
+        } else if (auto *msg = std::get_if<CancelOrderMessage>(&message)) {
+            ProcessCancel(msg->orderId);
+        } else if (auto *msg = std::get_if<ModifyOrderMessage>(&message)) {
+            DeferModify(msg->orderId, msg->side, msg->newPrice, msg->newQuantity, crossed);
+        } else if (std::holds_alternative<TradeMessage>(message)) {
+            ProcessTrade();
+        } else if (auto *msg = std::get_if<BookSnapshotMessage>(&message)) {
+            crossed = false; // the snapshot replaces whatever was pending
+            ProcessSnapshot(*msg);
+        } else if (auto *msg = std::get_if<DepthUpdateMessage>(&message)) {
+            ProcessDepthUpdate(*msg);
+        }
+    }
 
-                if (bidIsMarket && !askIsMarket)      tradePrice = ask->GetPrice();
-                else if (askIsMarket && !bidIsMarket) tradePrice = bid->GetPrice();
-                else                                  tradePrice = ask->GetPrice();
+    void DeferMessage(const MarketDataEvent &event, bool &crossed) {
+        switch (event.kind) {
+            case EventKind::NewOrder:
+                DeferNewOrder(event.GetOrderType(), event.orderId, event.GetSide(), event.price, event.quantity,
+                              crossed);
+                break;
+            case EventKind::CancelOrder: ProcessCancel(event.orderId); break;
+            case EventKind::ModifyOrder:
+                DeferModify(event.orderId, event.GetSide(), event.price, event.quantity, crossed);
+                break;
+            case EventKind::Trade: ProcessTrade(); break;
+            case EventKind::SnapshotBegin:
+                crossed = false; // the snapshot replaces whatever was pending
+                BeginSnapshot();
+                break;
+            case EventKind::SnapshotLevel: AddSnapshotLevel(event.GetSide(), event.price, event.quantity); break;
+            case EventKind::SnapshotEnd:   EndSnapshot(event.orderId); break;
+            case EventKind::DepthBegin:
+            case EventKind::DepthLevel:
+            case EventKind::DepthEnd:      ApplyDepthRecord(event); break;
+            default:                       RejectEventKind(event.kind);
+        }
+    }
 
-                trades.push_back(Trade{
-                    TradeInfo{bid->GetOrderId(), tradePrice, quantity},
-                    TradeInfo{ask->GetOrderId(), tradePrice, quantity}
-                });
+    template<typename Message>
+    size_t ProcessBatch(std::span<const Message> messages) {
+        if (messages.empty()) return 0;
 
-                bid->Fill(quantity);
-                ask->Fill(quantity);
+        const auto startTime = StartTimer();
+        size_t successCount = 0;
+        bool crossed = false;
+        std::array<std::uint64_t, MarketDataStats::MessageTypeCount> countByType{};
 
-                if (bid->IsFilled()) {
-                    filledOrders.push_back(bid->GetOrderId());
-                    ++bidIdx;
-                }
-                if (ask->IsFilled()) {
-                    filledOrders.push_back(ask->GetOrderId());
-                    ++askIdx;
+        for (const auto &message: messages) {
+            try {
+                DeferMessage(message, crossed);
+                successCount++;
+                if constexpr (Instrumentation::TimeMessages) {
+                    countByType[static_cast<std::size_t>(MessageTypeOf(message))]++;
                 }
+            } catch (...) {
+                Count(stats_.errors);
             }
+        }
 
-            // Remove filled orders from the lookup map
-            for (const auto &orderId: filledOrders) {
-                orders_.erase(orderId);
-            }
+        try {
+            ResolveDeferredCross(crossed);
+        } catch (...) {
+            Count(stats_.errors);
+        }
 
-            // Erase the consumed prefix from each vector in one shot.
-            // Remaining orders' indices in orders_ are now stale — fix them up.
-            if (bidIdx > 0) {
-                bids.erase(bids.begin(), bids.begin() + bidIdx);
-                for (std::size_t i = 0; i < bids.size(); ++i) {
-                    orders_.at(bids[i]->GetOrderId()).location_ = i;
-                }
-            }
-            if (askIdx > 0) {
-                asks.erase(asks.begin(), asks.begin() + askIdx);
-                for (std::size_t i = 0; i < asks.size(); ++i) {
-                    orders_.at(asks[i]->GetOrderId()).location_ = i;
+        Count(stats_.messagesProcessed, successCount);
+        if constexpr (Instrumentation::TimeMessages) {
+            const std::uint64_t perMessage = Clock::ToNanos(Clock::Now() - startTime) / messages.size();
+            for (std::size_t type = 0; type < countByType.size(); ++type) {
+                if (countByType[type]) {
+                    stats_.RecordLatency(static_cast<MessageType>(type), perMessage, countByType[type]);
                 }
             }
-
-            if (bids.empty()) bids_.erase(bidPrice);
-            if (asks.empty()) asks_.erase(askPrice);
         }
+        return successCount;
+    }
 
-        // Cancel any unfilled IOC remainder directly by ID — no book scan needed.
-        if (iocOrderId.has_value()) {
-            CancelOrder(iocOrderId.value());
-        }
+    static MessageType MessageTypeOf(const MarketDataMessage &message) { return GetMessageType(message); }
+    static MessageType MessageTypeOf(const MarketDataEvent &event) { return ToMessageType(event.kind); }
+
+    // Snapshots are applied in three steps so a record run (SnapshotBegin, levels,
+    // SnapshotEnd) can be streamed straight into the book without rebuilding a
+    // BookSnapshotMessage, and as a diff against the current book rather than a
+    // rebuild. Each snapshot level is written through RestateLevel, which makes it
+    // one synthetic order, leaving an unchanged level alone and restating the order
+    // in place when only the size moved. EndSnapshot then drops the levels the
+    // snapshot no longer lists. Prices seen since BeginSnapshot are collected in the
+    // snapshotPrices_ scratch buffers, and noted as best-first ordered while they
+    // arrive that way, as exchange feeds send them. Level and End records outside a
+    // run are rejected, so a stray one can neither overwrite L3 orders nor prune the
+    // book against a previous snapshot's prices.
+    void BeginSnapshot() {
+        for (auto &prices: snapshotPrices_) prices.clear();
+        snapshotOrdered_ = {true, true};
+        applyingSnapshot_ = true;
+    }
 
-        return trades;
+    void RequireSnapshotRun() const {
+        if (!applyingSnapshot_) throw std::invalid_argument("Snapshot record outside a SnapshotBegin..SnapshotEnd run");
     }
 
-    void ProcessNewOrder(const NewOrderMessage &msg) {
-        try {
-            auto order = std::make_shared<Order>(
-                msg.orderType, msg.orderId, msg.side, msg.price, msg.quantity
-            );
-            auto trades = AddOrder(order);
-            stats_.newOrders++;
-            stats_.trades += trades.size();
-        } catch (const std::invalid_argument &) {
-            stats_.errors++;
+    void AddSnapshotLevel(Side side, Price price, Quantity quantity) {
+        RequireSnapshotRun();
+        const bool canHold = (side == Side::Buy) ? bids_.CanHold(price) : asks_.CanHold(price);
+        if (quantity == 0 || !canHold) return;
+        RestateLevel(side, price, quantity);
+        const std::size_t index = (side == Side::Buy) ? 0 : 1;
+        auto &prices = snapshotPrices_[index];
+        if (!prices.empty() && !IsBetterPrice(side, prices.back(), price)) snapshotOrdered_[index] = false;
+        prices.push_back(price);
+    }
+
+    void EndSnapshot(std::uint64_t sequenceNumber) {
+        RequireSnapshotRun();
+        applyingSnapshot_ = false;
+        RemoveLevelsNotIn(bids_, Side::Buy, 0);
+        RemoveLevelsNotIn(asks_, Side::Sell, 1);
+        isInitialized_ = true;
+        lastSequenceNumber_ = sequenceNumber;
+        Count(stats_.snapshots);
+    }
+
+    static bool IsSynthetic(OrderId orderId) { return orderId >= SyntheticIdBase; }
+
+    // Makes the level at price hold exactly one synthetic order of the given size.
+    void RestateLevel(Side side, Price price, Quantity quantity) {
+        PriceLevel *level = (side == Side::Buy) ? bids_.Find(price) : asks_.Find(price);
+        if (level && level->GetOrderCount() == 1 && IsSynthetic(pool_.Get(level->Front()).GetOrderId())) {
+            if (level->GetTotalQuantity() != quantity) {
+                TouchLevel(side, price, level);
+                level->Restate(pool_, level->Front(), quantity);
+            }
+            return;
+        }
+        TouchLevel(side, price, level);
+        if (level) {
+            while (!level->Empty()) RemoveOrder(*level, level->Front());
+        } else {
+            level = (side == Side::Buy) ? &bids_.GetOrCreate(price) : &asks_.GetOrCreate(price);
         }
+        OrderHandle handle = pool_.Acquire(OrderType::GoodTillCancel, nextSyntheticId_++, side, price, quantity);
+        level->PushBack(pool_, handle);
+        IndexOrder(pool_.Get(handle).GetOrderId(), handle);
     }
 
-    void ProcessCancel(const CancelOrderMessage &msg) {
-        CancelOrder(msg.orderId);
-        stats_.cancellations++;
+    template<typename BookSideT>
+    void RemoveLevel(BookSideT &bookSide, Side side, Price price) {
+        if (PriceLevel *level = bookSide.Find(price)) {
+            TouchLevel(side, price, level);
+            while (!level->Empty()) RemoveOrder(*level, level->Front());
+            bookSide.Erase(price);
+        }
     }
 
-    void ProcessModify(const ModifyOrderMessage &msg) {
-        OrderModify modify(msg.orderId, msg.side, msg.newPrice, msg.newQuantity);
-        MatchOrder(modify);
-        stats_.modifications++;
+    static bool IsBetterPrice(Side side, Price lhs, Price rhs) {
+        return (side == Side::Buy) ? lhs > rhs : lhs < rhs;
     }
 
-    void ProcessTrade(const TradeMessage &msg) {
-        stats_.trades++;
+    // Every kept price has a level by now, so when the counts match there is nothing
+    // stale and the walk is skipped. Otherwise both sequences are best-first and one
+    // merge pass finds the levels to drop.
+    template<typename BookSideT>
+    void RemoveLevelsNotIn(BookSideT &bookSide, Side side, std::size_t index) {
+        auto &keep = snapshotPrices_[index];
+        if (!snapshotOrdered_[index]) {
+            std::sort(keep.begin(), keep.end(), [side](Price lhs, Price rhs) { return IsBetterPrice(side, lhs, rhs); });
+            keep.erase(std::unique(keep.begin(), keep.end()), keep.end());
+        }
+        if (bookSide.LevelCount() == keep.size()) return;
+
+        auto &stale = snapshotPrices_[2];
+        stale.clear();
+        auto next = keep.begin();
+        bookSide.ForEachLevel([&](Price price, const PriceLevel &) {
+            if (next != keep.end() && *next == price) {
+                ++next;
+            } else {
+                stale.push_back(price);
+            }
+            return true;
+        });
+        for (Price price: stale) RemoveLevel(bookSide, side, price);
     }
 
     void ProcessSnapshot(const BookSnapshotMessage &msg) {
-        bids_.clear();
-        asks_.clear();
-        orders_.clear();
-
-        OrderId syntheticId = 0x8000000000000000ULL;
+        BeginSnapshot();
+        for (const auto &level: msg.bids) AddSnapshotLevel(Side::Buy, level.price, level.quantity);
+        for (const auto &level: msg.asks) AddSnapshotLevel(Side::Sell, level.price, level.quantity);
+        EndSnapshot(msg.sequenceNumber);
+    }
 
-        for (const auto &level: msg.bids) {
-            if (level.quantity == 0) continue;
-            try {
-                auto order = std::make_shared<Order>(
-                    OrderType::GoodTillCancel, syntheticId++,
-                    Side::Buy, level.price, level.quantity
-                );
-                auto &orders = bids_[level.price];
-                orders.push_back(order);
-                orders_.insert({order->GetOrderId(), OrderEntry{order, orders.size() - 1}});
-            } catch (const std::invalid_argument &) { continue; }
-        }
-
-        for (const auto &level: msg.asks) {
-            if (level.quantity == 0) continue;
-            try {
-                auto order = std::make_shared<Order>(
-                    OrderType::GoodTillCancel, syntheticId++,
-                    Side::Sell, level.price, level.quantity
-                );
-                auto &orders = asks_[level.price];
-                orders.push_back(order);
-                orders_.insert({order->GetOrderId(), OrderEntry{order, orders.size() - 1}});
-            } catch (const std::invalid_argument &) { continue; }
+    // Depth updates continue the sequence of the last snapshot. An update wholly at
+    // or before lastSequenceNumber_ is stale and skipped. One starting past
+    // lastSequenceNumber_ + 1 means messages were lost: the gap is counted and the
+    // book stays uninitialized, ignoring depth updates, until the next snapshot.
+    bool BeginDepthUpdate(std::uint64_t firstSequence, std::uint64_t lastSequence) {
+        if (!isInitialized_ || lastSequence <= lastSequenceNumber_) return false;
+        if (firstSequence > lastSequenceNumber_ + 1) {
+            Count(stats_.sequenceGaps);
+            isInitialized_ = false;
+            return false;
         }
+        return true;
+    }
 
-        isInitialized_ = true;
-        lastSequenceNumber_ = msg.sequenceNumber;
-        stats_.snapshots++;
+    void EndDepthUpdate(std::uint64_t lastSequence) {
+        lastSequenceNumber_ = lastSequence;
+        Count(stats_.depthUpdates);
+    }
+
+    void ProcessDepthUpdate(const DepthUpdateMessage &msg) {
+        if (!BeginDepthUpdate(msg.firstSequence, msg.lastSequence)) return;
+        for (const auto &level: msg.bids) SetLevel(Side::Buy, level.price, level.quantity);
+        for (const auto &level: msg.asks) SetLevel(Side::Sell, level.price, level.quantity);
+        EndDepthUpdate(msg.lastSequence);
+    }
+
+    void ApplyDepthRecord(const MarketDataEvent &event) {
+        switch (event.kind) {
+            case EventKind::DepthBegin: applyingDepth_ = BeginDepthUpdate(event.orderId, event.otherOrderId); break;
+            case EventKind::DepthLevel:
+                if (applyingDepth_) SetLevel(event.GetSide(), event.price, event.quantity);
+                break;
+            case EventKind::DepthEnd:
+                if (applyingDepth_) EndDepthUpdate(event.otherOrderId);
+                applyingDepth_ = false;
+                break;
+            default: break;
+        }
     }
 
 public:
-    Orderbook()
-        : lastDayReset_(std::chrono::system_clock::now()) {
+    explicit BasicOrderbook(const BookSideConfig &config = {})
+        : bids_{config}
+          , asks_{config} {
     }
 
     void SetExchangeRules(const ExchangeRules &rules) { exchangeRules_ = rules; }
+
+    // Attaches a publisher that readers on other threads poll for the top levels of
+    // both sides (see TopOfBook.h), or detaches with nullptr. The book publishes once
+    // on attach and then after every update that changed those levels, always from
+    // the thread that calls into the book.
+    void SetTopOfBookPublisher(TopOfBookPublisher *publisher) {
+        topOfBook_ = publisher;
+        if (topOfBook_ != nullptr) topOfBook_->Publish(*this);
+    }
+
+    // Streams L2 deltas to sink (see LevelDelta.h) after every public call that changed
+    // a level's aggregate quantity or order count, or stops with an empty sink. The
+    // first update reports every level currently in the book, so a consumer can
+    // build its mirror from deltas alone. Deltas of one call are coalesced: a level
+    // a sweep hits many times, or that is emptied and refilled, is reported once, and
+    // not at all when it ends the call with the quantity and order count it started with.
+    // The sink runs on the calling thread and must not throw.
+    void SetLevelDeltaSink(LevelDeltaSink sink) {
+        [[maybe_unused]] UpdateScope update{*this};
+        touchedLevels_.clear();
+        levelDeltaSink_ = std::move(sink);
+        TouchAllLevels(true);
+    }
     const ExchangeRules &GetExchangeRules() const { return exchangeRules_; }
 
-    void SetDayResetTime(int hour, int minute = 59) {
+    // Session close for GoodForDay orders, in the session's local time given as an
+    // offset from UTC (the timestamps passed to AdvanceTime are UTC).
+    void SetDayResetTime(int hour, int minute = 59, std::chrono::minutes utcOffset = {}) {
         if (hour >= 0 && hour <= 23 && minute >= 0 && minute <= 59) {
-            dayResetHour_ = std::chrono::hours(hour);
-            dayResetMinute_ = minute;
+            dayResetTime_ = std::chrono::hours(hour) + std::chrono::minutes(minute);
+            utcOffset_ = utcOffset;
+            nextDayResetNs_ = NoDayReset;
         }
     }
 
-    // CheckAndResetDay() removed from hot path.
-    Trades AddOrder(OrderPointer order) {
-        if (order->GetOrderType() == OrderType::Market) {
-            if (order->GetSide() == Side::Buy && !asks_.empty()) {
-                order->ToGoodTillCancel(std::numeric_limits<Price>::max());
-            } else if (order->GetSide() == Side::Sell && !bids_.empty()) {
-                order->ToGoodTillCancel(std::numeric_limits<Price>::min());
-            } else {
-                return {};
-            }
+    // Moves the book's notion of time forward, typically to each message's timestamp.
+    // Crossing the session close cancels every resting GoodForDay order. The first call
+    // only arms the next close; between closes the cost is one comparison. Returns the
+    // number of orders expired.
+    std::size_t AdvanceTime(std::int64_t timestampNs) {
+        [[maybe_unused]] UpdateScope update{*this};
+        if (nextDayResetNs_ == NoDayReset) {
+            nextDayResetNs_ = NextDayResetAfter(timestampNs);
+            return 0;
+        }
+        if (timestampNs < nextDayResetNs_) return 0;
+        nextDayResetNs_ = NextDayResetAfter(timestampNs);
+        return ExpireGoodForDayOrders();
+    }
+
+    std::size_t AdvanceTime(std::chrono::system_clock::time_point timestamp) {
+        return AdvanceTime(MarketDataEvent::ToNanos(timestamp));
+    }
+
+    // Cancels every resting GoodForDay order now. Costs O(GoodForDay orders rested
+    // since the last expiry), independent of how many other orders rest.
+    std::size_t ExpireGoodForDayOrders() {
+        [[maybe_unused]] UpdateScope update{*this};
+        std::size_t expired = 0;
+        std::vector<OrderId> ids;
+        ids.swap(goodForDayIds_);
+        for (OrderId orderId: ids) {
+            if (!IsRestingGoodForDay(orderId)) continue;
+            CancelOrder(orderId);
+            ++expired;
         }
+        ids.clear();
+        goodForDayIds_.swap(ids); // keep the capacity
+        return expired;
+    }
 
-        auto validation = ValidateOrder(order);
-        if (!validation.isValid) return {};
+    // The order is copied into the pool; the caller's object is not referenced afterwards.
+    // Every resulting trade is handed to sink(const Trade &) as it executes, so the call
+    // itself never allocates; pass a lambda that appends to a reused buffer, counts, or
+    // forwards to a gateway.
+    template<typename TradeSink>
+    void AddOrder(Order order, TradeSink &&sink) {
+        [[maybe_unused]] UpdateScope update{*this};
+        switch (order.GetOrderType()) {
+            case OrderType::GoodTillCancel: AddOrder<OrderType::GoodTillCancel>(order, sink); break;
+            case OrderType::ImmediateOrCancel: AddOrder<OrderType::ImmediateOrCancel>(order, sink); break;
+            case OrderType::Market: AddOrder<OrderType::Market>(order, sink); break;
+            case OrderType::GoodForDay: AddOrder<OrderType::GoodForDay>(order, sink); break;
+            case OrderType::FillOrKill: AddOrder<OrderType::FillOrKill>(order, sink); break;
+        }
+    }
 
-        if (order->GetOrderType() == OrderType::ImmediateOrCancel &&
-            !CanMatch(order->GetSide(), order->GetPrice())) {
-            return {};
+    // Entry point specialised on the order type, for gateways that already know it;
+    // the order must be of that type. Market, ImmediateOrCancel and FillOrKill orders
+    // never rest: they sweep the opposite side directly and whatever is left unfilled
+    // is dropped, so their own side of the book and the order index are only read.
+    template<OrderType Type, typename TradeSink>
+    void AddOrder(Order order, TradeSink &&sink) {
+        [[maybe_unused]] UpdateScope update{*this};
+        if (order.GetOrderType() != Type) {
+            throw std::logic_error(std::format("Order ({}) does not match the entry point's order type",
+                                               order.GetOrderId()));
         }
 
-        if (order->GetOrderType() == OrderType::FillOrKill) {
-            return MatchFillOrKill(order);
+        if constexpr (Type == OrderType::Market) {
+            // An empty opposite side has nothing to trade against; the order is dropped.
+            const bool isBuy = order.GetSide() == Side::Buy;
+            if (isBuy ? asks_.Empty() : bids_.Empty()) return;
+            order.ToGoodTillCancel(isBuy ? std::numeric_limits<Price>::max() : std::numeric_limits<Price>::min());
         }
 
-        OrderPointers* ordersPtr;
+        OrderValidation validation;
+        {
+            [[maybe_unused]] auto timer = phases_.Time(Phase::Validate);
+            validation = ValidateOrder(order);
+        }
+        if (!validation.isValid) return;
 
-        if (order->GetSide() == Side::Buy) {
-            ordersPtr = &bids_[order->GetPrice()];
+        if constexpr (Type == OrderType::FillOrKill) {
+            MatchFillOrKill(order, sink);
+        } else if constexpr (Type == OrderType::Market || Type == OrderType::ImmediateOrCancel) {
+            [[maybe_unused]] auto timer = phases_.Time(Phase::Match);
+            Sweep(order, sink);
         } else {
-            ordersPtr = &asks_[order->GetPrice()];
+            InsertOrder(order);
+            MatchOrders(sink);
         }
+    }
 
-        ordersPtr->push_back(order);
-        orders_.insert({order->GetOrderId(), OrderEntry{order, ordersPtr->size() - 1}});
+    Trades AddOrder(Order order) {
+        Trades trades;
+        AddOrder(order, [&trades](const Trade &trade) { trades.push_back(trade); });
+        return trades;
+    }
 
-        // Pass the IOC order's ID so MatchOrders can cancel the unfilled remainder
-        // directly, without scanning the entire book.
-        const bool isIoc = (order->GetOrderType() == OrderType::ImmediateOrCancel);
-        return MatchOrders(isIoc ? order->GetOrderId() : std::optional<OrderId>{});
+    // Compatibility layer for callers that still hand over an OrderPointer. The book
+    // works on its own pooled copy; the caller's order is brought up to date with
+    // whatever filled on entry, but later fills against the resting copy are not
+    // mirrored back.
+    Trades AddOrder(OrderPointer order) {
+        auto trades = AddOrder(*order);
+        for (const auto &trade: trades) {
+            if (trade.GetBidTrade().orderId_ == order->GetOrderId()) {
+                order->Fill(trade.GetBidTrade().quantity_);
+            } else if (trade.GetAskTrade().orderId_ == order->GetOrderId()) {
+                order->Fill(trade.GetAskTrade().quantity_);
+            }
+        }
+        return trades;
     }
 
 
     void CancelOrder(OrderId orderId) {
-        if (!orders_.contains(orderId)) return;
-
-        // Copy the fields we need before erasing from orders_, since erasing
-        // destroys the OrderEntry and with it the shared_ptr keeping order alive.
-        const auto &entry = orders_.at(orderId);
-        const Side side = entry.order_->GetSide();
-        const Price price = entry.order_->GetPrice();
-        const std::size_t idx = entry.location_;
-        orders_.erase(orderId);
-
-        auto &orders = (side == Side::Sell)
-            ? asks_.at(price)
-            : bids_.at(price);
-
-        // Swap-and-pop: move the last element into the cancelled slot, then
-        // pop the back. This is O(1) and keeps the vector contiguous.
-        // We must update the swapped order's stored index to reflect its new position.
-        if (idx != orders.size() - 1) {
-            orders[idx] = std::move(orders.back());
-            orders_.at(orders[idx]->GetOrderId()).location_ = idx;
-        }
-        orders.pop_back();
-
-        if (side == Side::Sell) {
-            if (orders.empty()) asks_.erase(price);
-        } else {
-            if (orders.empty()) bids_.erase(price);
+        [[maybe_unused]] UpdateScope update{*this};
+        [[maybe_unused]] auto timer = phases_.Time(Phase::Cancel);
+        const OrderHandle handle = orders_.Extract(orderId); // the only index probe on this path
+        if (handle != OrderPool::InvalidHandle) CancelExtracted(handle);
+    }
+
+    // Sets the resting quantity at one price to an absolute value, as aggregated depth
+    // feeds report it; 0 removes the level. Whatever rested there is replaced by a
+    // single synthetic order, so only use this on books maintained from L2 data.
+    void SetLevel(Side side, Price price, Quantity quantity) {
+        [[maybe_unused]] UpdateScope update{*this};
+        const bool canHold = (side == Side::Buy) ? bids_.CanHold(price) : asks_.CanHold(price);
+        if (!canHold) return;
+        if (quantity == 0) {
+            if (side == Side::Buy) RemoveLevel(bids_, side, price);
+            else                   RemoveLevel(asks_, side, price);
+            return;
         }
+        RestateLevel(side, price, quantity);
+    }
+
+    // Amends a resting order. Reducing its size at the same price is done in place and
+    // keeps time priority; a price change, side change or size increase loses priority
+    // via cancel/replace, which revalidates and may match.
+    template<typename TradeSink>
+    void MatchOrder(OrderModify order, TradeSink &&sink) {
+        [[maybe_unused]] UpdateScope update{*this};
+        const OrderHandle handle = orders_.Find(order.GetOrderId());
+        if (handle == OrderPool::InvalidHandle) return;
+        if (TryAmendInPlace(handle, order.GetSide(), order.GetPrice(), order.GetQuantity())) return;
+
+        // Copy the order type before the slot is released.
+        const OrderType existingType = pool_.Get(handle).GetOrderType();
+        orders_.Erase(order.GetOrderId());
+        CancelExtracted(handle);
+        AddOrder(order.ToOrder(existingType), sink);
     }
 
-    // CheckAndResetDay() removed from hot path.
     Trades MatchOrder(OrderModify order) {
-        if (!orders_.contains(order.GetOrderId())) return {};
-        // Copy the order type before CancelOrder erases the entry and destroys the shared_ptr.
-        const OrderType existingType = orders_.at(order.GetOrderId()).order_->GetOrderType();
-        CancelOrder(order.GetOrderId());
-        return AddOrder(order.ToOrderPointer(existingType));
+        Trades trades;
+        MatchOrder(order, [&trades](const Trade &trade) { trades.push_back(trade); });
+        return trades;
     }
 
-    std::size_t Size() const { return orders_.size(); }
+    std::size_t Size() const { return orders_.Size(); }
 
+    // Full depth of both sides. Costs O(levels), not O(orders), since every level
+    // keeps its own totals; prefer GetTopLevels when only the top of book matters.
     OrderbookLevelInfos GetOrderInfos() const {
         LevelInfos bidInfos, askInfos;
-        bidInfos.reserve(orders_.size());
-        askInfos.reserve(orders_.size());
-
-        auto CreateLevelInfos = [](Price price, const OrderPointers &orders) {
-            return LevelInfo{
-                price, std::accumulate(orders.begin(), orders.end(), (Quantity)0,
-                    [](std::size_t runningSum, const OrderPointer &order) {
-                        return runningSum + order->GetRemainingQuantity();
-                    })
-            };
-        };
+        bidInfos.reserve(bids_.LevelCount());
+        askInfos.reserve(asks_.LevelCount());
 
-        for (const auto &[price, orders]: bids_) {
-            bidInfos.push_back(CreateLevelInfos(price, orders));
-        }
-        for (const auto &[price, orders]: asks_) {
-            askInfos.push_back(CreateLevelInfos(price, orders));
-        }
+        bids_.ForEachLevel([&](Price price, const PriceLevel &level) {
+            bidInfos.push_back(LevelInfo{price, level.GetTotalQuantity(), level.GetOrderCount()});
+            return true;
+        });
+        asks_.ForEachLevel([&](Price price, const PriceLevel &level) {
+            askInfos.push_back(LevelInfo{price, level.GetTotalQuantity(), level.GetOrderCount()});
+            return true;
+        });
 
         return OrderbookLevelInfos(bidInfos, askInfos);
     }
 
+    // Copies up to out.size() best levels of one side into a caller-owned buffer and
+    // returns how many were written. Touches only those levels and never allocates.
+    std::size_t GetTopLevels(Side side, std::span<LevelInfo> out) const {
+        std::size_t count = 0;
+        auto copyLevel = [&](Price price, const PriceLevel &level) {
+            if (count == out.size()) return false;
+            out[count++] = LevelInfo{price, level.GetTotalQuantity(), level.GetOrderCount()};
+            return true;
+        };
+
+        if (side == Side::Buy) bids_.ForEachLevel(copyLevel);
+        else                   asks_.ForEachLevel(copyLevel);
+        return count;
+    }
+
+    // Same, into separate price and quantity arrays (the layout DepthKernels.h works
+    // on); copies up to the shorter of the two spans.
+    std::size_t GetTopLevels(Side side, std::span<Price> prices, std::span<Quantity> quantities) const {
+        const std::size_t capacity = std::min(prices.size(), quantities.size());
+        std::size_t count = 0;
+        auto copyLevel = [&](Price price, const PriceLevel &level) {
+            if (count == capacity) return false;
+            prices[count] = price;
+            quantities[count++] = level.GetTotalQuantity();
+            return true;
+        };
+
+        if (side == Side::Buy) bids_.ForEachLevel(copyLevel);
+        else                   asks_.ForEachLevel(copyLevel);
+        return count;
+    }
+
+    std::size_t GetLevelCount(Side side) const {
+        return (side == Side::Buy) ? bids_.LevelCount() : asks_.LevelCount();
+    }
+
     bool ProcessMarketData(const MarketDataMessage &message) {
-        auto startTime = std::chrono::high_resolution_clock::now();
+        [[maybe_unused]] UpdateScope update{*this};
+        const auto startTime = StartTimer();
         try {
             std::visit([this](auto &&msg) {
                 using T = std::decay_t<decltype(msg)>;
-                if constexpr (std::is_same_v<T, NewOrderMessage>)         ProcessNewOrder(msg);
-                else if constexpr (std::is_same_v<T, CancelOrderMessage>) ProcessCancel(msg);
-                else if constexpr (std::is_same_v<T, ModifyOrderMessage>) ProcessModify(msg);
-                else if constexpr (std::is_same_v<T, TradeMessage>)       ProcessTrade(msg);
+                if constexpr (std::is_same_v<T, NewOrderMessage>)
+                    ProcessNewOrder(msg.orderType, msg.orderId, msg.side, msg.price, msg.quantity);
+                else if constexpr (std::is_same_v<T, CancelOrderMessage>) ProcessCancel(msg.orderId);
+                else if constexpr (std::is_same_v<T, ModifyOrderMessage>)
+                    ProcessModify(msg.orderId, msg.side, msg.newPrice, msg.newQuantity);
+                else if constexpr (std::is_same_v<T, TradeMessage>)       ProcessTrade();
                 else if constexpr (std::is_same_v<T, BookSnapshotMessage>) ProcessSnapshot(msg);
+                else if constexpr (std::is_same_v<T, DepthUpdateMessage>)  ProcessDepthUpdate(msg);
             }, message);
 
-            auto endTime = std::chrono::high_resolution_clock::now();
-            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
-            stats_.messagesProcessed++;
-            stats_.totalProcessingTime += latency;
-            stats_.maxLatency = std::max(stats_.maxLatency, latency);
-            stats_.minLatency = std::min(stats_.minLatency, latency);
+            Count(stats_.messagesProcessed);
+            RecordLatency(GetMessageType(message), startTime);
             return true;
         } catch (...) {
-            stats_.errors++;
+            Count(stats_.errors);
             return false;
         }
     }
 
-    size_t ProcessMarketDataBatch(const std::vector<MarketDataMessage> &messages) {
-        size_t successCount = 0;
-        for (const auto &msg: messages) {
-            if (ProcessMarketData(msg)) successCount++;
+    // Applies a whole batch in one pass. The clock is read once per batch and every
+    // message is charged the batch's average latency. Resting adds, cancels and
+    // modifies skip the per-message matching pass; any cross they create is matched
+    // once at the end of the batch (or just before the next aggressive order), so
+    // within a batch a crossing limit order trades at the end rather than on arrival.
+    size_t ProcessMarketDataBatch(std::span<const MarketDataMessage> messages) {
+        [[maybe_unused]] UpdateScope update{*this};
+        return ProcessBatch(messages);
+    }
+
+    // Compact-event path: same semantics as the MarketDataMessage overloads, but
+    // dispatches on the event's kind byte instead of visiting a variant.
+    bool ProcessMarketData(const MarketDataEvent &event) {
+        [[maybe_unused]] UpdateScope update{*this};
+        const auto startTime = StartTimer();
+        try {
+            ProcessEvent(event);
+
+            Count(stats_.messagesProcessed);
+            RecordLatency(ToMessageType(event.kind), startTime);
+            return true;
+        } catch (...) {
+            Count(stats_.errors);
+            return false;
         }
-        return successCount;
+    }
+
+    size_t ProcessMarketDataBatch(std::span<const MarketDataEvent> events) {
+        [[maybe_unused]] UpdateScope update{*this};
+        return ProcessBatch(events);
+    }
+
+    // Rests a batch of orders without matching, for start-of-day books and deep
+    // snapshot recovery. Each order is validated as AddOrder would. The distinct
+    // price levels of the batch are collected and sorted once, best first, and each
+    // is looked up or created once; orders are then appended in input order, which
+    // becomes their queue order within a price. The pool and index are reserved for
+    // the final size. Orders that cannot rest (Market, ImmediateOrCancel, FillOrKill),
+    // fail validation or repeat an id are skipped. Throws std::invalid_argument,
+    // leaving the book unchanged, if the result would be crossed. Returns the number
+    // of orders rested. Repeated ids are dropped during validation, so only the
+    // first copy of an id shapes the levels and the cross check.
+    std::size_t BulkLoad(std::span<const OrderSpec> specs) {
+        [[maybe_unused]] UpdateScope update{*this};
+        struct BatchLevel {
+            Side side;
+            Price price;
+            PriceLevel *level;
+        };
+        std::vector<BatchLevel> levels;
+        std::unordered_map<std::uint64_t, std::uint32_t> levelOf; // side and price -> index into levels
+        std::vector<std::pair<const OrderSpec *, std::uint32_t> > accepted;
+        accepted.reserve(specs.size());
+        FlatOrderIndex batchIds(specs.size()); // ids accepted so far; ValidateOrder covers resting ones
+
+        Price bestBid = bids_.Empty() ? std::numeric_limits<Price>::min() : bids_.BestPrice();
+        Price bestAsk = asks_.Empty() ? std::numeric_limits<Price>::max() : asks_.BestPrice();
+        {
+            [[maybe_unused]] auto timer = phases_.Time(Phase::Validate);
+            for (const OrderSpec &spec: specs) {
+                if (spec.orderType == OrderType::Market || spec.orderType == OrderType::ImmediateOrCancel ||
+                    spec.orderType == OrderType::FillOrKill || spec.quantity == 0) {
+                    continue;
+                }
+                if (!ValidateOrder(spec.ToOrder()).isValid) continue;
+                if (batchIds.Contains(spec.orderId)) continue; // repeated within the batch
+                batchIds.Insert(spec.orderId, 0);
+
+                const std::uint64_t key = (static_cast<std::uint64_t>(spec.side) << 32) |
+                                          static_cast<std::uint32_t>(spec.price);
+                auto [it, isNew] = levelOf.try_emplace(key, static_cast<std::uint32_t>(levels.size()));
+                if (isNew) levels.push_back(BatchLevel{spec.side, spec.price, nullptr});
+                accepted.emplace_back(&spec, it->second);
+
+                if (spec.side == Side::Buy) bestBid = std::max(bestBid, spec.price);
+                else                        bestAsk = std::min(bestAsk, spec.price);
+            }
+        }
+        if (bestBid >= bestAsk) throw std::invalid_argument("BulkLoad would leave the book crossed");
+
+        // Levels are created best first, so an ordered side sees them in sequence.
+        std::vector<std::uint32_t> creationOrder(levels.size());
+        std::iota(creationOrder.begin(), creationOrder.end(), 0);
+        std::sort(creationOrder.begin(), creationOrder.end(), [&levels](std::uint32_t lhs, std::uint32_t rhs) {
+            if (levels[lhs].side != levels[rhs].side) return levels[lhs].side == Side::Buy;
+            return (levels[lhs].side == Side::Buy) ? levels[lhs].price > levels[rhs].price
+                                                   : levels[lhs].price < levels[rhs].price;
+        });
+        for (std::uint32_t index: creationOrder) {
+            BatchLevel &batchLevel = levels[index];
+            batchLevel.level = (batchLevel.side == Side::Buy) ? &bids_.GetOrCreate(batchLevel.price)
+                                                              : &asks_.GetOrCreate(batchLevel.price);
+            TouchLevel(batchLevel.side, batchLevel.price, batchLevel.level);
+        }
+
+        pool_.Reserve(pool_.Size() + accepted.size());
+        orders_.Reserve(orders_.Size() + accepted.size());
+        std::size_t loaded = 0;
+        for (const auto &[spec, levelIndex]: accepted) {
+            AppendResting(*levels[levelIndex].level, spec->ToOrder());
+            ++loaded;
+        }
+        return loaded;
+    }
+
+    // Writes the full L3 state as a binary image (format in Checkpoint.h): every
+    // resting order in queue order, the sequence number, exchange rules, session
+    // close and message counters. Throws std::runtime_error if the write fails.
+    void SaveCheckpoint(std::ostream &out) const {
+        CheckpointHeader header = CheckpointHeader::Make();
+        header.orderCount = orders_.Size();
+        header.lastSequenceNumber = lastSequenceNumber_;
+        header.nextSyntheticId = nextSyntheticId_;
+        header.nextDayResetNs = nextDayResetNs_;
+        header.dayResetMinutes = static_cast<std::int32_t>(dayResetTime_.count());
+        header.utcOffsetMinutes = static_cast<std::int32_t>(utcOffset_.count());
+        header.isInitialized = isInitialized_;
+        const CheckpointCounters counters = CheckpointCounters::From(stats_);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(&exchangeRules_), sizeof(exchangeRules_));
+        out.write(reinterpret_cast<const char *>(&counters), sizeof(counters));
+
+        std::vector<CheckpointOrder> buffer;
+        buffer.reserve(std::min<std::size_t>(orders_.Size(), CheckpointBufferRecords));
+        auto flush = [&] {
+            out.write(reinterpret_cast<const char *>(buffer.data()),
+                      static_cast<std::streamsize>(buffer.size() * sizeof(CheckpointOrder)));
+            buffer.clear();
+        };
+        auto writeLevel = [&](Price, const PriceLevel &level) {
+            for (OrderHandle handle = level.Front(); handle != OrderPool::InvalidHandle; handle = pool_.Next(handle)) {
+                buffer.push_back(CheckpointOrder::From(pool_.Get(handle)));
+                if (buffer.size() == CheckpointBufferRecords) flush();
+            }
+            return true;
+        };
+        bids_.ForEachLevel(writeLevel);
+        asks_.ForEachLevel(writeLevel);
+        flush();
+
+        out.flush();
+        if (!out) throw std::runtime_error("Checkpoint write failed");
+    }
+
+    void SaveCheckpoint(const std::filesystem::path &path) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot open checkpoint file: " + path.string());
+        SaveCheckpoint(out);
+    }
+
+    // Replaces the book with a checkpoint image. Orders are linked straight into their
+    // levels in the saved queue order, with no validation against the exchange rules
+    // and no matching, so restoring costs about one pool slot and one index insert
+    // per order. Throws std::runtime_error on a foreign, truncated or corrupt image,
+    // leaving the book empty.
+    void LoadCheckpoint(std::istream &in) {
+        [[maybe_unused]] UpdateScope update{*this};
+        CheckpointHeader header{};
+        ExchangeRules rules;
+        CheckpointCounters counters{};
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!in || !header.IsValid()) throw std::runtime_error("Not a compatible checkpoint image");
+        in.read(reinterpret_cast<char *>(&rules), sizeof(rules));
+        in.read(reinterpret_cast<char *>(&counters), sizeof(counters));
+        if (!in) throw std::runtime_error("Truncated checkpoint image");
+
+        ClearBook();
+        try {
+            // orderCount is only a claim until the records are read: check it against
+            // what the stream still holds before sizing the pool and index by it. A
+            // stream that cannot say gets a capped reservation and the read loop finds
+            // any truncation.
+            const std::optional<std::uint64_t> recordsLeft = CheckpointRecordsLeft(in);
+            if (header.orderCount >= OrderPool::InvalidHandle - 1 ||
+                (recordsLeft && header.orderCount > *recordsLeft)) {
+                throw std::runtime_error("Checkpoint order count exceeds the image");
+            }
+            const std::size_t reserve = static_cast<std::size_t>(
+                recordsLeft ? header.orderCount : std::min<std::uint64_t>(header.orderCount, UncheckedReserveLimit));
+            pool_.Reserve(reserve);
+            orders_.Reserve(reserve);
+
+            std::vector<CheckpointOrder> buffer(std::min<std::uint64_t>(header.orderCount, CheckpointBufferRecords));
+            PriceLevel *level = nullptr;
+            Side levelSide = Side::Buy;
+            Price levelPrice = 0;
+            for (std::uint64_t loaded = 0; loaded < header.orderCount;) {
+                const std::size_t count = static_cast<std::size_t>(
+                    std::min<std::uint64_t>(header.orderCount - loaded, buffer.size()));
+                in.read(reinterpret_cast<char *>(buffer.data()),
+                        static_cast<std::streamsize>(count * sizeof(CheckpointOrder)));
+                if (!in) throw std::runtime_error("Truncated checkpoint image");
+
+                // Records arrive grouped by level, so each level is looked up once.
+                for (std::size_t i = 0; i < count; ++i) {
+                    const Order order = buffer[i].ToOrder();
+                    const Side side = order.GetSide();
+                    const Price price = order.GetPrice();
+                    if (level == nullptr || side != levelSide || price != levelPrice) {
+                        const bool canHold = (side == Side::Buy) ? bids_.CanHold(price) : asks_.CanHold(price);
+                        if (!canHold) throw std::runtime_error("Checkpoint price outside this book's range");
+                        level = (side == Side::Buy) ? &bids_.GetOrCreate(price) : &asks_.GetOrCreate(price);
+                        levelSide = side;
+                        levelPrice = price;
+                        TouchLevel(side, price, level);
+                    }
+                    if (orders_.Contains(order.GetOrderId())) {
+                        throw std::runtime_error("Duplicate order id in checkpoint image");
+                    }
+                    AppendResting(*level, order);
+                }
+                loaded += count;
+            }
+        } catch (...) {
+            ClearBook();
+            throw;
+        }
+
+        exchangeRules_ = rules;
+        lastSequenceNumber_ = header.lastSequenceNumber;
+        isInitialized_ = header.isInitialized != 0;
+        nextSyntheticId_ = header.nextSyntheticId;
+        nextDayResetNs_ = header.nextDayResetNs;
+        dayResetTime_ = std::chrono::minutes{header.dayResetMinutes};
+        utcOffset_ = std::chrono::minutes{header.utcOffsetMinutes};
+        stats_.Reset();
+        phases_.Reset();
+        counters.ApplyTo(stats_);
+    }
+
+    void LoadCheckpoint(const std::filesystem::path &path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open checkpoint file: " + path.string());
+        LoadCheckpoint(in);
+    }
+
+    // Bytes the book holds, by component (see MemoryUsage.h).
+    MemoryUsage GetMemoryUsage() const {
+        MemoryUsage usage;
+        usage.levels = bids_.AllocatedBytes() + asks_.AllocatedBytes();
+        usage.orderIndex = orders_.AllocatedBytes() + (indexRebuild_ ? indexRebuild_->AllocatedBytes() : 0);
+        usage.orders = pool_.Size() * OrderPool::SlotBytes();
+        usage.pools = pool_.AllocatedBytes() - usage.orders;
+        usage.buffers = goodForDayIds_.capacity() * sizeof(OrderId) +
+                        touchedLevels_.capacity() * sizeof(TouchedLevel) +
+                        levelDeltas_.capacity() * sizeof(LevelDelta);
+        for (const auto &prices: snapshotPrices_) usage.buffers += prices.capacity() * sizeof(Price);
+        return usage;
+    }
+
+    // Hands memory left over from a busier period back to the heap, one bounded slice
+    // per call, so a long-running book can run it between messages. Works until
+    // budget has passed (but always makes some progress) and returns true once there
+    // is nothing left to reclaim. Activity afterwards can create more work, so call it
+    // again after the next quiet period. In order:
+    //   1. While the pool has two chunks' worth of free slots, drain its top chunk by
+    //      moving those orders into free slots below, then free the chunk. Orders keep
+    //      their queue position and ids; only their slot changes. The scan checks the
+    //      clock every CompactionClockInterval slots and resumes in the next slice.
+    //   2. Trim the pool's tables, then rebuild the order index if it is four times
+    //      the size a fresh one would be. The rebuild walks the pool, not the old
+    //      table, and like the drain checks the clock as it goes and resumes in the
+    //      next slice (see StartOrderIndexRebuild). Two steps are not split: sizing
+    //      the fresh table, which costs what the book holds now, and handing the old
+    //      one back to the heap at the swap, which costs what it held at the peak
+    //      (about 1 ms for a 32 MiB table, mostly the kernel unmapping it).
+    //   3. Drop stale GoodForDay ids and trim buffers sized for a much larger book.
+    //      The deadline is checked before each of these steps.
+    bool Compact(std::chrono::nanoseconds budget) {
+        const auto deadline = std::chrono::steady_clock::now() + budget;
+        std::size_t scanned = 0;
+        while (pool_.Capacity() - pool_.Size() >= 2 * OrderPool::ChunkSize) {
+            const std::size_t top = pool_.ChunkCount() - 1;
+            if (compactCursor_ < OrderPool::ChunkBegin(top) || compactCursor_ >= pool_.ChunkEnd(top)) {
+                compactCursor_ = OrderPool::ChunkBegin(top);
+            }
+            while (pool_.LiveInChunk(top) != 0) {
+                if (++scanned % CompactionClockInterval == 0 && std::chrono::steady_clock::now() >= deadline) {
+                    return false;
+                }
+                if (pool_.IsLive(compactCursor_)) RelocateOrder(compactCursor_);
+                if (++compactCursor_ == pool_.ChunkEnd(top)) compactCursor_ = OrderPool::ChunkBegin(top);
+            }
+            pool_.ReleaseTopChunk();
+        }
+        auto pastDeadline = [&] { return std::chrono::steady_clock::now() >= deadline; };
+        if (scanned > 0 && pastDeadline()) return false;
+
+        pool_.ShrinkToFit();
+        if (indexRebuild_ || StartOrderIndexRebuild()) {
+            if (!ContinueOrderIndexRebuild(deadline) || pastDeadline()) return false;
+        }
+        if (goodForDayIds_.size() > restingGoodForDay_ * 2) {
+            DropStaleGoodForDayIds();
+            if (pastDeadline()) return false;
+        }
+        TrimBuffer(goodForDayIds_, goodForDayIds_.size());
+        const std::size_t levelCount = bids_.LevelCount() + asks_.LevelCount();
+        TrimBuffer(touchedLevels_, levelCount);
+        TrimBuffer(levelDeltas_, levelCount);
+        for (auto &prices: snapshotPrices_) TrimBuffer(prices, std::max(prices.size(), levelCount));
+        return true;
     }
 
     const MarketDataStats &GetMarketDataStats() const { return stats_; }
-    void ResetMarketDataStats() { stats_.Reset(); }
+    void ResetMarketDataStats() {
+        stats_.Reset();
+        phases_.Reset();
+    }
+
+    // Time spent in each phase of order handling; only with TimePhases instrumentation.
+    const LatencyHistogram &GetPhaseLatency(Phase phase) const requires Instrumentation::TimePhases {
+        return phases_.Get(phase);
+    }
     bool IsInitialized() const { return isInitialized_; }
     uint64_t GetLastSequenceNumber() const { return lastSequenceNumber_; }
-};
\ No newline at end of file
+};
+
+using Orderbook = BasicOrderbook<MapBookSide>;
+using LadderOrderbook = BasicOrderbook<LadderBookSide>;
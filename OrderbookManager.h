@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "MarketDataFeed.h"
+#include "MarketDataPipeline.h"
+#include "MemoryUsage.h"
+#include "OrderBook.h"
+#include "SpscQueue.h"
+#include "ThreadAffinity.h"
+
+using SymbolId = std::uint32_t; // dense index assigned by OrderbookManager::AddSymbol
+
+class OrderbookManager {
+    // Owns one Orderbook per symbol and spreads them over worker threads ("shards").
+    // Symbols are assigned to shards round-robin as they are added and never move, so
+    // each book is only ever touched by its shard's thread and books need no locking.
+    // Route hands a message to the owning shard through that shard's SPSC ring; like
+    // MarketDataPipeline it never blocks and counts a drop when the ring is full.
+    //
+    // Route must be called from a single feed thread. Register symbols before Start();
+    // books may be read through GetBook only while the manager is stopped.
+public:
+    using OnApplied = std::function<void(SymbolId, const Orderbook &, const MarketDataMessage &)>;
+
+    explicit OrderbookManager(std::size_t shardCount = std::max(1u, std::thread::hardware_concurrency()),
+                              std::size_t queueCapacity = 65536) {
+        if (shardCount == 0) throw std::invalid_argument("OrderbookManager needs at least one shard");
+        shards_.reserve(shardCount);
+        for (std::size_t i = 0; i < shardCount; ++i) {
+            shards_.push_back(std::make_unique<Shard>(books_, queueCapacity));
+        }
+    }
+
+    ~OrderbookManager() { Stop(); }
+
+    OrderbookManager(const OrderbookManager &) = delete;
+    OrderbookManager &operator=(const OrderbookManager &) = delete;
+
+    // Registers a symbol (or returns its existing id). Not allowed while running.
+    SymbolId AddSymbol(const std::string &symbol) {
+        if (auto it = symbols_.find(symbol); it != symbols_.end()) return it->second;
+        if (running_) throw std::logic_error("Cannot add symbols while the manager is running");
+
+        const SymbolId id = static_cast<SymbolId>(books_.size());
+        books_.push_back(std::make_unique<Orderbook>());
+        names_.push_back(symbol);
+        symbols_.emplace(symbol, id);
+        return id;
+    }
+
+    // Runs on the owning shard's thread after each routed message is applied, like
+    // MarketDataPipeline's callback. Set before Start().
+    void SetOnApplied(OnApplied callback) {
+        if (running_) throw std::logic_error("Cannot change callbacks while the manager is running");
+        for (auto &shard: shards_) shard->onApplied_ = callback;
+    }
+
+    // Once a shard's ring has stayed empty past the spin limit, it sleeps this long
+    // between polls instead of yielding, so an idle shard gives its core back at the
+    // cost of up to one sleep of latency on the next message. Zero, the default,
+    // keeps yielding. Set before Start().
+    void SetIdleSleep(std::chrono::microseconds sleep) {
+        if (running_) throw std::logic_error("Cannot change the idle sleep while the manager is running");
+        for (auto &shard: shards_) shard->idleSleep_ = sleep;
+    }
+
+    std::optional<SymbolId> FindSymbol(const std::string &symbol) const {
+        auto it = symbols_.find(symbol);
+        if (it == symbols_.end()) return std::nullopt;
+        return it->second;
+    }
+
+    // Starts one worker per shard. With pinCores, shard i runs on CPU i modulo the
+    // number of hardware threads.
+    void Start(bool pinCores = true) {
+        if (running_) return;
+        running_ = true;
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < shards_.size(); ++i) {
+            shards_[i]->Start();
+            if (pinCores) PinThreadToCpu(shards_[i]->worker_, static_cast<unsigned>(i % cores));
+        }
+    }
+
+    // Stops every shard after it has drained what was already routed to it.
+    void Stop() {
+        if (!running_) return;
+        for (auto &shard: shards_) shard->Stop();
+        running_ = false;
+    }
+
+    // Returns false when the owning ring is full or, like the by-name overload, when
+    // the id was never registered; an unknown id must not reach the worker.
+    bool Route(SymbolId symbol, MarketDataMessage message) {
+        if (symbol >= books_.size()) return false;
+        return shards_[ShardOf(symbol)]->Publish(symbol, std::move(message));
+    }
+
+    bool Route(const std::string &symbol, MarketDataMessage message) {
+        auto id = FindSymbol(symbol);
+        if (!id) return false;
+        return Route(*id, std::move(message));
+    }
+
+    const Orderbook &GetBook(SymbolId symbol) const { return *books_.at(symbol); }
+    Orderbook &GetBook(SymbolId symbol) { return *books_.at(symbol); } // e.g. to set sinks before Start()
+    const std::string &GetSymbolName(SymbolId symbol) const { return names_.at(symbol); }
+
+    std::size_t SymbolCount() const { return books_.size(); }
+    std::size_t ShardCount() const { return shards_.size(); }
+    std::size_t ShardOf(SymbolId symbol) const { return symbol % shards_.size(); }
+
+    PipelineStats GetShardStats(std::size_t shard) const { return shards_.at(shard)->GetStats(); }
+
+    // Bytes held by all books together; like GetBook, only while stopped.
+    MemoryUsage GetMemoryUsage() const {
+        MemoryUsage total;
+        for (const auto &book: books_) total += book->GetMemoryUsage();
+        return total;
+    }
+
+    PipelineStats GetTotalStats() const {
+        PipelineStats total;
+        for (const auto &shard: shards_) {
+            PipelineStats stats = shard->GetStats();
+            total.enqueued += stats.enqueued;
+            total.dropped += stats.dropped;
+            total.processed += stats.processed;
+            total.depth += stats.depth;
+            total.maxDepth = std::max(total.maxDepth, stats.maxDepth);
+        }
+        return total;
+    }
+
+private:
+    struct RoutedMessage {
+        SymbolId symbol = 0;
+        MarketDataMessage message;
+    };
+
+    struct Shard {
+        static constexpr int SpinLimit = 1024;
+
+        std::vector<std::unique_ptr<Orderbook> > &books_;
+        SpscQueue<RoutedMessage> queue_;
+        OnApplied onApplied_;
+        std::chrono::microseconds idleSleep_{0};
+        std::thread worker_;
+        std::atomic<bool> running_{false};
+        std::atomic<std::uint64_t> enqueued_{0};
+        std::atomic<std::uint64_t> dropped_{0};
+        std::atomic<std::uint64_t> processed_{0};
+        std::atomic<std::size_t> maxDepth_{0};
+
+        Shard(std::vector<std::unique_ptr<Orderbook> > &books, std::size_t queueCapacity)
+            : books_{books}
+              , queue_{queueCapacity} {
+        }
+
+        void Start() {
+            running_ = true;
+            worker_ = std::thread([this] { Run(); });
+        }
+
+        void Stop() {
+            running_.store(false, std::memory_order_release);
+            if (worker_.joinable()) worker_.join();
+        }
+
+        bool Publish(SymbolId symbol, MarketDataMessage message) {
+            if (!queue_.TryPush(RoutedMessage{symbol, std::move(message)})) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            enqueued_.fetch_add(1, std::memory_order_relaxed);
+            const std::size_t depth = queue_.Size();
+            if (depth > maxDepth_.load(std::memory_order_relaxed)) {
+                maxDepth_.store(depth, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        PipelineStats GetStats() const {
+            PipelineStats stats;
+            stats.enqueued = enqueued_.load(std::memory_order_relaxed);
+            stats.dropped = dropped_.load(std::memory_order_relaxed);
+            stats.processed = processed_.load(std::memory_order_relaxed);
+            stats.depth = queue_.Size();
+            stats.maxDepth = maxDepth_.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        void Run() {
+            RoutedMessage routed;
+            int idlePolls = 0;
+            while (true) {
+                if (queue_.TryPop(routed)) {
+                    idlePolls = 0;
+                    Orderbook &book = *books_[routed.symbol];
+                    book.ProcessMarketData(routed.message);
+                    processed_.fetch_add(1, std::memory_order_relaxed);
+                    if (onApplied_) onApplied_(routed.symbol, book, routed.message);
+                    continue;
+                }
+                if (!running_.load(std::memory_order_acquire) && queue_.Empty()) break;
+                if (++idlePolls <= SpinLimit) continue;
+                if (idleSleep_.count() > 0) std::this_thread::sleep_for(idleSleep_);
+                else                        std::this_thread::yield();
+            }
+        }
+    };
+
+    // books_ is only resized while stopped, so workers can index it without locking.
+    std::vector<std::unique_ptr<Orderbook> > books_;
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, SymbolId> symbols_;
+    std::vector<std::unique_ptr<Shard> > shards_;
+    bool running_ = false;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include "Order.h"
+#include "OrderPool.h"
+#include "Types.h"
+
+class PriceLevel {
+    // FIFO queue of resting orders at one price, threaded through the pool's
+    // intrusive prev/next links. Append, pop-front and removal from the middle are
+    // all O(1) and never reorder the remaining orders, so time priority survives
+    // cancels. Resting quantity and order count are kept up to date incrementally so
+    // depth queries never walk the orders.
+public:
+    OrderHandle Front() const { return head_; }
+    bool Empty() const { return head_ == OrderPool::InvalidHandle; }
+    Quantity GetTotalQuantity() const { return totalQuantity_; }
+    std::uint32_t GetOrderCount() const { return orderCount_; }
+
+    void PushBack(OrderPool &pool, OrderHandle handle) {
+        pool.SetPrev(handle, tail_);
+        pool.SetNext(handle, OrderPool::InvalidHandle);
+        if (tail_ != OrderPool::InvalidHandle) {
+            pool.SetNext(tail_, handle);
+        } else {
+            head_ = handle;
+        }
+        tail_ = handle;
+        totalQuantity_ += pool.Get(handle).GetRemainingQuantity();
+        ++orderCount_;
+    }
+
+    // Unlinks an order from anywhere in the queue; its remaining quantity leaves the level total.
+    void Erase(OrderPool &pool, OrderHandle handle) {
+        const OrderHandle prev = pool.Prev(handle);
+        const OrderHandle next = pool.Next(handle);
+        if (prev != OrderPool::InvalidHandle) {
+            pool.SetNext(prev, next);
+        } else {
+            head_ = next;
+        }
+        if (next != OrderPool::InvalidHandle) {
+            pool.SetPrev(next, prev);
+        } else {
+            tail_ = prev;
+        }
+        totalQuantity_ -= pool.Get(handle).GetRemainingQuantity();
+        --orderCount_;
+    }
+
+    // Fills an order resting in this level and keeps the cached total in step.
+    void Fill(OrderPool &pool, OrderHandle handle, Quantity quantity) {
+        pool.Get(handle).Fill(quantity);
+        totalQuantity_ -= quantity;
+    }
+
+    // Restates an order resting in this level in place, keeping its queue position.
+    void Restate(OrderPool &pool, OrderHandle handle, Quantity quantity) {
+        Order &order = pool.Get(handle);
+        totalQuantity_ = totalQuantity_ - order.GetRemainingQuantity() + quantity;
+        order.Restate(quantity);
+    }
+
+    // Follows an order the pool relocated (see OrderPool::Relocate), which already
+    // relinked its neighbours; only the ends of the queue are the level's.
+    void Relink(OrderHandle from, OrderHandle to) {
+        if (head_ == from) head_ = to;
+        if (tail_ == from) tail_ = to;
+    }
+
+private:
+    OrderHandle head_ = OrderPool::InvalidHandle;
+    OrderHandle tail_ = OrderPool::InvalidHandle;
+    Quantity totalQuantity_ = 0;
+    std::uint32_t orderCount_ = 0;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+template<typename T>
+class SpscQueue {
+    // Bounded lock-free ring for exactly one producer thread and one consumer
+    // thread. Head and tail live on separate cache lines, and each side keeps a
+    // cached copy of the other side's index so the shared atomic is only re-read
+    // when the ring looks full (producer) or empty (consumer).
+public:
+    explicit SpscQueue(std::size_t capacity)
+        : slots_(std::bit_ceil(capacity < 2 ? std::size_t{2} : capacity))
+          , mask_{slots_.size() - 1} {
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // Producer side. Returns false without blocking when the ring is full.
+    template<typename U>
+    bool TryPush(U &&value) {
+        const std::size_t tail = tail_.value.load(std::memory_order_relaxed);
+        if (tail - cachedHead_ == slots_.size()) {
+            cachedHead_ = head_.value.load(std::memory_order_acquire);
+            if (tail - cachedHead_ == slots_.size()) return false;
+        }
+        slots_[tail & mask_] = std::forward<U>(value);
+        tail_.value.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when the ring is empty.
+    bool TryPop(T &value) {
+        const std::size_t head = head_.value.load(std::memory_order_relaxed);
+        if (head == cachedTail_) {
+            cachedTail_ = tail_.value.load(std::memory_order_acquire);
+            if (head == cachedTail_) return false;
+        }
+        value = std::move(slots_[head & mask_]);
+        head_.value.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called while the other side is active.
+    std::size_t Size() const {
+        const std::size_t tail = tail_.value.load(std::memory_order_acquire);
+        const std::size_t head = head_.value.load(std::memory_order_acquire);
+        return tail - head;
+    }
+
+    bool Empty() const { return Size() == 0; }
+    std::size_t Capacity() const { return slots_.size(); }
+
+private:
+    static constexpr std::size_t CacheLine = 64;
+
+    struct alignas(CacheLine) PaddedIndex {
+        std::atomic<std::size_t> value{0};
+    };
+
+    std::vector<T> slots_;
+    std::size_t mask_;
+
+    // head_ is written by the consumer, tail_ by the producer. Each cached copy sits
+    // on its own line next to the side that owns it.
+    PaddedIndex head_;
+    alignas(CacheLine) std::size_t cachedTail_ = 0;
+    PaddedIndex tail_;
+    alignas(CacheLine) std::size_t cachedHead_ = 0;
+};
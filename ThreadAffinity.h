@@ -0,0 +1,27 @@
+#pragma once
+
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Pins a thread to one logical CPU. Returns false where affinity is unsupported or
+// the call fails; callers treat pinning as best effort.
+inline bool PinThreadToCpu(std::thread &thread, unsigned cpu) {
+#ifdef _WIN32
+    return SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{1} << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void) thread;
+    (void) cpu;
+    return false;
+#endif
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include "LevelInfo.h"
+#include "OrderType.h"
+#include "Types.h"
+
+// Best levels of both sides as last published by the book's owning thread.
+struct TopOfBook {
+    static constexpr std::size_t MaxLevels = 10;
+
+    std::array<LevelInfo, MaxLevels> bids{};
+    std::array<LevelInfo, MaxLevels> asks{};
+    std::uint32_t bidCount = 0;
+    std::uint32_t askCount = 0;
+    std::uint64_t version = 0;        // publications that changed something; 0 before the first
+    std::uint64_t sequenceNumber = 0; // the book's last market data sequence number
+
+    bool HasBid() const { return bidCount > 0; }
+    bool HasAsk() const { return askCount > 0; }
+    const LevelInfo &BestBid() const { return bids[0]; }
+    const LevelInfo &BestAsk() const { return asks[0]; }
+};
+
+class TopOfBookPublisher {
+    // Seqlock around the top TopOfBook::MaxLevels levels of each side. The thread
+    // that owns the book is the only writer; any number of threads read without
+    // locks and without ever making the writer wait. A publication that would write
+    // the same levels again is skipped, so the shared cache lines are only touched
+    // when the top of book actually moved.
+    //
+    // Every shared field is a relaxed atomic word bracketed by the sequence counter
+    // (odd while a write is in progress), which keeps concurrent reads well defined.
+public:
+    static constexpr std::size_t MaxLevels = TopOfBook::MaxLevels;
+
+    // Writer side only: the book calls this once attached with
+    // BasicOrderbook::SetTopOfBookPublisher, after each update that touched a level
+    // Covers accepts or moved the sequence number. Only the sides flagged as touched
+    // are read from the book again; the other keeps its last published levels.
+    template<typename Book>
+    void Publish(const Book &book, bool bidsTouched = true, bool asksTouched = true) {
+        if (version_ == 0) bidsTouched = asksTouched = true;
+        TopOfBook next = last_;
+        if (bidsTouched) {
+            next.bidCount = static_cast<std::uint32_t>(book.GetTopLevels(Side::Buy, std::span<LevelInfo>(next.bids)));
+        }
+        if (asksTouched) {
+            next.askCount = static_cast<std::uint32_t>(book.GetTopLevels(Side::Sell, std::span<LevelInfo>(next.asks)));
+        }
+        next.sequenceNumber = book.GetLastSequenceNumber();
+        if (version_ > 0 && SameAs(next)) return;
+
+        last_ = next;
+        ++version_;
+        const std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        words_[CountsWord].store(static_cast<std::uint64_t>(next.bidCount) << 32 | next.askCount,
+                                 std::memory_order_relaxed);
+        words_[VersionWord].store(version_, std::memory_order_relaxed);
+        words_[SequenceWord].store(next.sequenceNumber, std::memory_order_relaxed);
+        StoreLevels(next.bids, next.bidCount, BidWords);
+        StoreLevels(next.asks, next.askCount, AskWords);
+
+        sequence_.store(sequence + 2, std::memory_order_release);
+    }
+
+    // One read attempt: false if a publication was in progress or overlapped it.
+    bool TryRead(TopOfBook &out) const {
+        const std::uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+
+        const std::uint64_t counts = words_[CountsWord].load(std::memory_order_relaxed);
+        out.bidCount = std::min<std::uint32_t>(static_cast<std::uint32_t>(counts >> 32), MaxLevels);
+        out.askCount = std::min<std::uint32_t>(static_cast<std::uint32_t>(counts), MaxLevels);
+        out.version = words_[VersionWord].load(std::memory_order_relaxed);
+        out.sequenceNumber = words_[SequenceWord].load(std::memory_order_relaxed);
+        LoadLevels(out.bids, out.bidCount, BidWords);
+        LoadLevels(out.asks, out.askCount, AskWords);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence_.load(std::memory_order_relaxed) == before;
+    }
+
+    // Retries until it gets a consistent copy; the writer never blocks it for long,
+    // as a publication is a few dozen stores.
+    TopOfBook Read() const {
+        TopOfBook snapshot;
+        while (!TryRead(snapshot)) std::this_thread::yield();
+        return snapshot;
+    }
+
+    std::uint64_t GetVersion() const { return words_[VersionWord].load(std::memory_order_acquire); }
+
+    // Writer side: whether a change to this level could alter the published levels.
+    // That holds inside the published depth, and anywhere on a side showing fewer
+    // than MaxLevels levels, where a new level would join the published ones. A level
+    // outside that range can only enter it if one inside empties, which is itself a
+    // touch inside the range.
+    bool Covers(Side side, Price price) const {
+        if (version_ == 0) return true;
+        if (side == Side::Buy) return last_.bidCount < MaxLevels || price >= last_.bids[MaxLevels - 1].price_;
+        return last_.askCount < MaxLevels || price <= last_.asks[MaxLevels - 1].price_;
+    }
+
+    // Writer side: the book sequence number of the last publication.
+    std::uint64_t PublishedSequence() const { return last_.sequenceNumber; }
+
+private:
+    static constexpr std::size_t CountsWord = 0;
+    static constexpr std::size_t VersionWord = 1;
+    static constexpr std::size_t SequenceWord = 2;
+    static constexpr std::size_t BidWords = 3;                       // two words per level
+    static constexpr std::size_t AskWords = BidWords + 2 * MaxLevels;
+    static constexpr std::size_t WordCount = AskWords + 2 * MaxLevels;
+    static constexpr std::size_t CacheLine = 64;
+
+    alignas(CacheLine) std::atomic<std::uint64_t> sequence_{0};
+    std::array<std::atomic<std::uint64_t>, WordCount> words_{};
+
+    // Writer-private copy of the last publication, on its own line.
+    alignas(CacheLine) TopOfBook last_;
+    std::uint64_t version_ = 0;
+
+    bool SameAs(const TopOfBook &next) const {
+        auto sameLevels = [](const std::array<LevelInfo, MaxLevels> &lhs, const std::array<LevelInfo, MaxLevels> &rhs,
+                             std::uint32_t count) {
+            for (std::uint32_t i = 0; i < count; ++i) {
+                if (lhs[i].price_ != rhs[i].price_ || lhs[i].quantity_ != rhs[i].quantity_ ||
+                    lhs[i].orderCount_ != rhs[i].orderCount_) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        return next.bidCount == last_.bidCount && next.askCount == last_.askCount &&
+               next.sequenceNumber == last_.sequenceNumber &&
+               sameLevels(next.bids, last_.bids, next.bidCount) && sameLevels(next.asks, last_.asks, next.askCount);
+    }
+
+    void StoreLevels(const std::array<LevelInfo, MaxLevels> &levels, std::uint32_t count, std::size_t first) {
+        for (std::uint32_t i = 0; i < count; ++i) {
+            words_[first + 2 * i].store(static_cast<std::uint64_t>(static_cast<std::uint32_t>(levels[i].price_)) << 32 |
+                                        levels[i].quantity_, std::memory_order_relaxed);
+            words_[first + 2 * i + 1].store(levels[i].orderCount_, std::memory_order_relaxed);
+        }
+    }
+
+    void LoadLevels(std::array<LevelInfo, MaxLevels> &levels, std::uint32_t count, std::size_t first) const {
+        for (std::uint32_t i = 0; i < count; ++i) {
+            const std::uint64_t priceAndQuantity = words_[first + 2 * i].load(std::memory_order_relaxed);
+            levels[i].price_ = static_cast<Price>(static_cast<std::uint32_t>(priceAndQuantity >> 32));
+            levels[i].quantity_ = static_cast<Quantity>(priceAndQuantity);
+            levels[i].orderCount_ = static_cast<std::uint32_t>(words_[first + 2 * i + 1].load(std::memory_order_relaxed));
+        }
+    }
+};
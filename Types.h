@@ -10,4 +10,6 @@ using Price = std::int32_t;
 using Quantity = std::uint32_t;
 using OrderId = std::uint64_t;
 using OrderPointer = std::shared_ptr<Order>;
-using OrderPointers = std::vector<OrderPointer>;
\ No newline at end of file
+using OrderPointers = std::vector<OrderPointer>;
+using OrderHandle = std::uint32_t; // index of an order inside an OrderPool
+using OrderHandles = std::vector<OrderHandle>;
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "ThreadAffinity.h"
+
+class WorkStealingPool {
+    // Fixed set of worker threads, each with its own task deque. Submit deals tasks
+    // out round-robin; a worker runs its own tasks newest first and, once its deque
+    // is empty, steals the oldest task of another worker. Tasks are meant to be
+    // coarse (a whole replay, a whole day), so each deque is guarded by its own
+    // mutex; workers only contend when stealing.
+    //
+    // Submit and Wait may be called from any thread, and tasks may submit more tasks.
+    // A task that throws does not stop the others; Wait rethrows the first exception.
+public:
+    using Task = std::function<void()>;
+
+    // With pinCores, worker i runs on CPU i modulo the number of hardware threads.
+    explicit WorkStealingPool(std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency()),
+                              bool pinCores = true) {
+        if (threadCount == 0) throw std::invalid_argument("WorkStealingPool needs at least one thread");
+        workers_.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i) workers_.push_back(std::make_unique<Worker>());
+
+        const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < threadCount; ++i) {
+            workers_[i]->thread = std::thread([this, i] { Run(i); });
+            if (pinCores) PinThreadToCpu(workers_[i]->thread, static_cast<unsigned>(i % cores));
+        }
+    }
+
+    // Finishes every submitted task, then joins the workers.
+    ~WorkStealingPool() {
+        {
+            std::unique_lock lock(stateMutex_);
+            idle_.wait(lock, [this] { return unfinished_ == 0; });
+            stopping_ = true;
+        }
+        workAvailable_.notify_all();
+        for (auto &worker: workers_) worker->thread.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    void Submit(Task task) {
+        Worker &worker = *workers_[nextWorker_.fetch_add(1, std::memory_order_relaxed) % workers_.size()];
+        {
+            // Counted before it becomes visible, so a thief never takes an uncounted task.
+            std::lock_guard lock(stateMutex_);
+            ++unfinished_;
+            ++queued_;
+            std::lock_guard workerLock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+        workAvailable_.notify_one();
+    }
+
+    // Blocks until every task submitted so far, and any they submitted, has finished.
+    void Wait() {
+        std::exception_ptr error;
+        {
+            std::unique_lock lock(stateMutex_);
+            idle_.wait(lock, [this] { return unfinished_ == 0; });
+            std::swap(error, error_);
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    std::size_t ThreadCount() const { return workers_.size(); }
+
+    // Tasks run by a worker other than the one they were dealt to.
+    std::uint64_t GetStealCount() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    std::atomic<std::size_t> nextWorker_{0};
+    std::atomic<std::uint64_t> steals_{0};
+
+    // unfinished_ counts tasks submitted and not yet finished, queued_ those still
+    // sitting in a deque; both change under stateMutex_ so no wakeup is lost. Lock
+    // order is stateMutex_ before a worker's mutex.
+    std::mutex stateMutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable idle_;
+    std::size_t unfinished_ = 0;
+    std::size_t queued_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+
+    bool TryTake(std::size_t self, Task &task) {
+        {
+            Worker &own = *workers_[self];
+            std::lock_guard lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t offset = 1; offset < workers_.size(); ++offset) {
+            Worker &victim = *workers_[(self + offset) % workers_.size()];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                steals_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Run(std::size_t self) {
+        Task task;
+        while (true) {
+            {
+                std::unique_lock lock(stateMutex_);
+                workAvailable_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+                if (queued_ == 0) return; // stopping with nothing left
+            }
+            if (!TryTake(self, task)) continue; // another worker got there first
+
+            std::exception_ptr error;
+            {
+                std::lock_guard lock(stateMutex_);
+                --queued_;
+            }
+            try {
+                task();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            task = nullptr;
+
+            std::lock_guard lock(stateMutex_);
+            if (error && !error_) error_ = error;
+            if (--unfinished_ == 0) idle_.notify_all();
+        }
+    }
+};
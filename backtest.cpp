@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Backtest.h"
+
+// Replays a set of capture files, one fresh book per (symbol, session date), across
+// a work-stealing thread pool and reports per-job and total results.
+//
+// Usage: OrderBookBacktest [--threads N] [--batch N] [--no-pin] [--csv FILE] CAPTURE...
+// Each CAPTURE is a capture file or a directory of them.
+
+namespace {
+
+struct Options {
+    BacktestOptions backtest;
+    std::string csvPath;
+    std::vector<std::filesystem::path> inputs;
+};
+
+void PrintUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [--threads N] [--batch N] [--no-pin] [--csv FILE] CAPTURE...\n";
+}
+
+// A whole-string decimal count of at least one.
+std::optional<std::size_t> ParseCount(const std::string &text) {
+    std::size_t value = 0;
+    const char *end = text.data() + text.size();
+    const auto [rest, error] = std::from_chars(text.data(), end, value);
+    if (error != std::errc{} || rest != end || value == 0) return std::nullopt;
+    return value;
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--no-pin") {
+            options.backtest.pinCores = false;
+            continue;
+        }
+        if (!arg.starts_with("--")) {
+            options.inputs.emplace_back(arg);
+            continue;
+        }
+        if (arg != "--threads" && arg != "--batch" && arg != "--csv") {
+            std::cerr << "Unknown option " << arg << "\n";
+            PrintUsage(argv[0]);
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            PrintUsage(argv[0]);
+            return false;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--csv") {
+            options.csvPath = value;
+            continue;
+        }
+        const std::optional<std::size_t> count = ParseCount(value);
+        if (!count) {
+            std::cerr << "Invalid value for " << arg << ": " << value << " (expected a positive integer)\n";
+            PrintUsage(argv[0]);
+            return false;
+        }
+        if (arg == "--threads") options.backtest.threads = *count;
+        else                    options.backtest.replay.batchSize = *count;
+    }
+    if (options.inputs.empty()) {
+        PrintUsage(argv[0]);
+        return false;
+    }
+    return true;
+}
+
+std::string FormatPrice(const std::optional<LevelInfo> &level) {
+    if (!level) return "-";
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << level->price_ / 100.0;
+    return out.str();
+}
+
+void PrintSummary(const BacktestSummary &summary) {
+    std::cout << std::left << std::setw(12) << "symbol" << std::setw(12) << "date" << std::right
+            << std::setw(6) << "files" << std::setw(12) << "events" << std::setw(10) << "trades"
+            << std::setw(9) << "errors" << std::setw(9) << "resting" << std::setw(11) << "best bid"
+            << std::setw(11) << "best ask" << std::setw(10) << "Mev/s" << "\n";
+    for (const BacktestResult &result: summary.results) {
+        std::cout << std::left << std::setw(12) << result.symbol << std::setw(12) << result.sessionDate << std::right
+                << std::setw(6) << result.files << std::setw(12) << result.replay.events
+                << std::setw(10) << result.stats.trades << std::setw(9) << result.stats.errors
+                << std::setw(9) << result.restingOrders << std::setw(11) << FormatPrice(result.bestBid)
+                << std::setw(11) << FormatPrice(result.bestAsk) << std::setw(10) << std::fixed
+                << std::setprecision(2) << result.replay.EventsPerSecond() / 1e6 << "\n";
+        for (const BacktestFileResult &capture: result.captures) {
+            std::cout << "  " << std::left << std::setw(28) << capture.file.filename().string() << std::right
+                    << std::setw(12) << capture.replay.events << std::setw(10) << capture.trades
+                    << std::setw(29) << FormatPrice(capture.bestBid) << std::setw(11) << FormatPrice(capture.bestAsk)
+                    << "\n";
+        }
+        if (!result.Ok()) std::cout << "  failed: " << result.error << "\n";
+    }
+
+    const MarketDataStats &total = summary.total;
+    std::cout << "\n" << summary.results.size() << " jobs, " << summary.failed << " failed, "
+            << summary.steals << " stolen\n";
+    std::cout << "Events: " << summary.events << " (" << summary.applied << " applied) in " << std::fixed
+            << std::setprecision(3) << summary.elapsed.count() / 1e9 << " s, " << std::setprecision(2)
+            << summary.EventsPerSecond() / 1e6 << " M events/s\n";
+    std::cout << "Orders: " << total.newOrders << " new, " << total.cancellations << " cancelled, "
+            << total.modifications << " modified; trades " << total.trades << "; snapshots "
+            << total.snapshots << ", depth updates " << total.depthUpdates << ", sequence gaps "
+            << total.sequenceGaps << ", errors " << total.errors << "\n";
+}
+
+void WriteCsv(std::ostream &out, const BacktestSummary &summary) {
+    out << "symbol,date,files,events,applied,elapsed_ns,new_orders,cancellations,modifications,trades,"
+            "snapshots,depth_updates,sequence_gaps,errors,resting_orders,bid_levels,ask_levels,best_bid,best_ask,"
+            "error\n";
+    for (const BacktestResult &result: summary.results) {
+        const MarketDataStats &stats = result.stats;
+        out << result.symbol << ',' << result.sessionDate << ',' << result.files << ',' << result.replay.events
+                << ',' << result.replay.applied << ',' << result.replay.elapsed.count() << ',' << stats.newOrders
+                << ',' << stats.cancellations << ',' << stats.modifications << ',' << stats.trades << ','
+                << stats.snapshots << ',' << stats.depthUpdates << ',' << stats.sequenceGaps << ','
+                << stats.errors << ',' << result.restingOrders << ',' << result.bidLevels << ','
+                << result.askLevels << ',' << (result.bestBid ? std::to_string(result.bestBid->price_) : "")
+                << ',' << (result.bestAsk ? std::to_string(result.bestAsk->price_) : "") << ",\""
+                << result.error << "\"\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) return 2;
+
+    std::vector<BacktestJob> jobs;
+    std::vector<std::filesystem::path> skipped;
+    try {
+        jobs = PlanBacktest(options.inputs, &skipped);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    for (const auto &file: skipped) std::cerr << "Skipping " << file.string() << ": not a capture file\n";
+    if (jobs.empty()) {
+        std::cerr << "No capture files found\n";
+        return 1;
+    }
+
+    std::cout << "Replaying " << jobs.size() << " (symbol, day) jobs on "
+            << std::min(options.backtest.threads, jobs.size()) << " threads\n\n";
+    const BacktestSummary summary = RunBacktest(jobs, options.backtest);
+    PrintSummary(summary);
+
+    if (!options.csvPath.empty()) {
+        std::ofstream out(options.csvPath);
+        if (!out) {
+            std::cerr << "Cannot write " << options.csvPath << "\n";
+            return 1;
+        }
+        WriteCsv(out, summary);
+        std::cout << "Wrote " << options.csvPath << "\n";
+    }
+
+    return summary.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "OrderBook.h"
+#include "LatencyClock.h"
+#include "LatencyHistogram.h"
+
+// Deterministic benchmark suite, separate from the functional tests in tests.cpp.
+//
+// Each profile pre-generates its whole order flow from a fixed seed, so every run
+// (and every commit) replays exactly the same operations and RNG cost stays out of
+// the timed region. Arrivals follow a Poisson process; the mid price is a random
+// walk over the simulated arrival times, and passive orders are placed a
+// half-normal number of ticks away from it. Every operation is timed on its own
+// and recorded into a per-operation latency histogram. Results are merged over the
+// measured repetitions, after untimed warmup repetitions on fresh books. The std
+// distributions are implementation-defined, so compare runs built against the same
+// standard library.
+//
+// Usage: OrderBookBenchmarks [--json FILE] [--seed N] [--repetitions N] [--warmup N]
+//                            [--operations N] [--profile NAME]
+
+namespace {
+
+using BenchClock = TscClock;
+
+enum class OpKind : std::uint8_t {
+    Add,
+    Aggressive,
+    Cancel,
+    Modify
+};
+
+constexpr std::size_t OpKindCount = 4;
+constexpr const char *OpKindNames[OpKindCount] = {"add", "aggressive", "cancel", "modify"};
+
+struct Op {
+    OpKind kind;
+    Side side;
+    OrderType orderType;
+    OrderId orderId;
+    Price price;
+    Quantity quantity;
+};
+
+struct FlowProfile {
+    std::string name;
+    // Relative weights of the four operation kinds
+    double addWeight;
+    double aggressiveWeight;
+    double cancelWeight;
+    double modifyWeight;
+    double priceSigmaTicks;   // passive distance from mid ~ |N(0, sigma)| + 1
+    double midVolTicks;       // mid price standard deviation per sqrt(second)
+    double arrivalsPerSecond; // Poisson intensity of the simulated feed
+};
+
+struct Options {
+    std::string jsonPath;
+    std::string profileFilter;
+    unsigned seed = 42;
+    int repetitions = 5;
+    int warmup = 1;
+    int operations = 200000;
+    int prefillOrders = 20000;
+};
+
+struct Workload {
+    std::vector<Op> prefill;
+    std::vector<Op> ops;
+};
+
+struct ProfileResult {
+    std::string name;
+    LatencyHistogram latency[OpKindCount];
+    std::vector<double> opsPerSecond; // one entry per measured repetition
+};
+
+std::vector<FlowProfile> DefaultProfiles() {
+    return {
+        // Typical lit-market mix
+        {"balanced", 50, 5, 30, 15, 5.0, 20.0, 50000},
+        // Market-maker quoting: most orders are cancelled before they trade
+        {"cancel-heavy", 45, 2, 50, 3, 3.0, 20.0, 200000},
+        // Momentum burst: a quarter of the flow takes liquidity
+        {"aggressive", 50, 25, 20, 5, 3.0, 60.0, 100000},
+    };
+}
+
+// FNV-1a, so each profile's stream depends only on the seed and its name (std::hash
+// is implementation-defined).
+std::uint64_t HashName(const std::string &name) {
+    std::uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c: name) hash = (hash ^ c) * 1099511628211ull;
+    return hash;
+}
+
+Workload GenerateWorkload(const FlowProfile &profile, const Options &options) {
+    std::mt19937_64 gen(options.seed ^ HashName(profile.name));
+    std::exponential_distribution<double> interArrival(profile.arrivalsPerSecond);
+    std::normal_distribution<double> unitNormal(0.0, 1.0);
+    std::uniform_int_distribution<Quantity> qtyDist(1, 100);
+    std::discrete_distribution<int> kindDist({
+        profile.addWeight, profile.aggressiveWeight, profile.cancelWeight, profile.modifyWeight
+    });
+
+    struct Live {
+        OrderId orderId;
+        Side side;
+    };
+    std::vector<Live> live;
+    live.reserve(options.prefillOrders + options.operations);
+
+    double mid = 100000.0;
+    OrderId nextOrderId = 1;
+
+    auto passivePrice = [&](Side side) {
+        const Price offset = 1 + static_cast<Price>(std::abs(unitNormal(gen)) * profile.priceSigmaTicks);
+        const Price center = static_cast<Price>(std::lround(mid));
+        return side == Side::Buy ? center - offset : center + offset;
+    };
+
+    auto makeAdd = [&]() {
+        const Side side = (gen() & 1) ? Side::Buy : Side::Sell;
+        Op op{OpKind::Add, side, OrderType::GoodTillCancel, nextOrderId++, passivePrice(side), qtyDist(gen)};
+        live.push_back({op.orderId, side});
+        return op;
+    };
+
+    Workload workload;
+    workload.prefill.reserve(options.prefillOrders);
+    for (int i = 0; i < options.prefillOrders; ++i) workload.prefill.push_back(makeAdd());
+
+    workload.ops.reserve(options.operations);
+    for (int i = 0; i < options.operations; ++i) {
+        const double dt = interArrival(gen);
+        mid += unitNormal(gen) * profile.midVolTicks * std::sqrt(dt);
+
+        OpKind kind = static_cast<OpKind>(kindDist(gen));
+        if (live.empty() && (kind == OpKind::Cancel || kind == OpKind::Modify)) kind = OpKind::Add;
+
+        switch (kind) {
+            case OpKind::Add:
+                workload.ops.push_back(makeAdd());
+                break;
+            case OpKind::Aggressive: {
+                // IOC that reaches a few ticks through the mid
+                const Side side = (gen() & 1) ? Side::Buy : Side::Sell;
+                const Price reach = static_cast<Price>(std::lround(mid)) +
+                                    (side == Side::Buy ? 1 : -1) * static_cast<Price>(profile.priceSigmaTicks);
+                workload.ops.push_back({
+                    OpKind::Aggressive, side, OrderType::ImmediateOrCancel, nextOrderId++, reach, qtyDist(gen)
+                });
+                break;
+            }
+            case OpKind::Cancel: {
+                const std::size_t idx = gen() % live.size();
+                workload.ops.push_back({OpKind::Cancel, live[idx].side, OrderType::GoodTillCancel, live[idx].orderId, 0, 0});
+                live[idx] = live.back();
+                live.pop_back();
+                break;
+            }
+            case OpKind::Modify: {
+                const Live &target = live[gen() % live.size()];
+                workload.ops.push_back({
+                    OpKind::Modify, target.side, OrderType::GoodTillCancel, target.orderId,
+                    passivePrice(target.side), qtyDist(gen)
+                });
+                break;
+            }
+        }
+    }
+    return workload;
+}
+
+// Applies one operation; orders the generator believes are live may already have
+// traded, in which case cancels and modifies are no-ops, as on a real feed.
+template<typename Book, typename Sink>
+void Apply(Book &orderbook, const Op &op, Sink &sink) {
+    switch (op.kind) {
+        case OpKind::Add:
+        case OpKind::Aggressive:
+            orderbook.AddOrder(Order{op.orderType, op.orderId, op.side, op.price, op.quantity}, sink);
+            break;
+        case OpKind::Cancel:
+            orderbook.CancelOrder(op.orderId);
+            break;
+        case OpKind::Modify:
+            orderbook.MatchOrder(OrderModify{op.orderId, op.side, op.price, op.quantity}, sink);
+            break;
+    }
+}
+
+// The benchmarked book carries no instrumentation of its own.
+using BenchBook = BasicOrderbook<MapBookSide, NoInstrumentation>;
+
+void RunRepetition(const Workload &workload, ProfileResult *result) {
+    BenchBook orderbook;
+    std::uint64_t tradeCount = 0;
+    auto sink = [&tradeCount](const Trade &) { ++tradeCount; };
+    for (const Op &op: workload.prefill) Apply(orderbook, op, sink);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const Op &op: workload.ops) {
+        const auto opStart = BenchClock::Now();
+        Apply(orderbook, op, sink);
+        const auto elapsed = BenchClock::Now() - opStart;
+        if (result) result->latency[static_cast<std::size_t>(op.kind)].Record(BenchClock::ToNanos(elapsed));
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    if (result) {
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        result->opsPerSecond.push_back(workload.ops.size() / seconds);
+    }
+}
+
+// Cost of an empty timed region, so readers can judge the floor of the percentiles.
+std::uint64_t MeasureTimerOverhead() {
+    LatencyHistogram overhead;
+    for (int i = 0; i < 100000; ++i) {
+        const auto start = BenchClock::Now();
+        overhead.Record(BenchClock::ToNanos(BenchClock::Now() - start));
+    }
+    return overhead.P50();
+}
+
+double Median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    const std::size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+}
+
+void PrintResult(const ProfileResult &result) {
+    std::cout << "Profile: " << result.name << "\n";
+    std::cout << std::fixed << std::setprecision(0)
+            << "  Throughput (median of " << result.opsPerSecond.size() << "): "
+            << Median(result.opsPerSecond) << " ops/sec\n";
+    std::cout << "  " << std::left << std::setw(12) << "op" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "mean"
+            << std::setw(8) << "p50" << std::setw(8) << "p90" << std::setw(8) << "p99"
+            << std::setw(9) << "p99.9" << std::setw(10) << "max" << "  (ns)\n";
+    for (std::size_t kind = 0; kind < OpKindCount; ++kind) {
+        const LatencyHistogram &h = result.latency[kind];
+        if (h.Count() == 0) continue;
+        std::cout << "  " << std::left << std::setw(12) << OpKindNames[kind] << std::right
+                << std::setw(10) << h.Count() << std::setw(10) << std::setprecision(1) << h.Mean()
+                << std::setw(8) << h.P50() << std::setw(8) << h.ValueAtPercentile(90.0)
+                << std::setw(8) << h.P99() << std::setw(9) << h.P999() << std::setw(10) << h.Max() << "\n";
+    }
+    std::cout << "\n";
+}
+
+void WriteJson(std::ostream &out, const Options &options, std::uint64_t timerOverhead,
+               const std::vector<ProfileResult> &results) {
+    out << std::fixed << std::setprecision(1);
+    out << "{\n";
+    out << "  \"suite\": \"orderbook\",\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"repetitions\": " << options.repetitions << ",\n";
+    out << "  \"warmup\": " << options.warmup << ",\n";
+    out << "  \"operations\": " << options.operations << ",\n";
+    out << "  \"prefill_orders\": " << options.prefillOrders << ",\n";
+    out << "  \"timer_overhead_ns\": " << timerOverhead << ",\n";
+    out << "  \"profiles\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const ProfileResult &result = results[i];
+        const auto [minIt, maxIt] = std::minmax_element(result.opsPerSecond.begin(), result.opsPerSecond.end());
+        out << "    {\n";
+        out << "      \"name\": \"" << result.name << "\",\n";
+        out << "      \"throughput_ops_per_sec\": {\"median\": " << Median(result.opsPerSecond)
+                << ", \"min\": " << *minIt << ", \"max\": " << *maxIt << "},\n";
+        out << "      \"latency_ns\": {\n";
+        bool first = true;
+        for (std::size_t kind = 0; kind < OpKindCount; ++kind) {
+            const LatencyHistogram &h = result.latency[kind];
+            if (h.Count() == 0) continue;
+            if (!first) out << ",\n";
+            first = false;
+            out << "        \"" << OpKindNames[kind] << "\": {\"count\": " << h.Count()
+                    << ", \"mean\": " << h.Mean() << ", \"p50\": " << h.P50()
+                    << ", \"p90\": " << h.ValueAtPercentile(90.0) << ", \"p99\": " << h.P99()
+                    << ", \"p999\": " << h.P999() << ", \"max\": " << h.Max() << "}";
+        }
+        out << "\n      }\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+bool ParseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--json") options.jsonPath = next();
+        else if (arg == "--seed") options.seed = static_cast<unsigned>(std::stoul(next()));
+        else if (arg == "--repetitions") options.repetitions = std::max(1, std::stoi(next()));
+        else if (arg == "--warmup") options.warmup = std::max(0, std::stoi(next()));
+        else if (arg == "--operations") options.operations = std::max(1, std::stoi(next()));
+        else if (arg == "--profile") options.profileFilter = next();
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--json FILE] [--seed N] [--repetitions N] [--warmup N]"
+                    << " [--operations N] [--profile NAME]\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) return 2;
+
+    BenchClock::NanosPerTick(); // calibrate before anything is timed
+    const std::uint64_t timerOverhead = MeasureTimerOverhead();
+
+    std::cout << std::string(70, '=') << "\n";
+    std::cout << std::setw(45) << "ORDERBOOK BENCHMARK SUITE\n";
+    std::cout << std::string(70, '=') << "\n";
+    std::cout << "Seed " << options.seed << ", " << options.warmup << " warmup + " << options.repetitions
+            << " measured repetitions, " << options.operations << " operations on a "
+            << options.prefillOrders << "-order book\n";
+    std::cout << "Timer overhead: " << timerOverhead << " ns\n\n";
+
+    std::vector<ProfileResult> results;
+    for (const FlowProfile &profile: DefaultProfiles()) {
+        if (!options.profileFilter.empty() && profile.name != options.profileFilter) continue;
+
+        const Workload workload = GenerateWorkload(profile, options);
+        ProfileResult result;
+        result.name = profile.name;
+        for (int rep = 0; rep < options.warmup; ++rep) RunRepetition(workload, nullptr);
+        for (int rep = 0; rep < options.repetitions; ++rep) RunRepetition(workload, &result);
+
+        PrintResult(result);
+        results.push_back(std::move(result));
+    }
+
+    if (results.empty()) {
+        std::cerr << "No profile named " << options.profileFilter << "\n";
+        return 2;
+    }
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath);
+        if (!out) {
+            std::cerr << "Cannot write " << options.jsonPath << "\n";
+            return 1;
+        }
+        WriteJson(out, options, timerOverhead, results);
+        std::cout << "Wrote " << options.jsonPath << "\n";
+    }
+
+    return 0;
+}
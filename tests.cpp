@@ -1,18 +1,71 @@
 #include <iostream>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
 #include <random>
+#include <sstream>
+#include <thread>
+#include <tuple>
 #include <iomanip>
+#include <map>
 #include "OrderBook.h"
 #include "Order.h"
+#include "OrderPool.h"
+#include "OrderIndex.h"
+#include "OrderSpec.h"
+#include "DepthKernels.h"
+#include "TopOfBook.h"
+#include "LevelDelta.h"
+#include "MemoryUsage.h"
+#include "OrderbookManager.h"
+#include "MarketDataPipeline.h"
+#include "SpscQueue.h"
+#include "LatencyHistogram.h"
+#include "Capture.h"
+#include "Backtest.h"
+#include "WorkStealingPool.h"
+#include "DepthFeedHandler.h"
+#include "DepthParser.h"
+#include "LatencyClock.h"
 #include "Types.h"
 #include "OrderType.h"
 
+// Counts every global heap allocation so benchmarks can report allocations per operation
+static std::atomic<std::size_t> allocationCount{0};
+
+void *operator new(std::size_t size) {
+    ++allocationCount;
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    ++allocationCount;
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+// Kept out of line: once inlined, GCC pairs the free with the library's operator new
+// it assumes and reports a mismatched new/delete.
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void *ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
 // Test helper macros
+static int testsRun = 0;
+
 #define TEST(name) void name()
 #define RUN_TEST(name) do { \
     std::cout << "Running " << #name << "... "; \
     name(); \
+    ++testsRun; \
     std::cout << "PASSED\n"; \
 } while(0)
 
@@ -114,6 +167,28 @@ TEST(TestTimePriority_FIFO) {
     ASSERT_EQ(trades[0].GetBidTrade().orderId_, 1);
 }
 
+TEST(TestCancelPreservesTimePriority) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Buy, 100, 10});
+
+    // Cancelling from the front and the middle must not let later orders jump the queue
+    orderbook.CancelOrder(1);
+    orderbook.CancelOrder(3);
+
+    auto trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Sell, 100, 15});
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(trades[0].GetBidTrade().orderId_, 2);
+    ASSERT_EQ(trades[1].GetBidTrade().orderId_, 4);
+    ASSERT_EQ(trades[1].GetBidTrade().quantity_, 5);
+
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids().size(), 1);
+    ASSERT_EQ(infos.GetBids()[0].quantity_, 5);
+}
+
 TEST(TestMarketOrderBuy) {
     Orderbook orderbook;
     orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 10));
@@ -145,6 +220,35 @@ TEST(TestMarketOrderEmptyBook) {
     ASSERT_EQ(orderbook.Size(), 0);
 }
 
+TEST(TestOrderFlagsPackTypeAndSide) {
+    for (OrderType type: {OrderType::GoodTillCancel, OrderType::ImmediateOrCancel, OrderType::Market,
+                          OrderType::GoodForDay, OrderType::FillOrKill}) {
+        for (Side side: {Side::Buy, Side::Sell}) {
+            Order order{type, 7, side, 100, 5};
+            ASSERT_TRUE(order.GetOrderType() == type);
+            ASSERT_TRUE(order.GetSide() == side);
+            ASSERT_FALSE(order.IsMarket());
+        }
+    }
+
+    Order market{7, Side::Sell, 5};
+    market.ToGoodTillCancel(std::numeric_limits<Price>::min());
+    ASSERT_TRUE(market.GetOrderType() == OrderType::GoodTillCancel);
+    ASSERT_TRUE(market.GetSide() == Side::Sell);
+    ASSERT_TRUE(market.IsMarket());
+
+    // A market order trades at the resting prices it meets; the remainder does not rest
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 103, 3});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 105, 2});
+    std::vector<Trade> trades;
+    orderbook.AddOrder(Order{3, Side::Buy, 8}, [&trades](const Trade &trade) { trades.push_back(trade); });
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(trades[0].GetBidTrade().price_, 103);
+    ASSERT_EQ(trades[1].GetBidTrade().price_, 105);
+    ASSERT_EQ(orderbook.Size(), 0);
+}
+
 TEST(TestImmediateOrCancel_PartialFill) {
     Orderbook orderbook;
     orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 5));
@@ -168,6 +272,43 @@ TEST(TestImmediateOrCancel_NoMatch) {
     ASSERT_EQ(orderbook.Size(), 1);
 }
 
+TEST(TestTypedEntryPointsSweepWithoutResting) {
+    BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 98, 5});
+
+    std::size_t fills = 0;
+    auto countFills = [&fills](const Trade &) { ++fills; };
+
+    // The IOC sweeps 100 and part of 101 and leaves the bid side and index alone,
+    // so the whole call runs without a heap allocation.
+    const std::size_t allocationsBefore = allocationCount;
+    orderbook.AddOrder<OrderType::ImmediateOrCancel>(Order{OrderType::ImmediateOrCancel, 4, Side::Buy, 101, 7},
+                                                     countFills);
+    ASSERT_EQ(allocationCount - allocationsBefore, 0);
+    ASSERT_EQ(fills, 2);
+    ASSERT_EQ(orderbook.Size(), 2);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetBids().size(), 1);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetAsks()[0].quantity_, 3);
+
+    // Unfilled IOC and market remainders vanish; the id is free again afterwards
+    orderbook.AddOrder<OrderType::Market>(Order{5, Side::Buy, 10}, countFills);
+    ASSERT_EQ(fills, 3);
+    ASSERT_EQ(orderbook.Size(), 1);
+    orderbook.AddOrder<OrderType::GoodTillCancel>(Order{OrderType::GoodTillCancel, 5, Side::Sell, 99, 2}, countFills);
+    ASSERT_EQ(orderbook.Size(), 2);
+
+    bool threw = false;
+    try {
+        orderbook.AddOrder<OrderType::FillOrKill>(Order{OrderType::GoodTillCancel, 6, Side::Buy, 99, 1}, countFills);
+    } catch (const std::logic_error &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_EQ(orderbook.Size(), 2);
+}
+
 TEST(TestFillOrKill_FullFill) {
     Orderbook orderbook;
     orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Sell, 100, 10));
@@ -203,6 +344,67 @@ TEST(TestFillOrKill_MultipleOrders) {
     ASSERT_EQ(orderbook.Size(), 0);
 }
 
+TEST(TestTradeSinkStreamsFills) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 102, 5});
+
+    std::vector<Trade> received;
+    orderbook.AddOrder(Order{OrderType::FillOrKill, 4, Side::Buy, 101, 8},
+                       [&received](const Trade &trade) { received.push_back(trade); });
+    ASSERT_EQ(received.size(), 2);
+    ASSERT_EQ(received[0].GetAskTrade().orderId_, 1);
+    ASSERT_EQ(received[1].GetAskTrade().price_, 101);
+    ASSERT_EQ(received[1].GetAskTrade().quantity_, 3);
+
+    // Rejected FOK reports nothing and leaves the book alone
+    received.clear();
+    orderbook.AddOrder(Order{OrderType::FillOrKill, 5, Side::Buy, 101, 5},
+                       [&received](const Trade &trade) { received.push_back(trade); });
+    ASSERT_TRUE(received.empty());
+    ASSERT_EQ(orderbook.Size(), 2);
+
+    std::size_t count = 0;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 6, Side::Buy, 102, 10},
+                       [&count](const Trade &) { ++count; });
+    ASSERT_EQ(count, 2);
+    ASSERT_EQ(orderbook.Size(), 1); // remaining 3 of order 6 rests
+}
+
+TEST(TestFillOrKillChecksLevelTotals) {
+    Orderbook orderbook;
+    OrderId orderId = 1;
+    for (Price price = 100; price <= 102; ++price) {
+        for (int i = 0; i < 50; ++i) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Sell, price, 2});
+        }
+    }
+
+    // 201 wanted, 200 available up to 101: rejected without a single fill
+    std::size_t fills = 0;
+    orderbook.AddOrder(Order{OrderType::FillOrKill, 1000, Side::Buy, 101, 201},
+                       [&fills](const Trade &) { ++fills; });
+    ASSERT_EQ(fills, 0);
+    ASSERT_EQ(orderbook.Size(), 150);
+
+    // All of 100 plus part of 101: fills in one sweep, nothing rests
+    orderbook.AddOrder(Order{OrderType::FillOrKill, 1001, Side::Buy, 101, 130},
+                       [&fills](const Trade &) { ++fills; });
+    ASSERT_EQ(fills, 65);
+    ASSERT_EQ(orderbook.Size(), 85);
+    ASSERT_FALSE(orderbook.GetOrderInfos().GetAsks().empty());
+    ASSERT_EQ(orderbook.GetOrderInfos().GetAsks()[0].price_, 101);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetAsks()[0].quantity_, 70);
+
+    // Sell side mirrors it
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2000, Side::Buy, 99, 5});
+    orderbook.AddOrder(Order{OrderType::FillOrKill, 2001, Side::Sell, 99, 6});
+    ASSERT_EQ(orderbook.Size(), 86);
+    orderbook.AddOrder(Order{OrderType::FillOrKill, 2002, Side::Sell, 99, 5});
+    ASSERT_EQ(orderbook.Size(), 85);
+}
+
 TEST(TestOrderModify) {
     Orderbook orderbook;
     OrderId orderId = 1;
@@ -217,6 +419,194 @@ TEST(TestOrderModify) {
     ASSERT_EQ(infos.GetBids()[0].quantity_, 15);
 }
 
+TEST(TestAmendDownKeepsQueuePosition) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 100, 10});
+
+    const std::size_t allocationsBefore = allocationCount;
+    orderbook.MatchOrder(OrderModify(1, Side::Buy, 100, 4), [](const Trade &) {});
+    ASSERT_EQ(allocationCount - allocationsBefore, 0);
+    orderbook.MatchOrder(OrderModify(2, Side::Buy, 100, 12)); // size increase goes to the back
+
+    Trades trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 100, 6});
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(trades[0].GetBidTrade().orderId_, 1);
+    ASSERT_EQ(trades[0].GetBidTrade().quantity_, 4);
+    ASSERT_EQ(trades[1].GetBidTrade().orderId_, 3);
+    ASSERT_EQ(trades[1].GetBidTrade().quantity_, 2);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetBids()[0].quantity_, 20);
+}
+
+TEST(TestGoodForDayExpiresOnAdvanceTime) {
+    using namespace std::chrono;
+    const auto day = sys_days{2024y / 1 / 2};
+    auto at = [&](hours h, minutes m = {}) { return time_point_cast<system_clock::duration>(day + h + m); };
+
+    Orderbook orderbook;
+    orderbook.SetDayResetTime(16, 0);
+    ASSERT_EQ(orderbook.AdvanceTime(at(hours(10))), 0); // arms the 16:00 close
+    orderbook.AddOrder(Order{OrderType::GoodForDay, 1, Side::Buy, 99, 10});
+    orderbook.AddOrder(Order{OrderType::GoodForDay, 2, Side::Buy, 98, 10});
+    orderbook.AddOrder(Order{OrderType::GoodForDay, 3, Side::Sell, 105, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 106, 10});
+    orderbook.CancelOrder(2);
+    orderbook.MatchOrder(OrderModify(3, Side::Sell, 104, 10)); // re-rests, still GoodForDay
+
+    ASSERT_EQ(orderbook.AdvanceTime(at(hours(15), minutes(59))), 0);
+    ASSERT_EQ(orderbook.AdvanceTime(at(hours(16))), 2);
+    ASSERT_EQ(orderbook.Size(), 1);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetAsks()[0].price_, 106);
+
+    // Next session, with the close given in local time five hours behind UTC
+    orderbook.SetDayResetTime(11, 0, hours(-5));
+    orderbook.AddOrder(Order{OrderType::GoodForDay, 5, Side::Buy, 99, 10});
+    ASSERT_EQ(orderbook.AdvanceTime(at(hours(24 + 9))), 0);
+    ASSERT_EQ(orderbook.AdvanceTime(at(hours(24 + 15), minutes(59))), 0);
+    ASSERT_EQ(orderbook.AdvanceTime(at(hours(24 + 16))), 1);
+    ASSERT_EQ(orderbook.Size(), 1);
+}
+
+TEST(TestCheckpointRestoresQueuePosition) {
+    Orderbook original;
+    ExchangeRules rules;
+    rules.maxQuantity = 5000;
+    original.SetExchangeRules(rules);
+    original.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 100, 10});
+    original.AddOrder(Order{OrderType::GoodForDay, 2, Side::Buy, 100, 20});
+    original.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 99, 30});
+    original.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 102, 40});
+    original.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Sell, 101, 50});
+    original.AddOrder(Order{OrderType::ImmediateOrCancel, 6, Side::Sell, 100, 4}); // order 1 left with 6
+    original.ProcessMarketData(CancelOrderMessage{MessageType::CancelOrder, 42, std::chrono::system_clock::now()});
+
+    std::stringstream image;
+    original.SaveCheckpoint(image);
+
+    Orderbook restored;
+    restored.LoadCheckpoint(image);
+    ASSERT_EQ(restored.Size(), 5);
+    ASSERT_EQ(restored.GetExchangeRules().maxQuantity, 5000);
+    ASSERT_EQ(restored.GetMarketDataStats().cancellations, 1);
+    auto before = original.GetOrderInfos();
+    auto after = restored.GetOrderInfos();
+    ASSERT_EQ(after.GetBids().size(), 2);
+    ASSERT_EQ(after.GetBids()[0].quantity_, before.GetBids()[0].quantity_);
+    ASSERT_EQ(after.GetAsks()[0].price_, 101);
+
+    // Queue position survived: order 1, partly filled, still trades ahead of order 2
+    std::vector<Trade> trades;
+    restored.AddOrder(Order{OrderType::ImmediateOrCancel, 7, Side::Sell, 100, 8},
+                      [&trades](const Trade &trade) { trades.push_back(trade); });
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(trades[0].GetBidTrade().orderId_, 1);
+    ASSERT_EQ(trades[0].GetBidTrade().quantity_, 6);
+    ASSERT_EQ(trades[1].GetBidTrade().orderId_, 2);
+
+    // GoodForDay tracking is rebuilt
+    restored.AdvanceTime(0);
+    ASSERT_EQ(restored.AdvanceTime(86'400'000'000'000LL), 1);
+
+    std::string corrupt = image.str();
+    corrupt[0] = 'X';
+    std::stringstream badImage(corrupt);
+    bool threw = false;
+    try {
+        restored.LoadCheckpoint(badImage);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+
+    std::stringstream truncated(image.str().substr(0, image.str().size() - 10));
+    threw = false;
+    try {
+        restored.LoadCheckpoint(truncated);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_EQ(restored.Size(), 0);
+
+    // An order count the image cannot hold is refused before anything is reserved
+    std::string inflated = image.str();
+    const std::uint64_t hugeCount = std::uint64_t{1} << 40;
+    std::memcpy(inflated.data() + offsetof(CheckpointHeader, orderCount), &hugeCount, sizeof(hugeCount));
+    std::stringstream inflatedImage(inflated);
+    threw = false;
+    try {
+        restored.LoadCheckpoint(inflatedImage);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_EQ(restored.Size(), 0);
+}
+
+TEST(TestBulkLoadSortsOnceAndRejectsCrosses) {
+    Orderbook orderbook;
+    const std::vector<OrderSpec> specs{
+        {OrderType::GoodTillCancel, 1, Side::Buy, 99, 10},
+        {OrderType::GoodTillCancel, 2, Side::Sell, 105, 10},
+        {OrderType::GoodForDay, 3, Side::Buy, 100, 20},
+        {OrderType::GoodTillCancel, 4, Side::Buy, 99, 30},
+        {OrderType::ImmediateOrCancel, 5, Side::Buy, 100, 5}, // cannot rest
+        {OrderType::GoodTillCancel, 6, Side::Sell, 103, 5},
+        {OrderType::GoodTillCancel, 1, Side::Sell, 110, 5},   // repeated id
+        {OrderType::GoodTillCancel, 7, Side::Buy, 98, 0},     // zero quantity
+    };
+    ASSERT_EQ(orderbook.BulkLoad(specs), 5);
+    ASSERT_EQ(orderbook.Size(), 5);
+
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids().size(), 2);
+    ASSERT_EQ(infos.GetBids()[0].price_, 100);
+    ASSERT_EQ(infos.GetBids()[1].quantity_, 40);
+    ASSERT_EQ(infos.GetAsks().size(), 2); // the repeated id's level is not left behind
+    ASSERT_EQ(infos.GetAsks()[0].price_, 103);
+
+    // Input order is queue order within a price
+    std::vector<Trade> trades;
+    orderbook.AddOrder(Order{OrderType::ImmediateOrCancel, 10, Side::Sell, 99, 35},
+                       [&trades](const Trade &trade) { trades.push_back(trade); });
+    ASSERT_EQ(trades.size(), 3);
+    ASSERT_EQ(trades[0].GetBidTrade().orderId_, 3);
+    ASSERT_EQ(trades[1].GetBidTrade().orderId_, 1);
+    ASSERT_EQ(trades[2].GetBidTrade().orderId_, 4);
+
+    // A batch that would cross the resting book loads nothing
+    const std::vector<OrderSpec> crossing{
+        {OrderType::GoodTillCancel, 20, Side::Buy, 101, 10},
+        {OrderType::GoodTillCancel, 21, Side::Buy, 104, 10},
+    };
+    bool threw = false;
+    try {
+        orderbook.BulkLoad(crossing);
+    } catch (const std::invalid_argument &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_EQ(orderbook.Size(), 3);
+
+    // Repeated ids are dropped before levels and the cross check: the second copy of
+    // 30 would cross, and 6 rests already, yet the batch loads and no level but 97 moves
+    std::vector<LevelDelta> deltas;
+    orderbook.SetLevelDeltaSink([&deltas](std::span<const LevelDelta> update) {
+        deltas.insert(deltas.end(), update.begin(), update.end());
+    });
+    deltas.clear();
+    const std::vector<OrderSpec> repeated{
+        {OrderType::GoodTillCancel, 30, Side::Buy, 97, 10},
+        {OrderType::GoodTillCancel, 30, Side::Buy, 106, 10},
+        {OrderType::GoodTillCancel, 6, Side::Buy, 96, 10},
+    };
+    ASSERT_EQ(orderbook.BulkLoad(repeated), 1);
+    ASSERT_EQ(deltas.size(), 1);
+    ASSERT_EQ(deltas[0].price, 97);
+    ASSERT_EQ(orderbook.GetLevelCount(Side::Buy), 2);
+}
+
 TEST(TestOrderbookLevelInfos) {
     Orderbook orderbook;
     orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
@@ -230,6 +620,280 @@ TEST(TestOrderbookLevelInfos) {
     ASSERT_EQ(infos.GetAsks()[0].quantity_, 20);
 }
 
+TEST(TestIncrementalLevelAggregates) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 100, 20});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Buy, 99, 30});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Buy, 98, 40});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Sell, 101, 5});
+
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 6, Side::Sell, 100, 15}); // partial fill of #2
+    orderbook.CancelOrder(3);
+
+    LevelInfos levels(8);
+    std::size_t count = orderbook.GetTopLevels(Side::Buy, levels);
+    ASSERT_EQ(count, 2);
+    ASSERT_EQ(levels[0].price_, 100);
+    ASSERT_EQ(levels[0].quantity_, 15);
+    ASSERT_EQ(levels[0].orderCount_, 1);
+    ASSERT_EQ(levels[1].price_, 98);
+    ASSERT_EQ(levels[1].orderCount_, 1);
+
+    // A short buffer only receives the best levels
+    std::span<LevelInfo> topOnly(levels.data(), 1);
+    ASSERT_EQ(orderbook.GetTopLevels(Side::Sell, topOnly), 1);
+    ASSERT_EQ(levels[0].price_, 101);
+    ASSERT_EQ(levels[0].quantity_, 5);
+}
+
+TEST(TestDepthKernelsMatchScalar) {
+    Orderbook orderbook;
+    OrderId orderId = 1;
+    for (Price price = 100; price < 137; ++price) { // 37 levels: full SIMD blocks plus a tail
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Sell, price,
+                                 static_cast<Quantity>(price % 7 + 1)});
+    }
+
+    std::vector<Price> prices(64);
+    std::vector<Quantity> quantities(64);
+    const std::size_t count = orderbook.GetTopLevels(Side::Sell, prices, quantities);
+    ASSERT_EQ(count, 37);
+    ASSERT_EQ(prices[0], 100);
+    ASSERT_EQ(quantities[0], 3);
+    const std::span<const Price> askPrices(prices.data(), count);
+    const std::span<const Quantity> askQuantities(quantities.data(), count);
+
+    for (std::size_t levels: {0, 1, 7, 8, 9, 36, 37, 100}) {
+        ASSERT_EQ(CumulativeDepth(askQuantities, levels), CumulativeDepthScalar(askQuantities, levels));
+    }
+    const std::uint64_t total = CumulativeDepth(askQuantities, count);
+    for (std::uint64_t threshold = 0; threshold <= total + 1; ++threshold) {
+        ASSERT_EQ(FirstLevelReaching(askQuantities, threshold), FirstLevelReachingScalar(askQuantities, threshold));
+    }
+    ASSERT_EQ(FirstLevelReaching(askQuantities, total + 1), count);
+
+    // Cost to sweep 10: 100x3 + 101x4 + 102x3 of the 5 at 102
+    const SweepCost cost = CostToSweep(askPrices, askQuantities, 10);
+    ASSERT_EQ(cost.filled, 10);
+    ASSERT_EQ(cost.levels, 3);
+    ASSERT_EQ(cost.notional, 100 * 3 + 101 * 4 + 102 * 3);
+    const SweepCost everything = CostToSweep(askPrices, askQuantities, total + 50);
+    ASSERT_EQ(everything.filled, total);
+    ASSERT_EQ(everything.levels, count);
+    ASSERT_EQ(everything.notional, NotionalScalar(askPrices, askQuantities, count));
+
+    // Negative and extreme prices multiply exactly
+    const std::vector<Price> signedPrices{-5, std::numeric_limits<Price>::min(), 7, std::numeric_limits<Price>::max(), -1};
+    const std::vector<Quantity> bigQuantities{4'000'000'000u, 3, 2, 1, 4'294'967'295u};
+    ASSERT_EQ(Notional(signedPrices, bigQuantities, 5), NotionalScalar(signedPrices, bigQuantities, 5));
+
+    // A level count past either array stops at the shorter one
+    const std::int64_t allLevels = NotionalScalar(askPrices, askQuantities, count);
+    for (std::size_t levels: {count, count + 1, std::size_t{1000}}) {
+        ASSERT_EQ(Notional(askPrices, askQuantities, levels), allLevels);
+        ASSERT_EQ(NotionalScalar(askPrices, askQuantities, levels), allLevels);
+    }
+    ASSERT_EQ(Notional(askPrices, askQuantities.first(9), 37), NotionalScalar(askPrices, askQuantities, 9));
+    ASSERT_EQ(Notional(askPrices.first(5), askQuantities, 37), NotionalScalar(askPrices, askQuantities, 5));
+}
+
+TEST(TestTopOfBookPublisherSnapshots) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 99, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+
+    TopOfBookPublisher publisher;
+    orderbook.SetTopOfBookPublisher(&publisher);
+    TopOfBook top = publisher.Read();
+    ASSERT_EQ(top.version, 1);
+    ASSERT_EQ(top.bidCount, 1);
+    ASSERT_EQ(top.askCount, 1);
+    ASSERT_EQ(top.BestBid().price_, 99);
+    ASSERT_EQ(top.BestAsk().quantity_, 5);
+
+    // A trade moves the top of book; a cancel of an unknown id does not publish
+    orderbook.AddOrder(Order{OrderType::ImmediateOrCancel, 3, Side::Buy, 101, 2});
+    ASSERT_EQ(publisher.GetVersion(), 2);
+    ASSERT_EQ(publisher.Read().BestAsk().quantity_, 3);
+    orderbook.CancelOrder(999);
+    ASSERT_EQ(publisher.GetVersion(), 2);
+
+    // A batch publishes once, at its end
+    std::vector<MarketDataEvent> events;
+    for (OrderId id = 10; id < 15; ++id) {
+        events.push_back(MarketDataEvent::NewOrder(id, Side::Buy, static_cast<Price>(90 + id - 10), 1,
+                                                   OrderType::GoodTillCancel));
+    }
+    orderbook.ProcessMarketDataBatch(std::span<const MarketDataEvent>(events));
+    top = publisher.Read();
+    ASSERT_EQ(top.version, 3);
+    ASSERT_EQ(top.bidCount, 6);
+    ASSERT_EQ(top.bids[1].price_, 94);
+
+    // Below the tenth level nothing publishes, until a published level empties
+    for (OrderId id = 20; id < 24; ++id) {
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, id, Side::Buy, static_cast<Price>(80 + id - 20), 1});
+    }
+    const std::uint64_t fullDepth = publisher.GetVersion();
+    ASSERT_EQ(publisher.Read().bidCount, 10);
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 30, Side::Buy, 50, 1});
+    ASSERT_EQ(publisher.GetVersion(), fullDepth);
+    orderbook.CancelOrder(20);
+    top = publisher.Read();
+    ASSERT_EQ(top.version, fullDepth + 1);
+    ASSERT_EQ(top.bids[9].price_, 50);
+    ASSERT_EQ(top.BestAsk().quantity_, 3);
+
+    // Readers on another thread only ever see whole publications: every level below
+    // carries quantity == price and the bids stay sorted, so a torn copy would show.
+    Orderbook churn;
+    TopOfBookPublisher churnPublisher;
+    churn.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 200, 200});
+    churn.SetTopOfBookPublisher(&churnPublisher);
+    std::atomic<bool> done{false};
+    bool consistent = true;
+    std::thread reader([&] {
+        while (!done.load(std::memory_order_acquire)) {
+            const TopOfBook snapshot = churnPublisher.Read();
+            if (snapshot.askCount != 1 || snapshot.BestAsk().price_ != 200) consistent = false;
+            for (std::uint32_t i = 0; i < snapshot.bidCount; ++i) {
+                const LevelInfo &level = snapshot.bids[i];
+                if (level.quantity_ != static_cast<Quantity>(level.price_) || level.orderCount_ != 1) consistent = false;
+                if (i > 0 && level.price_ >= snapshot.bids[i - 1].price_) consistent = false;
+            }
+        }
+    });
+    for (int round = 0; round < 20000; ++round) {
+        const Price price = static_cast<Price>(100 + round % 50);
+        const OrderId id = 100 + static_cast<OrderId>(round % 50);
+        if (round / 50 % 2 == 0) churn.AddOrder(Order{OrderType::GoodTillCancel, id, Side::Buy, price, static_cast<Quantity>(price)});
+        else                     churn.CancelOrder(id);
+    }
+    done.store(true, std::memory_order_release);
+    reader.join();
+    ASSERT_TRUE(consistent);
+    ASSERT_EQ(churnPublisher.Read().bidCount, 0);
+}
+
+TEST(TestLevelDeltasMirrorTheBook) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 99, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 102, 7});
+
+    std::vector<std::vector<LevelDelta> > updates;
+    orderbook.SetLevelDeltaSink([&updates](std::span<const LevelDelta> deltas) {
+        updates.emplace_back(deltas.begin(), deltas.end());
+    });
+
+    // Attaching reports the whole book as the first update
+    ASSERT_EQ(updates.size(), 1);
+    ASSERT_EQ(updates[0].size(), 3);
+    ASSERT_TRUE(updates[0][0].side == Side::Buy);
+    ASSERT_EQ(updates[0][1].price, 101);
+    ASSERT_EQ(updates[0][2].sequence, 1);
+
+    // A sweep through two levels is one update: the first level gone, the second cut
+    orderbook.AddOrder(Order{OrderType::ImmediateOrCancel, 4, Side::Buy, 102, 8});
+    ASSERT_EQ(updates.size(), 2);
+    ASSERT_EQ(updates[1].size(), 2);
+    ASSERT_EQ(updates[1][0].price, 101);
+    ASSERT_TRUE(updates[1][0].IsRemoval());
+    ASSERT_EQ(updates[1][1].quantity, 4);
+    ASSERT_EQ(updates[1][1].orderCount, 1);
+    ASSERT_EQ(updates[1][1].sequence, 2);
+
+    // Nothing changes, nothing is reported
+    orderbook.CancelOrder(999);
+    orderbook.AddOrder(Order{OrderType::ImmediateOrCancel, 5, Side::Buy, 100, 1});
+    ASSERT_EQ(updates.size(), 2);
+
+    // Through random churn, a mirror kept from deltas alone matches the full view
+    std::map<std::pair<Side, Price>, LevelDelta> mirror;
+    auto apply = [&mirror](std::span<const LevelDelta> deltas) {
+        for (const LevelDelta &delta: deltas) {
+            if (delta.IsRemoval()) mirror.erase({delta.side, delta.price});
+            else                   mirror[{delta.side, delta.price}] = delta;
+        }
+    };
+    for (const auto &update: updates) apply(update);
+    std::uint64_t lastSequence = updates.back().back().sequence;
+    bool gapFree = true;
+    orderbook.SetLevelDeltaSink([&](std::span<const LevelDelta> deltas) {
+        if (deltas.front().sequence != lastSequence + 1) gapFree = false;
+        lastSequence = deltas.front().sequence;
+        apply(deltas);
+    });
+
+    std::mt19937 gen(27);
+    for (OrderId id = 10; id < 5000; ++id) {
+        const Side side = (gen() % 2) ? Side::Buy : Side::Sell;
+        const Price price = static_cast<Price>(95 + gen() % 11);
+        const Quantity quantity = static_cast<Quantity>(1 + gen() % 20);
+        switch (gen() % 5) {
+            case 0: orderbook.CancelOrder(10 + gen() % (id - 9)); break;
+            case 1: orderbook.AddOrder(Order{OrderType::ImmediateOrCancel, id, side, price, quantity}); break;
+            case 2: orderbook.MatchOrder(OrderModify{10 + gen() % (id - 9), side, price, quantity}); break;
+            default: orderbook.AddOrder(Order{OrderType::GoodTillCancel, id, side, price, quantity}); break;
+        }
+    }
+    ASSERT_TRUE(gapFree);
+
+    const auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(mirror.size(), infos.GetBids().size() + infos.GetAsks().size());
+    for (const auto &[side, levels]: {std::pair{Side::Buy, infos.GetBids()}, std::pair{Side::Sell, infos.GetAsks()}}) {
+        for (const LevelInfo &level: levels) {
+            auto it = mirror.find({side, level.price_});
+            ASSERT_TRUE(it != mirror.end());
+            ASSERT_EQ(it->second.quantity, level.quantity_);
+            ASSERT_EQ(it->second.orderCount, level.orderCount_);
+        }
+    }
+}
+
+TEST(TestLevelDeltasSkipUnchangedLevels) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 99, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+
+    std::vector<std::vector<LevelDelta> > updates;
+    orderbook.SetLevelDeltaSink([&updates](std::span<const LevelDelta> deltas) {
+        updates.emplace_back(deltas.begin(), deltas.end());
+    });
+    ASSERT_EQ(updates.size(), 1);
+
+    // An in-place amend to the size the order already has changes nothing
+    orderbook.MatchOrder(OrderModify{1, Side::Buy, 99, 10});
+    ASSERT_EQ(updates.size(), 1);
+
+    // An order added and cancelled in one batch leaves its level as it was; only
+    // the level that really changed is reported, under the next sequence
+    const auto now = std::chrono::system_clock::now();
+    std::vector<MarketDataMessage> batch;
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 3, Side::Buy, 99, 4, OrderType::GoodTillCancel, now});
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 4, Side::Sell, 103, 4, OrderType::GoodTillCancel, now});
+    batch.push_back(CancelOrderMessage{MessageType::CancelOrder, 3, now});
+    orderbook.ProcessMarketDataBatch(batch);
+    ASSERT_EQ(updates.size(), 2);
+    ASSERT_EQ(updates[1].size(), 1);
+    ASSERT_EQ(updates[1][0].price, 103);
+    ASSERT_EQ(updates[1][0].sequence, 2);
+
+    // A level emptied and refilled to the same total and count is not reported either
+    batch.clear();
+    batch.push_back(CancelOrderMessage{MessageType::CancelOrder, 4, now});
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 5, Side::Sell, 103, 4, OrderType::GoodTillCancel, now});
+    orderbook.ProcessMarketDataBatch(batch);
+    ASSERT_EQ(updates.size(), 2);
+
+    // A different size is
+    orderbook.MatchOrder(OrderModify{1, Side::Buy, 99, 6});
+    ASSERT_EQ(updates.size(), 3);
+    ASSERT_EQ(updates[2][0].quantity, 6);
+    ASSERT_EQ(updates[2][0].sequence, 3);
+}
+
 TEST(TestExchangeRulesBasic) {
     Orderbook orderbook;
     ExchangeRules rules;
@@ -295,6 +959,957 @@ TEST(TestMarketOrderValidation) {
     ASSERT_TRUE(noTrades.empty()); // Rejected
 }
 
+TEST(TestOrderPoolReusesSlots) {
+    OrderPool pool;
+    OrderHandle first = pool.Acquire(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10);
+    OrderHandle second = pool.Acquire(OrderType::GoodTillCancel, 2, Side::Sell, 101, 20);
+    ASSERT_EQ(pool.Size(), 2);
+    ASSERT_EQ(pool.Get(second).GetOrderId(), 2);
+
+    pool.Release(first);
+    OrderHandle third = pool.Acquire(OrderType::GoodTillCancel, 3, Side::Buy, 99, 5);
+    ASSERT_EQ(third, first);                                  // freed slot is reused first
+    ASSERT_EQ(pool.Get(third).GetOrderId(), 3);
+    ASSERT_EQ(pool.Get(second).GetRemainingQuantity(), 20);   // neighbours untouched
+
+    bool threw = false;
+    try {
+        pool.Acquire(OrderType::GoodTillCancel, 4, Side::Buy, 100, 0);
+    } catch (const std::invalid_argument &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    ASSERT_EQ(pool.Size(), 2);
+}
+
+TEST(TestOrderPointerCompatibility) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 4});
+
+    // Caller-held OrderPointer reflects the fills it received on entry
+    auto order = std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Buy, 100, 10);
+    auto trades = orderbook.AddOrder(order);
+    ASSERT_EQ(trades.size(), 1);
+    ASSERT_EQ(order->GetRemainingQuantity(), 6);
+    ASSERT_EQ(orderbook.Size(), 1);
+
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids()[0].quantity_, 6);
+}
+
+TEST(TestLadderOrderbookBasics) {
+    LadderOrderbook orderbook(LadderConfig::FromBand(90, 110, 1));
+
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 95, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 98, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 105, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 102, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Buy, 120, 10}); // outside the band
+    ASSERT_EQ(orderbook.Size(), 4);
+
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids()[0].price_, 98);
+    ASSERT_EQ(infos.GetBids()[1].price_, 95);
+    ASSERT_EQ(infos.GetAsks()[0].price_, 102);
+    ASSERT_EQ(infos.GetAsks()[1].price_, 105);
+
+    // Emptying the best level moves the best price to the next non-empty slot
+    orderbook.CancelOrder(2);
+    auto trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 6, Side::Sell, 95, 4});
+    ASSERT_EQ(trades.size(), 1);
+    ASSERT_EQ(trades[0].GetBidTrade().orderId_, 1);
+
+    // Market orders sweep across the band like they do on the map book
+    trades = orderbook.AddOrder(Order{7, Side::Buy, 20});
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(trades[0].GetAskTrade().price_, 102);
+    ASSERT_EQ(trades[1].GetAskTrade().price_, 105);
+    ASSERT_EQ(orderbook.Size(), 1);
+}
+
+TEST(TestLadderScansAcrossBitmapWords) {
+    LadderOrderbook orderbook(LadderConfig::FromBand(1, 1000, 1));
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 3, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 900, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 3, Side::Sell, 950, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 999, 10});
+
+    orderbook.CancelOrder(2);
+    orderbook.CancelOrder(3);
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids().size(), 1);
+    ASSERT_EQ(infos.GetBids()[0].price_, 3);
+    ASSERT_EQ(infos.GetAsks().size(), 1);
+    ASSERT_EQ(infos.GetAsks()[0].price_, 999);
+}
+
+// The unfilled part of a market order is dropped. It used to rest as a good-till-cancel
+// order at the extreme price and would have filled every later order on the other side.
+template<typename Book>
+void CheckMarketRemainderIsDropped(Book &orderbook) {
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Sell, 100, 5});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Sell, 101, 5});
+
+    auto trades = orderbook.AddOrder(Order{3, Side::Buy, 25});
+    ASSERT_EQ(trades.size(), 2);
+    ASSERT_EQ(orderbook.Size(), 0);
+    ASSERT_TRUE(orderbook.GetOrderInfos().GetBids().empty());
+
+    // A later ask rests instead of trading against the leftover 15
+    trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 4, Side::Sell, 102, 5});
+    ASSERT_TRUE(trades.empty());
+    ASSERT_EQ(orderbook.Size(), 1);
+
+    // The same holds on the sell side
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 5, Side::Buy, 90, 5});
+    trades = orderbook.AddOrder(Order{6, Side::Sell, 8});
+    ASSERT_EQ(trades.size(), 1);
+    ASSERT_TRUE(orderbook.GetOrderInfos().GetBids().empty());
+    trades = orderbook.AddOrder(Order{OrderType::GoodTillCancel, 7, Side::Buy, 80, 5});
+    ASSERT_TRUE(trades.empty());
+    ASSERT_EQ(orderbook.Size(), 2);
+}
+
+TEST(TestMarketRemainderIsDropped) {
+    Orderbook mapBook;
+    CheckMarketRemainderIsDropped(mapBook);
+    LadderOrderbook ladderBook(LadderConfig::FromBand(50, 150, 1));
+    CheckMarketRemainderIsDropped(ladderBook);
+}
+
+TEST(TestMarketDataBatchDefersCrossing) {
+    Orderbook orderbook;
+    std::vector<MarketDataMessage> batch;
+    auto now = std::chrono::system_clock::now();
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 1, Side::Buy, 100, 10, OrderType::GoodTillCancel, now});
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 2, Side::Buy, 99, 10, OrderType::GoodTillCancel, now});
+    batch.push_back(CancelOrderMessage{MessageType::CancelOrder, 2, now});
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 3, Side::Sell, 100, 4, OrderType::GoodTillCancel, now});
+    batch.push_back(ModifyOrderMessage{MessageType::ModifyOrder, 1, Side::Buy, 101, 10, now});
+
+    ASSERT_EQ(orderbook.ProcessMarketDataBatch(batch), batch.size());
+
+    // The cross between #1 and #3 is matched once the batch completes
+    const auto &stats = orderbook.GetMarketDataStats();
+    ASSERT_EQ(stats.messagesProcessed, 5);
+    ASSERT_EQ(stats.newOrders, 3);
+    ASSERT_EQ(stats.cancellations, 1);
+    ASSERT_EQ(stats.modifications, 1);
+    ASSERT_EQ(stats.trades, 1);
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids().size(), 1);
+    ASSERT_EQ(infos.GetBids()[0].price_, 101);
+    ASSERT_EQ(infos.GetBids()[0].quantity_, 6);
+    ASSERT_TRUE(infos.GetAsks().empty());
+}
+
+TEST(TestMarketDataBatchAggressiveOrderSeesPendingAdds) {
+    Orderbook orderbook;
+    std::vector<MarketDataMessage> batch;
+    auto now = std::chrono::system_clock::now();
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 1, Side::Sell, 100, 5, OrderType::GoodTillCancel, now});
+    batch.push_back(NewOrderMessage{MessageType::NewOrder, 2, Side::Buy, 100, 10, OrderType::ImmediateOrCancel, now});
+
+    orderbook.ProcessMarketDataBatch(batch);
+    ASSERT_EQ(orderbook.GetMarketDataStats().trades, 1);
+    ASSERT_EQ(orderbook.Size(), 0);
+}
+
+TEST(TestMarketDataEventRoundTrip) {
+    auto now = std::chrono::system_clock::now();
+    MarketDataMessage message = ModifyOrderMessage{MessageType::ModifyOrder, 7, Side::Sell, 105, 20, now};
+    auto event = ToMarketDataEvent(message);
+    ASSERT_TRUE(event.has_value());
+    ASSERT_TRUE(event->kind == EventKind::ModifyOrder);
+    ASSERT_TRUE(event->GetSide() == Side::Sell);
+    ASSERT_EQ(event->price, 105);
+    ASSERT_EQ(event->quantity, 20);
+
+    auto decoded = std::get<ModifyOrderMessage>(ToMarketDataMessage(*event));
+    ASSERT_EQ(decoded.orderId, 7);
+    ASSERT_EQ(decoded.newPrice, 105);
+    ASSERT_TRUE(decoded.timestamp == now);
+
+    ASSERT_FALSE(ToMarketDataEvent(BookSnapshotMessage{}).has_value());
+}
+
+TEST(TestMarketDataEventProcessing) {
+    Orderbook orderbook;
+    std::vector<MarketDataEvent> batch{
+        MarketDataEvent::NewOrder(1, Side::Buy, 100, 10, OrderType::GoodTillCancel),
+        MarketDataEvent::NewOrder(2, Side::Buy, 99, 10, OrderType::GoodTillCancel),
+        MarketDataEvent::Cancel(2),
+        MarketDataEvent::NewOrder(3, Side::Sell, 100, 4, OrderType::GoodTillCancel),
+        MarketDataEvent::Modify(1, Side::Buy, 101, 10),
+    };
+    ASSERT_EQ(orderbook.ProcessMarketDataBatch(batch), batch.size());
+    ASSERT_TRUE(orderbook.ProcessMarketData(MarketDataEvent::Trade(1, 3, 100, 4)));
+
+    const auto &stats = orderbook.GetMarketDataStats();
+    ASSERT_EQ(stats.messagesProcessed, 6);
+    ASSERT_EQ(stats.trades, 2);
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids().size(), 1);
+    ASSERT_EQ(infos.GetBids()[0].quantity_, 6);
+    ASSERT_TRUE(infos.GetAsks().empty());
+
+    // A corrupt kind byte is an error on both paths, never a processed message
+    MarketDataEvent corrupt = MarketDataEvent::Cancel(1);
+    corrupt.kind = static_cast<EventKind>(200);
+    ASSERT_FALSE(orderbook.ProcessMarketData(corrupt));
+    const std::vector<MarketDataEvent> corruptBatch{corrupt, MarketDataEvent::Trade(1, 3, 100, 1)};
+    ASSERT_EQ(orderbook.ProcessMarketDataBatch(corruptBatch), 1);
+    ASSERT_EQ(stats.messagesProcessed, 7);
+    ASSERT_EQ(stats.errors, 2);
+    ASSERT_EQ(orderbook.Size(), 1);
+}
+
+TEST(TestSpscQueueWrapsAndRejectsWhenFull) {
+    SpscQueue<int> queue(3);
+    ASSERT_EQ(queue.Capacity(), 4);
+
+    int value = 0;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) ASSERT_TRUE(queue.TryPush(round * 10 + i));
+        ASSERT_FALSE(queue.TryPush(99));
+        ASSERT_EQ(queue.Size(), 4);
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(queue.TryPop(value));
+            ASSERT_EQ(value, round * 10 + i);
+        }
+        ASSERT_FALSE(queue.TryPop(value));
+    }
+}
+
+TEST(TestMarketDataPipelineDrainsOnStop) {
+    Orderbook orderbook;
+    MarketDataPipeline<> pipeline(orderbook, 256);
+    std::size_t applied = 0;
+    pipeline.SetOnApplied([&applied](const Orderbook &, const MarketDataMessage &) { ++applied; });
+    pipeline.Start();
+
+    auto now = std::chrono::system_clock::now();
+    std::thread producer([&] {
+        for (OrderId id = 0; id < 5000; ++id) {
+            NewOrderMessage msg{MessageType::NewOrder, id, Side::Buy, static_cast<Price>(100 + id % 50), 10,
+                                OrderType::GoodTillCancel, now};
+            while (!pipeline.Publish(msg)) std::this_thread::yield();
+        }
+    });
+    producer.join();
+    pipeline.Stop();
+
+    auto stats = pipeline.GetStats();
+    ASSERT_EQ(stats.processed, 5000);
+    ASSERT_EQ(stats.depth, 0);
+    ASSERT_TRUE(stats.maxDepth <= pipeline.Capacity());
+    ASSERT_EQ(applied, 5000);
+    ASSERT_EQ(orderbook.Size(), 5000);
+    // Publishes that hit a full ring were counted as drops, not enqueues
+    ASSERT_EQ(stats.enqueued, 5000);
+}
+
+TEST(TestOrderbookManagerRoutesBySymbol) {
+    OrderbookManager manager(2, 64);
+    SymbolId btc = manager.AddSymbol("BTCUSDT");
+    SymbolId eth = manager.AddSymbol("ETHUSDT");
+    ASSERT_EQ(manager.AddSymbol("BTCUSDT"), btc);
+    ASSERT_TRUE(manager.ShardOf(btc) != manager.ShardOf(eth));
+    manager.Start(false);
+
+    auto now = std::chrono::system_clock::now();
+    for (OrderId id = 0; id < 1000; ++id) {
+        SymbolId symbol = (id % 4 == 0) ? eth : btc;
+        NewOrderMessage msg{MessageType::NewOrder, id, Side::Sell, 100, 1, OrderType::GoodTillCancel, now};
+        while (!manager.Route(symbol, msg)) std::this_thread::yield();
+    }
+    ASSERT_FALSE(manager.Route("XRPUSDT", CancelOrderMessage{MessageType::CancelOrder, 1, now}));
+    ASSERT_FALSE(manager.Route(SymbolId{2}, CancelOrderMessage{MessageType::CancelOrder, 1, now}));
+    manager.Stop();
+
+    ASSERT_EQ(manager.GetBook(btc).Size(), 750);
+    ASSERT_EQ(manager.GetBook(eth).Size(), 250);
+    ASSERT_EQ(manager.GetTotalStats().processed, 1000);
+}
+
+TEST(TestOrderbookManagerOnAppliedWithIdleSleep) {
+    OrderbookManager manager(1, 64);
+    SymbolId btc = manager.AddSymbol("BTCUSDT");
+    SymbolId eth = manager.AddSymbol("ETHUSDT");
+    std::array<std::size_t, 2> applied{};
+    std::array<std::size_t, 2> lastSize{};
+    manager.SetOnApplied([&](SymbolId symbol, const Orderbook &book, const MarketDataMessage &) {
+        ++applied[symbol];
+        lastSize[symbol] = book.Size();
+    });
+    manager.SetIdleSleep(std::chrono::microseconds(200));
+    manager.Start(false);
+
+    auto now = std::chrono::system_clock::now();
+    for (OrderId id = 0; id < 30; ++id) {
+        SymbolId symbol = (id % 3 == 0) ? eth : btc;
+        NewOrderMessage msg{MessageType::NewOrder, id, Side::Buy, 100, 1, OrderType::GoodTillCancel, now};
+        while (!manager.Route(symbol, msg)) std::this_thread::yield();
+        if (id == 15) std::this_thread::sleep_for(std::chrono::milliseconds(5)); // let the shard go idle
+    }
+    bool threw = false;
+    try {
+        manager.SetIdleSleep(std::chrono::microseconds(0));
+    } catch (const std::logic_error &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+    manager.Stop();
+
+    ASSERT_EQ(applied[btc], 20);
+    ASSERT_EQ(applied[eth], 10);
+    ASSERT_EQ(lastSize[btc], 20);
+    ASSERT_EQ(lastSize[eth], 10);
+}
+
+TEST(TestLatencyHistogramPercentiles) {
+    LatencyHistogram histogram;
+    for (std::uint64_t ns = 1; ns <= 1000; ++ns) histogram.Record(ns);
+    histogram.Record(250000); // one slow outlier
+
+    ASSERT_EQ(histogram.Count(), 1001);
+    ASSERT_EQ(histogram.Min(), 1);
+    ASSERT_EQ(histogram.Max(), 250000);
+    // Buckets keep values to within ~3%
+    ASSERT_TRUE(histogram.P50() >= 500 && histogram.P50() <= 516);
+    ASSERT_TRUE(histogram.P99() >= 990 && histogram.P99() <= 1023);
+    ASSERT_EQ(histogram.ValueAtPercentile(100.0), 250000);
+
+    LatencyHistogram other;
+    other.Record(20, 1001);
+    histogram.Merge(other);
+    ASSERT_EQ(histogram.Count(), 2002);
+    ASSERT_TRUE(histogram.P50() <= 32);
+
+    for (std::uint64_t value: {0ull, 31ull, 32ull, 1000ull, 123456789ull}) {
+        std::size_t index = LatencyHistogram::IndexOf(value);
+        ASSERT_TRUE(LatencyHistogram::LowestInBucket(index) <= value);
+        ASSERT_TRUE(LatencyHistogram::HighestInBucket(index) >= value);
+    }
+}
+
+TEST(TestMarketDataStatsRecordNanosPerType) {
+    BasicOrderbook<MapBookSide, FullInstrumentation<TscClock> > orderbook;
+    auto now = std::chrono::system_clock::now();
+    for (OrderId id = 0; id < 100; ++id) {
+        orderbook.ProcessMarketData(NewOrderMessage{MessageType::NewOrder, id, Side::Buy, 100, 1,
+                                                    OrderType::GoodTillCancel, now});
+    }
+    orderbook.ProcessMarketData(CancelOrderMessage{MessageType::CancelOrder, 5, now});
+
+    const auto &stats = orderbook.GetMarketDataStats();
+    ASSERT_EQ(stats.GetLatency(MessageType::NewOrder).Count(), 100);
+    ASSERT_EQ(stats.GetLatency(MessageType::CancelOrder).Count(), 1);
+    ASSERT_EQ(stats.GetLatency(MessageType::BookSnapshot).Count(), 0);
+    ASSERT_EQ(stats.GetCombinedLatency().Count(), 101);
+    ASSERT_TRUE(stats.GetAverageLatencyNanos() > 0.0);
+}
+
+TEST(TestInstrumentationPolicies) {
+    BasicOrderbook<MapBookSide, NoInstrumentation> quiet;
+    BasicOrderbook<MapBookSide, CountingInstrumentation> counting;
+    BasicOrderbook<MapBookSide, FullInstrumentation<> > full;
+    Orderbook standard;
+    auto now = std::chrono::system_clock::now();
+    std::vector<MarketDataMessage> feed{
+        NewOrderMessage{MessageType::NewOrder, 1, Side::Sell, 100, 5, OrderType::GoodTillCancel, now},
+        NewOrderMessage{MessageType::NewOrder, 2, Side::Buy, 100, 3, OrderType::GoodTillCancel, now},
+        CancelOrderMessage{MessageType::CancelOrder, 1, now},
+    };
+    for (const auto &message: feed) {
+        quiet.ProcessMarketData(message);
+        counting.ProcessMarketData(message);
+        full.ProcessMarketData(message);
+        standard.ProcessMarketData(message);
+    }
+
+    // The book behaves the same under every policy; only the bookkeeping differs
+    ASSERT_EQ(quiet.Size(), 0);
+    ASSERT_EQ(counting.Size(), 0);
+    ASSERT_EQ(quiet.GetMarketDataStats().messagesProcessed, 0);
+    ASSERT_EQ(counting.GetMarketDataStats().messagesProcessed, 3);
+    ASSERT_EQ(counting.GetMarketDataStats().trades, 1);
+    ASSERT_EQ(counting.GetMarketDataStats().GetCombinedLatency().Count(), 0);
+    ASSERT_EQ(full.GetMarketDataStats().GetCombinedLatency().Count(), 3);
+    ASSERT_EQ(full.GetPhaseLatency(Phase::Validate).Count(), 2);
+    ASSERT_EQ(full.GetPhaseLatency(Phase::Match).Count(), 2);
+    ASSERT_TRUE(full.GetPhaseLatency(Phase::Cancel).Count() >= 1);
+    static_assert(sizeof(quiet) < sizeof(full));
+
+    // The default book times messages but leaves the phase timers out
+    ASSERT_EQ(standard.GetMarketDataStats().GetCombinedLatency().Count(), 3);
+    auto hasPhaseTimers = [](const auto &book) { return requires { book.GetPhaseLatency(Phase::Match); }; };
+    ASSERT_FALSE(hasPhaseTimers(standard));
+    ASSERT_TRUE(hasPhaseTimers(full));
+    static_assert(sizeof(standard) < sizeof(full));
+}
+
+TEST(TestCaptureRecordAndReplay) {
+    const auto path = std::filesystem::temp_directory_path() / "orderbook_capture_test.bin";
+    std::filesystem::remove(path);
+    auto now = std::chrono::system_clock::now();
+
+    BookSnapshotMessage snapshot;
+    snapshot.sequenceNumber = 41;
+    snapshot.timestamp = now;
+    snapshot.bids = {{100, 10, 1}, {99, 20, 2}};
+    snapshot.asks = {{101, 5, 1}};
+    std::vector<MarketDataMessage> messages{
+        snapshot,
+        NewOrderMessage{MessageType::NewOrder, 1, Side::Sell, 100, 4, OrderType::GoodTillCancel, now},
+        CancelOrderMessage{MessageType::CancelOrder, 999, now},
+    };
+    {
+        CaptureWriter writer(path, "BTCUSDT", "2024-01-02");
+        writer.Write(messages[0]);
+        writer.Write(messages[1]);
+        ASSERT_EQ(writer.GetRecordsWritten(), 6); // begin + 3 levels + end, then the add
+    }
+    {
+        // Reopening appends instead of truncating
+        CaptureWriter writer(path, "ignored", "ignored");
+        writer.Write(messages[2]);
+    }
+
+    CaptureReader reader(path);
+    ASSERT_TRUE(reader.GetHeader().GetSymbol() == "BTCUSDT");
+    ASSERT_TRUE(reader.GetHeader().GetSessionDate() == "2024-01-02");
+    ASSERT_EQ(reader.Events().size(), 7);
+    ASSERT_EQ(DecodeMarketDataEvents(reader.Events()).size(), messages.size());
+
+    Orderbook direct, replayed;
+    for (const auto &message: messages) direct.ProcessMarketData(message);
+    ReplayResult result = ReplayCapture(replayed, reader, ReplayOptions{2, 0.0});
+    ASSERT_EQ(result.events, 7);
+    ASSERT_EQ(replayed.GetLastSequenceNumber(), 41);
+    ASSERT_EQ(replayed.GetMarketDataStats().snapshots, 1);
+    ASSERT_EQ(replayed.Size(), direct.Size());
+    auto expected = direct.GetOrderInfos();
+    auto actual = replayed.GetOrderInfos();
+    ASSERT_EQ(actual.GetBids().size(), expected.GetBids().size());
+    ASSERT_EQ(actual.GetBids()[0].quantity_, expected.GetBids()[0].quantity_);
+    ASSERT_EQ(actual.GetAsks().size(), expected.GetAsks().size());
+
+    std::filesystem::remove(path);
+}
+
+TEST(TestWorkStealingPoolRunsAndSteals) {
+    std::atomic<int> done{0};
+    {
+        WorkStealingPool pool(4, false);
+        // Every task dealt to worker 0 blocks it for a while: the others must steal
+        // the short ones queued behind the long ones to finish on time.
+        for (int i = 0; i < 64; ++i) {
+            pool.Submit([&done, i] {
+                if (i % 4 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                ++done;
+            });
+        }
+        pool.Wait();
+        ASSERT_EQ(done.load(), 64);
+        ASSERT_TRUE(pool.GetStealCount() > 0);
+
+        // Tasks may submit more work; Wait covers it, and rethrows the first error
+        pool.Submit([&pool, &done] { pool.Submit([&done] { ++done; }); });
+        pool.Submit([] { throw std::runtime_error("task failed"); });
+        bool threw = false;
+        try {
+            pool.Wait();
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        ASSERT_TRUE(threw);
+        ASSERT_EQ(done.load(), 65);
+    }
+}
+
+TEST(TestOrderPoolFillsLowestChunkFirst) {
+    OrderPool pool;
+    std::vector<OrderHandle> handles;
+    for (OrderId id = 1; id <= 2 * OrderPool::ChunkSize; ++id) {
+        handles.push_back(pool.Acquire(OrderType::GoodTillCancel, id, Side::Buy, 100, 10));
+    }
+    ASSERT_EQ(pool.ChunkCount(), 2);
+
+    // A slot freed in the first chunk is reused before the second chunk's free slots
+    pool.Release(handles.back());
+    pool.Release(handles[5]);
+    OrderHandle reused = pool.Acquire(OrderType::GoodTillCancel, 9001, Side::Buy, 100, 10);
+    ASSERT_EQ(reused, handles[5]);
+
+    // Relocation only moves orders down, relinks their neighbours and frees the old slot
+    OrderHandle top = handles[handles.size() - 2];
+    pool.SetNext(handles[OrderPool::ChunkSize], top);
+    pool.SetPrev(top, handles[OrderPool::ChunkSize]);
+    pool.Release(handles[7]);
+    OrderHandle moved = pool.Relocate(top);
+    ASSERT_EQ(moved, handles[7]);
+    ASSERT_EQ(pool.Get(moved).GetOrderId(), OrderId(2 * OrderPool::ChunkSize - 1));
+    ASSERT_EQ(pool.Next(handles[OrderPool::ChunkSize]), moved);
+    ASSERT_FALSE(pool.IsLive(top));
+    ASSERT_EQ(pool.Relocate(handles[0]), handles[0]);
+    ASSERT_FALSE(pool.ReleaseTopChunk());
+}
+
+TEST(TestCompactionSlicesStayNearBudget) {
+    // A book large enough that the drain and the index rebuild each take many slices
+    Orderbook orderbook;
+    for (OrderId id = 1; id <= 200000; ++id) {
+        const Side side = (id % 2) ? Side::Buy : Side::Sell;
+        const Price price = (side == Side::Buy) ? 1000 - Price(id % 200) : 1001 + Price(id % 200);
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, id, side, price, 10});
+    }
+    for (OrderId id = 1; id <= 200000; ++id) {
+        if (id % 20 != 0) orderbook.CancelOrder(id);
+    }
+    const MemoryUsage before = orderbook.GetMemoryUsage();
+
+    const auto budget = std::chrono::microseconds{1000};
+    int slices = 0;
+    std::chrono::nanoseconds longest{0};
+    for (bool done = false; !done; ++slices) {
+        const auto start = std::chrono::steady_clock::now();
+        done = orderbook.Compact(budget);
+        longest = std::max(longest, std::chrono::steady_clock::now() - start);
+        // Traffic between slices: the rebuild mirrors it, so nothing is lost
+        const OrderId id = 300000 + static_cast<OrderId>(slices);
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, id, Side::Buy, 900, 1});
+        if (slices % 2) orderbook.CancelOrder(id);
+    }
+    ASSERT_TRUE(slices > 2);
+    ASSERT_TRUE(longest < 3 * budget);
+    ASSERT_TRUE(orderbook.GetMemoryUsage().orderIndex * 4 <= before.orderIndex);
+
+    // Every resting order, including those added mid-rebuild, is still found through
+    // the rebuilt index: cancelling them all by id empties every level
+    for (OrderId id = 20; id <= 200000; id += 20) orderbook.CancelOrder(id);
+    for (int slice = 0; slice < slices; slice += 2) orderbook.CancelOrder(300000 + static_cast<OrderId>(slice));
+    const auto levels = orderbook.GetOrderInfos();
+    ASSERT_TRUE(levels.GetBids().empty() && levels.GetAsks().empty());
+    ASSERT_EQ(orderbook.Size(), 0);
+}
+
+TEST(TestCompactionReclaimsPeakMemory) {
+    // Peak: 20000 orders over 100 levels a side. Afterwards one in 20 stays, scattered
+    // over every pool chunk.
+    Orderbook orderbook;
+    for (OrderId id = 1; id <= 20000; ++id) {
+        const Side side = (id % 2) ? Side::Buy : Side::Sell;
+        const Price price = (side == Side::Buy) ? 1000 - Price(id % 100) : 1001 + Price(id % 100);
+        orderbook.AddOrder(Order{(id % 3) ? OrderType::GoodTillCancel : OrderType::GoodForDay, id, side, price, 10});
+    }
+    const MemoryUsage peak = orderbook.GetMemoryUsage();
+    for (OrderId id = 1; id <= 20000; ++id) {
+        if (id % 40 > 1) orderbook.CancelOrder(id);
+    }
+    ASSERT_EQ(orderbook.Size(), 1000);
+    const auto levels = orderbook.GetOrderInfos();
+    const MemoryUsage before = orderbook.GetMemoryUsage();
+    ASSERT_EQ(before.orders, 1000 * OrderPool::SlotBytes());
+    ASSERT_EQ(before.Total(), before.levels + before.orderIndex + before.orders + before.pools + before.buffers);
+    ASSERT_TRUE(before.levels < peak.levels);
+    ASSERT_EQ(before.pools + before.orders, peak.pools + peak.orders); // the pool never shrinks on its own
+
+    // Zero-length slices still make progress and finish in a bounded number of calls
+    int slices = 1;
+    while (!orderbook.Compact(std::chrono::nanoseconds{0})) ++slices;
+    ASSERT_TRUE(slices > 1);
+    ASSERT_TRUE(orderbook.Compact(std::chrono::milliseconds{10}));
+
+    const MemoryUsage after = orderbook.GetMemoryUsage();
+    ASSERT_EQ(after.orders, before.orders);
+    ASSERT_TRUE(after.pools + after.orders <= 2 * OrderPool::ChunkSize * OrderPool::SlotBytes() + 4096);
+    ASSERT_TRUE(after.orderIndex * 4 <= before.orderIndex);
+    ASSERT_TRUE(after.Total() < before.Total());
+
+    // Same book, same queues: levels unchanged, every id still found, FIFO order kept
+    const auto compacted = orderbook.GetOrderInfos();
+    ASSERT_EQ(compacted.GetBids().size(), levels.GetBids().size());
+    for (std::size_t i = 0; i < levels.GetBids().size(); ++i) {
+        ASSERT_EQ(compacted.GetBids()[i].price_, levels.GetBids()[i].price_);
+        ASSERT_EQ(compacted.GetBids()[i].quantity_, levels.GetBids()[i].quantity_);
+    }
+    const Price bestAsk = levels.GetAsks()[0].price_;
+    Trades trades = orderbook.AddOrder(Order{OrderType::ImmediateOrCancel, 90000, Side::Buy, bestAsk, 30});
+    ASSERT_EQ(trades.size(), 3);
+    ASSERT_TRUE(trades[0].GetAskTrade().orderId_ < trades[1].GetAskTrade().orderId_);
+    ASSERT_TRUE(trades[1].GetAskTrade().orderId_ < trades[2].GetAskTrade().orderId_);
+    orderbook.CancelOrder(40);
+    ASSERT_EQ(orderbook.Size(), 996);
+    ASSERT_EQ(orderbook.ExpireGoodForDayOrders(), 331);
+}
+
+TEST(TestBacktestReplaysEachSymbolDay) {
+    const auto directory = std::filesystem::temp_directory_path() / "orderbook_backtest_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    // Two symbols over two days; the first day of BTCUSDT is split over two files
+    const auto now = std::chrono::system_clock::now();
+    auto write = [&](const std::string &name, const std::string &symbol, const std::string &date,
+                     OrderId firstId, int orders) {
+        CaptureWriter writer(directory / name, symbol, date);
+        for (int i = 0; i < orders; ++i) {
+            const OrderId id = firstId + static_cast<OrderId>(i);
+            const Side side = i % 2 ? Side::Sell : Side::Buy;
+            writer.Write(NewOrderMessage{MessageType::NewOrder, id, side, static_cast<Price>(100 + i % 3), 10,
+                                         OrderType::GoodTillCancel, now});
+        }
+    };
+    write("btc-1a.cap", "BTCUSDT", "2024-01-02", 1, 40);
+    write("btc-1b.cap", "BTCUSDT", "2024-01-02", 1000, 20);
+    write("btc-2.cap", "BTCUSDT", "2024-01-03", 1, 30);
+    write("eth-1.cap", "ETHUSDT", "2024-01-02", 1, 50);
+    write("eth-2.cap", "ETHUSDT", "2024-01-03", 1, 10);
+
+    // A report left in the directory is skipped, but naming it explicitly is an error
+    std::ofstream(directory / "report.csv") << "symbol,date\n";
+    std::vector<std::filesystem::path> skipped;
+    const std::vector<std::filesystem::path> inputs{directory};
+    const std::vector<BacktestJob> jobs = PlanBacktest(inputs, &skipped);
+    ASSERT_EQ(skipped.size(), 1);
+    ASSERT_TRUE(skipped[0].filename() == "report.csv");
+    ASSERT_EQ(jobs.size(), 4);
+    bool rejected = false;
+    try {
+        const std::vector<std::filesystem::path> named{directory, directory / "report.csv"};
+        PlanBacktest(named);
+    } catch (const std::runtime_error &) {
+        rejected = true;
+    }
+    ASSERT_TRUE(rejected);
+    ASSERT_TRUE(jobs[0].symbol == "BTCUSDT" && jobs[0].sessionDate == "2024-01-02");
+    ASSERT_EQ(jobs[0].files.size(), 2);
+    ASSERT_EQ(jobs[0].events, 60);
+
+    BacktestOptions options;
+    options.threads = 3;
+    options.pinCores = false;
+    const BacktestSummary summary = RunBacktest(jobs, options);
+    ASSERT_EQ(summary.failed, 0);
+    ASSERT_EQ(summary.events, 150);
+    ASSERT_EQ(summary.total.newOrders, 150);
+
+    // Each job matches a serial replay of its own files on a fresh book
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        const BacktestResult serial = RunBacktestJob(jobs[i], options.replay);
+        const BacktestResult &parallel = summary.results[i];
+        ASSERT_TRUE(parallel.symbol == jobs[i].symbol);
+        ASSERT_EQ(parallel.files, jobs[i].files.size());
+        ASSERT_EQ(parallel.stats.trades, serial.stats.trades);
+        ASSERT_EQ(parallel.restingOrders, serial.restingOrders);
+        ASSERT_EQ(parallel.bestBid.has_value(), serial.bestBid.has_value());
+        ASSERT_EQ(parallel.captures.size(), jobs[i].files.size());
+    }
+
+    // Per-file rows split the job: the day's second file carries only its own trades
+    // and the top of book as it stood after it
+    const BacktestResult &splitDay = summary.results[0];
+    ASSERT_TRUE(splitDay.captures[0].file.filename() == "btc-1a.cap");
+    ASSERT_EQ(splitDay.captures[0].replay.events, 40);
+    ASSERT_EQ(splitDay.captures[0].trades + splitDay.captures[1].trades, splitDay.stats.trades);
+    ASSERT_EQ(splitDay.captures[1].bestAsk.has_value(), splitDay.bestAsk.has_value());
+    if (splitDay.bestBid) ASSERT_EQ(splitDay.captures[1].bestBid->price_, splitDay.bestBid->price_);
+    ASSERT_TRUE(summary.total.trades > 0);
+    std::filesystem::remove_all(directory);
+}
+
+TEST(TestStraySnapshotRecordsAreRejected) {
+    Orderbook orderbook;
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 1, Side::Buy, 100, 10});
+    orderbook.AddOrder(Order{OrderType::GoodTillCancel, 2, Side::Buy, 100, 20});
+
+    // A level or end record with no SnapshotBegin before it leaves the L3 orders alone
+    ASSERT_FALSE(orderbook.ProcessMarketData(MarketDataEvent::SnapshotLevel(Side::Buy, 100, 5, 1)));
+    ASSERT_FALSE(orderbook.ProcessMarketData(MarketDataEvent::SnapshotEnd(7)));
+    ASSERT_EQ(orderbook.GetMarketDataStats().errors, 2);
+    ASSERT_EQ(orderbook.Size(), 2);
+    ASSERT_FALSE(orderbook.IsInitialized());
+
+    // A complete run applies, and the End record closes it
+    ASSERT_TRUE(orderbook.ProcessMarketData(MarketDataEvent::SnapshotBegin(8)));
+    ASSERT_TRUE(orderbook.ProcessMarketData(MarketDataEvent::SnapshotLevel(Side::Buy, 99, 5, 1)));
+    ASSERT_TRUE(orderbook.ProcessMarketData(MarketDataEvent::SnapshotEnd(8)));
+    ASSERT_TRUE(orderbook.IsInitialized());
+    ASSERT_EQ(orderbook.Size(), 1);
+    ASSERT_FALSE(orderbook.ProcessMarketData(MarketDataEvent::SnapshotEnd(9)));
+    ASSERT_EQ(orderbook.GetLastSequenceNumber(), 8);
+}
+
+TEST(TestSnapshotAppliesAsDiff) {
+    Orderbook orderbook;
+    orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 7, Side::Buy, 100, 3));
+
+    BookSnapshotMessage snapshot;
+    snapshot.sequenceNumber = 1;
+    snapshot.bids = {{100, 10, 1}, {99, 20, 1}, {98, 30, 1}};
+    snapshot.asks = {{101, 5, 1}, {102, 6, 1}};
+    orderbook.ProcessMarketData(snapshot);
+    ASSERT_EQ(orderbook.Size(), 5);
+    orderbook.CancelOrder(7); // the real order was replaced by the level, so this is a no-op
+    ASSERT_EQ(orderbook.Size(), 5);
+
+    // One size change, one level gone, one new level: the untouched levels and the
+    // restated one keep their synthetic orders and allocate nothing
+    snapshot.sequenceNumber = 2;
+    snapshot.bids = {{100, 10, 1}, {99, 25, 1}};
+    snapshot.asks = {{101, 5, 1}, {102, 6, 1}, {103, 7, 1}};
+    orderbook.ProcessMarketData(snapshot);
+    snapshot.sequenceNumber = 3;
+    snapshot.bids[1].quantity = 15;
+    const MarketDataMessage restated{snapshot};
+    const std::size_t allocationsBefore = allocationCount;
+    orderbook.ProcessMarketData(restated);
+    ASSERT_EQ(allocationCount - allocationsBefore, 0);
+
+    ASSERT_EQ(orderbook.GetLastSequenceNumber(), 3);
+    ASSERT_EQ(orderbook.Size(), 5);
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids().size(), 2);
+    ASSERT_EQ(infos.GetBids()[1].price_, 99);
+    ASSERT_EQ(infos.GetBids()[1].quantity_, 15);
+    ASSERT_EQ(infos.GetAsks().size(), 3);
+    ASSERT_EQ(infos.GetAsks()[2].quantity_, 7);
+}
+
+DepthUpdateMessage MakeDepthUpdate(std::uint64_t first, std::uint64_t last,
+                                   std::vector<SnapshotLevel> bids, std::vector<SnapshotLevel> asks = {}) {
+    DepthUpdateMessage update;
+    update.firstSequence = first;
+    update.lastSequence = last;
+    update.bids = std::move(bids);
+    update.asks = std::move(asks);
+    return update;
+}
+
+TEST(TestDepthUpdatesFollowSequence) {
+    BookSnapshotMessage snapshot;
+    snapshot.sequenceNumber = 100;
+    snapshot.bids = {{100, 10, 1}, {99, 20, 1}};
+    snapshot.asks = {{101, 5, 1}};
+
+    Orderbook orderbook;
+    orderbook.ProcessMarketData(snapshot);
+    orderbook.ProcessMarketData(MakeDepthUpdate(90, 100, {{100, 1, 1}}));          // stale
+    orderbook.ProcessMarketData(MakeDepthUpdate(95, 102, {{100, 7, 1}, {99, 0, 1}}, {{102, 3, 1}}));
+    ASSERT_EQ(orderbook.GetLastSequenceNumber(), 102);
+    auto infos = orderbook.GetOrderInfos();
+    ASSERT_EQ(infos.GetBids().size(), 1);
+    ASSERT_EQ(infos.GetBids()[0].quantity_, 7);
+    ASSERT_EQ(infos.GetAsks().size(), 2);
+
+    // Losing 103..104 is counted and freezes the book until the next snapshot
+    orderbook.ProcessMarketData(MakeDepthUpdate(105, 106, {{98, 4, 1}}));
+    orderbook.ProcessMarketData(MakeDepthUpdate(107, 107, {{97, 4, 1}}));
+    const auto &stats = orderbook.GetMarketDataStats();
+    ASSERT_EQ(stats.sequenceGaps, 1);
+    ASSERT_EQ(stats.depthUpdates, 1);
+    ASSERT_FALSE(orderbook.IsInitialized());
+    ASSERT_EQ(orderbook.GetOrderInfos().GetBids().size(), 1);
+
+    // The record encoding applies the same way
+    std::vector<MarketDataEvent> events;
+    AppendMarketDataEvents(MarketDataMessage{snapshot}, events);
+    AppendMarketDataEvents(MarketDataMessage{MakeDepthUpdate(101, 101, {{99, 0, 1}})}, events);
+    Orderbook replayed;
+    replayed.ProcessMarketDataBatch(events);
+    ASSERT_EQ(replayed.GetLastSequenceNumber(), 101);
+    ASSERT_EQ(replayed.GetOrderInfos().GetBids().size(), 1);
+    ASSERT_EQ(DecodeMarketDataEvents(events).size(), 2);
+}
+
+TEST(TestDepthFeedHandlerSyncsAndResyncs) {
+    std::vector<std::uint64_t> snapshotSequences{3, 10};
+    std::size_t fetches = 0;
+    Orderbook orderbook;
+    DepthFeedHandler handler(
+        [&]() -> std::optional<BookSnapshotMessage> {
+            BookSnapshotMessage snapshot;
+            snapshot.sequenceNumber = snapshotSequences[fetches++];
+            snapshot.bids = {{100, 10, 1}};
+            return snapshot;
+        },
+        [&](MarketDataMessage message) { return orderbook.ProcessMarketData(message); });
+
+    // Deltas buffered before the snapshot; the one it already covers is skipped
+    handler.OnDepthUpdate(MakeDepthUpdate(1, 3, {{100, 1, 1}}));
+    ASSERT_FALSE(handler.IsLive());
+    handler.OnDepthUpdate(MakeDepthUpdate(4, 5, {{99, 5, 1}}));
+    ASSERT_TRUE(handler.IsLive());
+    ASSERT_EQ(fetches, 1);
+    ASSERT_EQ(orderbook.GetLastSequenceNumber(), 5);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetBids()[0].quantity_, 10);
+
+    handler.OnDepthUpdate(MakeDepthUpdate(6, 6, {{100, 8, 1}}));
+    handler.OnDepthUpdate(MakeDepthUpdate(9, 11, {{98, 2, 1}})); // gap: 7..8 missing
+    ASSERT_EQ(orderbook.GetMarketDataStats().sequenceGaps, 1);
+    ASSERT_TRUE(handler.IsLive()); // second snapshot (10) lines up with the buffered 9..11
+    ASSERT_EQ(fetches, 2);
+    ASSERT_EQ(handler.GetStats().gaps, 1);
+    ASSERT_EQ(handler.GetStats().resyncs, 1);
+    ASSERT_EQ(orderbook.GetLastSequenceNumber(), 11);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetBids().size(), 2);
+}
+
+TEST(TestDepthFeedHandlerResyncsOnGapInBuffer) {
+    // The first fetches fail, so deltas pile up, including a break between 6 and 9
+    std::vector<std::optional<std::uint64_t> > snapshotSequences{std::nullopt, std::nullopt, 3, 10};
+    std::size_t fetches = 0;
+    Orderbook orderbook;
+    DepthFeedHandler handler(
+        [&]() -> std::optional<BookSnapshotMessage> {
+            const std::optional<std::uint64_t> sequence = snapshotSequences[fetches++];
+            if (!sequence) return std::nullopt;
+            BookSnapshotMessage snapshot;
+            snapshot.sequenceNumber = *sequence;
+            snapshot.bids = {{100, 10, 1}};
+            return snapshot;
+        },
+        [&](MarketDataMessage message) { return orderbook.ProcessMarketData(message); });
+
+    handler.OnDepthUpdate(MakeDepthUpdate(4, 5, {{99, 5, 1}}));
+    handler.OnDepthUpdate(MakeDepthUpdate(6, 6, {{100, 8, 1}}));
+    handler.OnDepthUpdate(MakeDepthUpdate(9, 10, {{98, 2, 1}}));
+    ASSERT_FALSE(handler.IsLive()); // snapshot 3 went out with 4..6, then the drain hit the gap
+    ASSERT_EQ(fetches, 3);
+    ASSERT_EQ(handler.GetBufferedCount(), 1);
+
+    // The newer snapshot covers 9..10; the book is live again from 11 on
+    handler.OnDepthUpdate(MakeDepthUpdate(11, 11, {{97, 1, 1}}));
+    ASSERT_TRUE(handler.IsLive());
+    ASSERT_EQ(handler.GetStats().gaps, 1);
+    ASSERT_EQ(handler.GetStats().resyncs, 1);
+    ASSERT_EQ(orderbook.GetMarketDataStats().sequenceGaps, 0); // the gap never reached the book
+    ASSERT_TRUE(orderbook.IsInitialized());
+    ASSERT_EQ(orderbook.GetLastSequenceNumber(), 11);
+}
+
+TEST(TestParseFixedPoint) {
+    std::uint64_t value = 0;
+    ASSERT_TRUE(ParseFixedPoint("187.25000000", 2, UINT32_MAX, value));
+    ASSERT_EQ(value, 18725);
+    ASSERT_TRUE(ParseFixedPoint("0.29", 2, UINT32_MAX, value)); // 0.29 * 100 as a double truncates to 28
+    ASSERT_EQ(value, 29);
+    ASSERT_TRUE(ParseFixedPoint("0.285", 2, UINT32_MAX, value));
+    ASSERT_EQ(value, 29);
+    ASSERT_TRUE(ParseFixedPoint("12", 3, UINT32_MAX, value));
+    ASSERT_EQ(value, 12000);
+    ASSERT_TRUE(ParseFixedPoint(".5", 1, UINT32_MAX, value));
+    ASSERT_EQ(value, 5);
+    ASSERT_FALSE(ParseFixedPoint("", 2, UINT32_MAX, value));
+    ASSERT_FALSE(ParseFixedPoint("-1.00", 2, UINT32_MAX, value));
+    ASSERT_FALSE(ParseFixedPoint("1.0x", 2, UINT32_MAX, value));
+    ASSERT_FALSE(ParseFixedPoint("30000000.00", 2, INT32_MAX, value));
+}
+
+TEST(TestDepthParserPayloads) {
+    DepthParser parser;
+    BookSnapshotMessage snapshot = parser.ParseSnapshot(
+        R"({"lastUpdateId":1027024,"bids":[["4.00000000","431.00000000"],["3.99","0.5"]],)"
+        R"( "asks":[["4.00000200","12.00000000"]]})");
+    ASSERT_EQ(snapshot.sequenceNumber, 1027024);
+    ASSERT_EQ(snapshot.bids.size(), 2);
+    ASSERT_EQ(snapshot.bids[0].price, 400);
+    ASSERT_EQ(snapshot.bids[0].quantity, 43100);
+    ASSERT_EQ(snapshot.bids[1].quantity, 50);
+    ASSERT_EQ(snapshot.asks.size(), 1);
+    ASSERT_EQ(snapshot.asks[0].price, 400);
+
+    ExchangeRules rules;
+    rules.priceDecimals = 4;
+    DepthUpdateMessage update = DepthParser(rules).ParseDepthUpdate(
+        R"({"e":"depthUpdate","E":123456789,"s":"BNBBTC","U":157,"u":160,)"
+        R"("b":[["0.0024","10"]],"a":[["0.0026","100"],["0.0027","0.00"]],"x":{"nested":["]"]}})");
+    ASSERT_EQ(update.firstSequence, 157);
+    ASSERT_EQ(update.lastSequence, 160);
+    ASSERT_EQ(update.bids.size(), 1);
+    ASSERT_EQ(update.bids[0].price, 24);
+    ASSERT_EQ(update.bids[0].quantity, 1000);
+    ASSERT_EQ(update.asks.size(), 2);
+    ASSERT_EQ(update.asks[1].quantity, 0);
+
+    bool threw = false;
+    try {
+        parser.ParseSnapshot(R"({"lastUpdateId":1,"bids":[["abc","1"]]})");
+    } catch (const std::invalid_argument &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+}
+
+template<typename Index>
+void CheckOrderIndexAgainstMap(Index &index, std::uint64_t seed, OrderId idBase) {
+    std::mt19937_64 gen(seed);
+    std::unordered_map<OrderId, OrderHandle> expected;
+    std::vector<OrderId> live;
+    OrderId nextId = idBase;
+    for (int step = 0; step < 20000; ++step) {
+        if (live.empty() || gen() % 10 < 4) {
+            const OrderId orderId = (gen() % 50 == 0) ? (0x8000000000000000ULL | gen()) : nextId++;
+            const auto handle = static_cast<OrderHandle>(step);
+            index.Insert(orderId, handle);
+            expected[orderId] = handle;
+            live.push_back(orderId);
+        } else {
+            const std::size_t pick = gen() % live.size();
+            const OrderId orderId = live[pick];
+            live[pick] = live.back();
+            live.pop_back();
+            ASSERT_EQ(index.Extract(orderId), expected[orderId]);
+            expected.erase(orderId);
+            ASSERT_EQ(index.Extract(orderId), OrderPool::InvalidHandle);
+        }
+    }
+    ASSERT_EQ(index.Size(), expected.size());
+    for (const auto &[orderId, handle]: expected) ASSERT_EQ(index.Find(orderId), handle);
+    ASSERT_FALSE(index.Contains(nextId));
+    std::size_t visited = 0;
+    index.ForEach([&](OrderId orderId, OrderHandle handle) {
+        ASSERT_EQ(expected.at(orderId), handle);
+        ++visited;
+    });
+    ASSERT_EQ(visited, expected.size());
+}
+
+TEST(TestOrderIndexPolicies) {
+    StdOrderIndex stdIndex;
+    FlatOrderIndex flatIndex;
+    DenseOrderIndex denseIndex;
+    CheckOrderIndexAgainstMap(stdIndex, 1, 1);
+    CheckOrderIndexAgainstMap(flatIndex, 2, 1);
+    CheckOrderIndexAgainstMap(denseIndex, 3, 1000);
+
+    // BytesToHold predicts a fresh, reserved table
+    FlatOrderIndex sized;
+    sized.Reserve(1000);
+    for (OrderId id = 0; id < 1000; ++id) sized.Insert(id * 7919, static_cast<OrderHandle>(id));
+    ASSERT_EQ(sized.AllocatedBytes(), FlatOrderIndex::BytesToHold(1000));
+
+    // Ids that outrun the window slide it; orders left behind stay reachable
+    DenseOrderIndex sliding;
+    sliding.Insert(10, 1);
+    sliding.Insert(10 + DenseOrderIndex::MaxWindow + 5, 2);
+    sliding.Insert(5, 3); // below the window
+    ASSERT_EQ(sliding.Find(10), 1);
+    ASSERT_EQ(sliding.Find(10 + DenseOrderIndex::MaxWindow + 5), 2);
+    ASSERT_EQ(sliding.Find(5), 3);
+    ASSERT_EQ(sliding.Size(), 3);
+
+    BasicOrderbook<MapBookSide, FullInstrumentation<>, DenseOrderIndex> orderbook;
+    orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 1, Side::Buy, 100, 10));
+    orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Buy, 100, 10));
+    ASSERT_EQ(orderbook.AddOrder(std::make_shared<Order>(OrderType::GoodTillCancel, 2, Side::Buy, 99, 1)).size(), 0);
+    orderbook.CancelOrder(1);
+    orderbook.MatchOrder(OrderModify(2, Side::Sell, 100, 4));
+    ASSERT_EQ(orderbook.Size(), 1);
+    ASSERT_EQ(orderbook.GetOrderInfos().GetAsks()[0].quantity_, 4);
+}
+
 // ==================== PERFORMANCE TESTS ====================
 
 void PrintPerformanceHeader() {
@@ -306,8 +1921,7 @@ void PrintPerformanceHeader() {
 // Benchmark: Add orders with random prices and quantities
 void BenchmarkAddOrders(int numOrders) {
     Orderbook orderbook;
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen(1);
     std::uniform_int_distribution<Price> priceDist(90, 110);
     std::uniform_int_distribution<Quantity> qtyDist(1, 100);
     std::uniform_int_distribution<int> sideDist(0, 1);
@@ -343,8 +1957,7 @@ void BenchmarkAddOrders(int numOrders) {
 // Benchmark: Order matching performance
 void BenchmarkMatching(int numOrders) {
     Orderbook orderbook;
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen(2);
     std::uniform_int_distribution<Quantity> qtyDist(1, 100);
 
     // Fill one side of the book with buy orders
@@ -417,8 +2030,7 @@ void BenchmarkCancelOrders(int numOrders) {
 // Benchmark: Order modification performance (cancel + re-add)
 void BenchmarkModifyOrders(int numOrders) {
     Orderbook orderbook;
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen(3);
     std::uniform_int_distribution<Price> priceDist(95, 105);
     std::uniform_int_distribution<Quantity> qtyDist(1, 100);
 
@@ -450,7 +2062,305 @@ void BenchmarkModifyOrders(int numOrders) {
             << duration.count() / 1000.0 << " ms\n";
     std::cout << "  Throughput: " << formatNumber(modifiesPerSec) << " modifies/sec\n";
     std::cout << "  Latency: " << std::fixed << std::setprecision(3)
-            << (double) duration.count() / numOrders << " μs/modify\n\n";
+            << (double) duration.count() / numOrders << " μs/modify\n";
+
+    // Same-price size reductions take the in-place amend path
+    Orderbook amendBook;
+    for (auto orderId: orderIds) amendBook.AddOrder(Order{OrderType::GoodTillCancel, orderId, Side::Buy, 100, 1000});
+    start = std::chrono::high_resolution_clock::now();
+    for (int round = 1; round <= 10; ++round) {
+        for (auto orderId: orderIds) amendBook.MatchOrder(OrderModify(orderId, Side::Buy, 100, 1000 - round * 10));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double amendNanos = std::chrono::duration<double, std::nano>(end - start).count() / (numOrders * 10.0);
+    std::cout << "  Amend down in place: " << std::fixed << std::setprecision(1) << amendNanos << " ns/amend\n\n";
+}
+
+// Benchmark: session-close expiry of a few GoodForDay orders among many GoodTillCancel
+void BenchmarkGoodForDayExpiry(int restingOrders, int goodForDayOrders) {
+    BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+    for (int i = 0; i < restingOrders; ++i) {
+        const OrderType type = (i % (restingOrders / goodForDayOrders) == 0) ? OrderType::GoodForDay
+                                                                             : OrderType::GoodTillCancel;
+        orderbook.AddOrder(Order{type, static_cast<OrderId>(i), Side::Buy, 9000 + i % 500, 10});
+    }
+    const std::int64_t day = 86'400'000'000'000LL;
+    orderbook.AdvanceTime(0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::size_t expired = orderbook.AdvanceTime(day);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "GoodForDay expiry (" << formatNumber(expired) << " of " << formatNumber(restingOrders)
+            << " resting orders): " << std::fixed << std::setprecision(1)
+            << std::chrono::duration<double, std::micro>(end - start).count() << " μs\n\n";
+}
+
+// Benchmark: one aggressive order sweeping a deep book, per resting order touched
+void BenchmarkDeepSweep(int levels, int ordersPerLevel) {
+    BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+    OrderId orderId = 1;
+    for (int i = 0; i < ordersPerLevel; ++i) {
+        for (int level = 0; level < levels; ++level) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Sell, 10000 + level, 1});
+        }
+    }
+    const int resting = levels * ordersPerLevel;
+
+    std::size_t trades = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    orderbook.AddOrder(Order{orderId++, Side::Buy, static_cast<Quantity>(resting)},
+                       [&trades](const Trade &) { ++trades; });
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Sweep " << formatNumber(resting) << " resting orders over " << formatNumber(levels)
+            << " levels: " << std::fixed << std::setprecision(1)
+            << std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(trades)
+            << " ns/fill\n\n";
+}
+
+// Benchmark: aggressive IOC orders through the generic and the typed entry point
+void BenchmarkImmediateOrCancel(int numOrders) {
+    auto run = [numOrders](auto &&addOrder) {
+        BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+        for (int level = 0; level < 10; ++level) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(level + 1), Side::Sell,
+                                     10000 + level, 1'000'000});
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(level + 101), Side::Buy,
+                                     9000 - level, 10});
+        }
+        std::size_t trades = 0;
+        auto countTrades = [&trades](const Trade &) { ++trades; };
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < numOrders; ++i) {
+            addOrder(orderbook, Order{OrderType::ImmediateOrCancel, static_cast<OrderId>(1000 + i), Side::Buy,
+                                      10005, 1}, countTrades);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / numOrders;
+    };
+
+    const double generic = run([](auto &book, Order order, auto &sink) { book.AddOrder(order, sink); });
+    const double typed = run([](auto &book, Order order, auto &sink) {
+        book.template AddOrder<OrderType::ImmediateOrCancel>(order, sink);
+    });
+    std::cout << formatNumber(numOrders) << " IOC orders: AddOrder " << std::fixed << std::setprecision(1)
+            << generic << " ns, AddOrder<ImmediateOrCancel> " << typed << " ns\n\n";
+}
+
+// Benchmark: FillOrKill against a deep book, rejected and executed
+void BenchmarkFillOrKill(int levels, int ordersPerLevel, int numOrders) {
+    BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+    OrderId orderId = 1;
+    for (int level = 0; level < levels; ++level) {
+        for (int i = 0; i < ordersPerLevel; ++i) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId++, Side::Sell, 10000 + level, 10});
+        }
+    }
+    const Quantity depth = static_cast<Quantity>(levels * ordersPerLevel * 10);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numOrders; ++i) {
+        orderbook.AddOrder(Order{OrderType::FillOrKill, orderId++, Side::Buy, 10000 + levels, depth + 1});
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const double rejectNs = std::chrono::duration<double, std::nano>(end - start).count() / numOrders;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numOrders && orderbook.Size() > 0; ++i) {
+        orderbook.AddOrder(Order{OrderType::FillOrKill, orderId++, Side::Buy, 10000 + levels, 10});
+    }
+    end = std::chrono::high_resolution_clock::now();
+    const double fillNs = std::chrono::duration<double, std::nano>(end - start).count() / numOrders;
+
+    std::cout << "FillOrKill over " << formatNumber(levels) << " levels x " << formatNumber(ordersPerLevel)
+            << " orders: rejected " << std::fixed << std::setprecision(1) << rejectNs
+            << " ns, filled " << fillNs << " ns\n\n";
+}
+
+// Benchmark: building a deep book through BulkLoad versus one AddOrder per order
+void BenchmarkBulkLoad(int numOrders) {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<Price> offsetDist(0, 999);
+    std::vector<OrderSpec> specs;
+    specs.reserve(numOrders);
+    for (int i = 0; i < numOrders; ++i) {
+        const Side side = (i % 2 == 0) ? Side::Buy : Side::Sell;
+        const Price price = (side == Side::Buy) ? 9000 - offsetDist(gen) : 11000 + offsetDist(gen);
+        specs.push_back(OrderSpec{OrderType::GoodTillCancel, static_cast<OrderId>(i + 1), side, price, 10});
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+        for (const OrderSpec &spec: specs) orderbook.AddOrder(spec.ToOrder());
+    }
+    auto added = std::chrono::high_resolution_clock::now();
+    std::size_t loaded = 0;
+    {
+        BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+        loaded = orderbook.BulkLoad(specs);
+    }
+    auto bulk = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Build " << formatNumber(loaded) << " orders: AddOrder loop " << std::fixed
+            << std::setprecision(1) << std::chrono::duration<double, std::milli>(added - start).count()
+            << " ms, BulkLoad " << std::chrono::duration<double, std::milli>(bulk - added).count() << " ms\n\n";
+}
+
+// Benchmark: checkpoint a deep book and restore it into a fresh one
+void BenchmarkCheckpoint(int numOrders) {
+    BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+    for (int i = 0; i < numOrders; ++i) {
+        const Side side = (i % 2 == 0) ? Side::Buy : Side::Sell;
+        const Price price = (side == Side::Buy) ? 9000 - i % 1000 : 11000 + i % 1000;
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(i + 1), side, price, 10});
+    }
+
+    std::stringstream image;
+    auto start = std::chrono::high_resolution_clock::now();
+    orderbook.SaveCheckpoint(image);
+    auto saved = std::chrono::high_resolution_clock::now();
+
+    BasicOrderbook<MapBookSide, NoInstrumentation> restored;
+    restored.LoadCheckpoint(image);
+    auto loaded = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Checkpoint " << formatNumber(restored.Size()) << " orders ("
+            << formatNumber(image.str().size() / 1024) << " KiB): save " << std::fixed << std::setprecision(1)
+            << std::chrono::duration<double, std::milli>(saved - start).count() << " ms, load "
+            << std::chrono::duration<double, std::milli>(loaded - saved).count() << " ms\n\n";
+}
+
+// Benchmark: depth analytics over a deep side, scalar versus the build's kernels
+void BenchmarkDepthKernels(int levels, int iterations) {
+    std::vector<Price> prices(levels);
+    std::vector<Quantity> quantities(levels);
+    for (int i = 0; i < levels; ++i) {
+        prices[i] = 10000 + i;
+        quantities[i] = static_cast<Quantity>(100 + i % 50);
+    }
+    const std::uint64_t size = CumulativeDepthScalar(quantities, levels) * 9 / 10;
+
+    auto time = [&](auto &&kernel) {
+        std::uint64_t checksum = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; ++i) checksum += kernel();
+        auto end = std::chrono::high_resolution_clock::now();
+        if (checksum == 42) std::cout << ""; // keep the loop
+        return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    };
+
+    const double scalarDepth = time([&] { return CumulativeDepthScalar(quantities, levels); });
+    const double depth = time([&] { return CumulativeDepth(quantities, levels); });
+    const double scalarSweep = time([&] {
+        const std::size_t last = FirstLevelReachingScalar(quantities, size);
+        return static_cast<std::uint64_t>(NotionalScalar(prices, quantities, last));
+    });
+    const double sweep = time([&] { return static_cast<std::uint64_t>(CostToSweep(prices, quantities, size).notional); });
+
+#if defined(__AVX2__)
+    const char *kernels = "AVX2";
+#else
+    const char *kernels = "scalar";
+#endif
+    std::cout << "Depth kernels (" << kernels << ", " << formatNumber(levels) << " levels): cumulative depth "
+            << std::fixed << std::setprecision(1) << scalarDepth << " -> " << depth << " ns, cost to sweep "
+            << scalarSweep << " -> " << sweep << " ns\n\n";
+}
+
+void BenchmarkTopOfBookPublication(int numUpdates) {
+    // Add/cancel churn on the best bid, so every update moves the top of book, and
+    // below the tenth bid, where no update needs publishing
+    auto run = [numUpdates](TopOfBookPublisher *publisher, Price churnPrice = 10000) {
+        Orderbook orderbook;
+        for (int i = 0; i < 10; ++i) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(i + 1), Side::Buy,
+                                     static_cast<Price>(9990 + i), 100});
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(i + 11), Side::Sell,
+                                     static_cast<Price>(10010 + i), 100});
+        }
+        orderbook.SetTopOfBookPublisher(publisher);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < numUpdates; ++i) {
+            const OrderId id = 1000 + static_cast<OrderId>(i);
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, id, Side::Buy, churnPrice, 100});
+            orderbook.CancelOrder(id);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / (2.0 * numUpdates);
+    };
+
+    const double detached = run(nullptr);
+    TopOfBookPublisher idlePublisher;
+    const double attached = run(&idlePublisher);
+    TopOfBookPublisher deepPublisher;
+    const double deep = run(&deepPublisher, 9900);
+    TopOfBookPublisher publisher;
+    std::atomic<bool> done{false};
+    std::uint64_t reads = 0;
+    std::thread reader([&] {
+        TopOfBook snapshot;
+        while (!done.load(std::memory_order_relaxed)) {
+            if (publisher.TryRead(snapshot)) ++reads;
+        }
+    });
+    const double published = run(&publisher);
+    done.store(true, std::memory_order_relaxed);
+    reader.join();
+
+    std::cout << "Top-of-book publication (" << formatNumber(2 * numUpdates) << " updates): " << std::fixed
+            << std::setprecision(1) << detached << " ns/update detached, " << attached
+            << " attached, " << published
+            << " ns/update with a polling reader (" << formatNumber(static_cast<long long>(reads / 1000)) << "k reads), "
+            << deep << " attached below the published depth\n\n";
+}
+
+void BenchmarkLevelDeltas(int levelsPerSide, int numUpdates) {
+    // A consumer that needs every change: a full view copied after each update versus
+    // the deltas the book emits as it goes
+    auto fill = [levelsPerSide](Orderbook &orderbook) {
+        for (int i = 0; i < levelsPerSide; ++i) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(2 * i + 1), Side::Buy,
+                                     static_cast<Price>(10000 - i), 100});
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(2 * i + 2), Side::Sell,
+                                     static_cast<Price>(10001 + i), 100});
+        }
+    };
+    auto churn = [levelsPerSide, numUpdates](Orderbook &orderbook, auto &&afterUpdate) {
+        std::mt19937 gen(7);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < numUpdates; ++i) {
+            const OrderId id = 1'000'000 + static_cast<OrderId>(i);
+            const Price offset = static_cast<Price>(gen() % levelsPerSide);
+            if (i % 2 == 0) orderbook.AddOrder(Order{OrderType::GoodTillCancel, id, Side::Buy, 10000 - offset, 10});
+            else            orderbook.CancelOrder(id - 1);
+            afterUpdate();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / numUpdates;
+    };
+
+    Orderbook fullBook;
+    fill(fullBook);
+    std::size_t fullLevels = 0;
+    const double fullTime = churn(fullBook, [&] {
+        const auto infos = fullBook.GetOrderInfos();
+        fullLevels += infos.GetBids().size() + infos.GetAsks().size();
+    });
+
+    Orderbook deltaBook;
+    fill(deltaBook);
+    std::size_t deltaLevels = 0;
+    deltaBook.SetLevelDeltaSink([&deltaLevels](std::span<const LevelDelta> deltas) { deltaLevels += deltas.size(); });
+    deltaLevels = 0; // drop the initial full report
+    const double deltaTime = churn(deltaBook, [] {});
+
+    std::cout << "L2 output (" << formatNumber(levelsPerSide) << " levels per side, " << formatNumber(numUpdates)
+            << " updates): full view " << std::fixed << std::setprecision(1) << fullTime << " ns and "
+            << static_cast<double>(fullLevels) / numUpdates << " levels per update, deltas " << deltaTime
+            << " ns and " << std::setprecision(2) << static_cast<double>(deltaLevels) / numUpdates
+            << " levels per update\n\n";
 }
 
 // Benchmark: Market data snapshot generation
@@ -477,13 +2387,506 @@ void BenchmarkGetOrderInfos(int numOrders, int numCalls) {
     double seconds = duration.count() / 1000000.0;
     long long callsPerSec = static_cast<long long>(numCalls / seconds);
 
+    // Same book, top 10 levels per side into reused buffers
+    LevelInfos bidLevels(10), askLevels(10);
+    start = std::chrono::high_resolution_clock::now();
+    std::size_t levelsCopied = 0;
+    for (int i = 0; i < numCalls; ++i) {
+        levelsCopied += orderbook.GetTopLevels(Side::Buy, bidLevels);
+        levelsCopied += orderbook.GetTopLevels(Side::Sell, askLevels);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    auto topDuration = std::chrono::duration<double, std::micro>(end - start).count();
+
     std::cout << "GetOrderInfos (" << formatNumber(numOrders) << " orders, "
             << formatNumber(numCalls) << " calls):\n";
     std::cout << "  Time: " << std::fixed << std::setprecision(2)
             << duration.count() / 1000.0 << " ms\n";
     std::cout << "  Throughput: " << formatNumber(callsPerSec) << " snapshots/sec\n";
     std::cout << "  Latency: " << std::fixed << std::setprecision(3)
-            << (double) duration.count() / numCalls << " μs/snapshot\n\n";
+            << (double) duration.count() / numCalls << " μs/snapshot\n";
+    std::cout << "  GetTopLevels(10) latency: " << std::fixed << std::setprecision(3)
+            << topDuration / numCalls << " μs/snapshot (" << levelsCopied / numCalls
+            << " levels)\n\n";
+}
+
+// Benchmark: applying successive full-depth snapshots that differ in a few levels,
+// against snapshots whose every level moves (the cost of a rebuild)
+void BenchmarkSnapshotApply(int levelsPerSide, int numSnapshots, int changedLevels) {
+    std::mt19937 gen(21);
+    std::uniform_int_distribution<int> levelDist(0, levelsPerSide - 1);
+    std::uniform_int_distribution<Quantity> qtyDist(1, 1000);
+
+    auto makeSnapshot = [&](Price bidTop, std::uint64_t sequence) {
+        BookSnapshotMessage snapshot;
+        snapshot.sequenceNumber = sequence;
+        for (int i = 0; i < levelsPerSide; ++i) {
+            snapshot.bids.push_back({bidTop - i, qtyDist(gen), 1});
+            snapshot.asks.push_back({bidTop + 1 + i, qtyDist(gen), 1});
+        }
+        return snapshot;
+    };
+
+    std::vector<MarketDataMessage> sparse, shifted;
+    BookSnapshotMessage current = makeSnapshot(10000, 0);
+    for (int i = 0; i < numSnapshots; ++i) {
+        current.sequenceNumber = i + 1;
+        for (int c = 0; c < changedLevels; ++c) {
+            auto &levels = (c % 2 == 0) ? current.bids : current.asks;
+            levels[levelDist(gen)].quantity = qtyDist(gen);
+        }
+        sparse.push_back(current);
+        shifted.push_back(makeSnapshot(10000 + (i % 2) * levelsPerSide * 2, i + 1));
+    }
+
+    auto run = [](const std::vector<MarketDataMessage> &snapshots) {
+        BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+        orderbook.ProcessMarketData(snapshots.front());
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto &snapshot: snapshots) orderbook.ProcessMarketData(snapshot);
+        auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::micro>(end - start).count() / snapshots.size();
+    };
+
+    double sparseMicros = run(sparse);
+    double shiftedMicros = run(shifted);
+
+    std::cout << "Snapshot apply (" << formatNumber(levelsPerSide) << " levels per side, "
+            << formatNumber(numSnapshots) << " snapshots):\n";
+    std::cout << "  " << changedLevels << " levels changed: " << std::fixed << std::setprecision(3)
+            << sparseMicros << " μs/snapshot\n";
+    std::cout << "  every level moved: " << std::fixed << std::setprecision(3)
+            << shiftedMicros << " μs/snapshot\n\n";
+}
+
+// Benchmark: parsing a full-depth REST snapshot payload, in place versus the
+// std::stod-per-field conversion it replaces (string copies plus double rounding)
+void BenchmarkDepthParsing(int levelsPerSide, int numPayloads) {
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<int> qtyDist(1, 99999999);
+
+    std::string payload = R"({"lastUpdateId":987654321,"bids":[)";
+    auto appendLevels = [&](int sign) {
+        for (int i = 0; i < levelsPerSide; ++i) {
+            const int cents = 18725 + sign * (i + (sign > 0 ? 1 : 0));
+            std::ostringstream level;
+            level << (i ? "," : "") << "[\"" << cents / 100 << '.' << std::setw(2) << std::setfill('0')
+                    << cents % 100 << "000000\",\"" << qtyDist(gen) / 100000000 << '.'
+                    << std::setw(8) << std::setfill('0') << qtyDist(gen) << "\"]";
+            payload += level.str();
+        }
+    };
+    appendLevels(-1);
+    payload += R"(],"asks":[)";
+    appendLevels(1);
+    payload += "]}";
+
+    DepthParser parser;
+    BookSnapshotMessage snapshot;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::size_t levels = 0;
+    for (int i = 0; i < numPayloads; ++i) {
+        parser.ParseSnapshot(payload, snapshot);
+        levels += snapshot.bids.size() + snapshot.asks.size();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double inPlaceMicros = std::chrono::duration<double, std::micro>(end - start).count() / numPayloads;
+
+    // Baseline: same fields, each copied into a std::string and converted via double
+    start = std::chrono::high_resolution_clock::now();
+    std::size_t misRounded = 0;
+    for (int i = 0; i < numPayloads; ++i) {
+        std::size_t index = 0;
+        for (std::size_t pos = payload.find("[\""); pos != std::string::npos; pos = payload.find("[\"", pos)) {
+            const std::size_t priceEnd = payload.find('"', pos + 2);
+            const std::size_t qtyStart = priceEnd + 3;
+            const std::size_t qtyEnd = payload.find('"', qtyStart);
+            const auto price = static_cast<Price>(std::stod(payload.substr(pos + 2, priceEnd - pos - 2)) * 100);
+            const auto quantity = static_cast<Quantity>(std::stod(payload.substr(qtyStart, qtyEnd - qtyStart)) * 100);
+            const auto &expected = index < snapshot.bids.size()
+                                       ? snapshot.bids[index]
+                                       : snapshot.asks[index - snapshot.bids.size()];
+            if (i == 0 && (price != expected.price || quantity != expected.quantity)) ++misRounded;
+            ++index;
+            pos = qtyEnd;
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double stodMicros = std::chrono::duration<double, std::micro>(end - start).count() / numPayloads;
+
+    std::cout << "Depth snapshot parsing (" << formatNumber(levelsPerSide) << " levels per side, "
+            << formatNumber(static_cast<long long>(payload.size())) << " bytes):\n";
+    std::cout << "  In place: " << std::fixed << std::setprecision(1) << inPlaceMicros << " μs/payload ("
+            << std::setprecision(0) << payload.size() / inPlaceMicros << " MB/s, "
+            << formatNumber(static_cast<long long>(levels / numPayloads)) << " levels)\n";
+    std::cout << "  std::stod per field: " << std::setprecision(1) << stodMicros << " μs/payload, "
+            << misRounded << " fields off from exact rounding\n\n";
+}
+
+// Benchmark: a cancel-heavy stream (70% cancels of random resting orders, ids
+// assigned sequentially) through each order index policy
+template<typename Index>
+double CancelHeavyNanosPerOperation(int numOperations, int restingOrders) {
+    BasicOrderbook<MapBookSide, NoInstrumentation, Index> orderbook;
+    std::mt19937 gen(29);
+    std::uniform_int_distribution<int> priceDist(0, 199);
+    std::uniform_int_distribution<int> actionDist(0, 99);
+    std::vector<OrderId> live;
+    live.reserve(restingOrders * 2);
+    OrderId nextId = 1;
+    auto add = [&] {
+        const Side side = (nextId % 2 == 0) ? Side::Buy : Side::Sell;
+        const Price price = (side == Side::Buy) ? 9800 + priceDist(gen) : 10001 + priceDist(gen);
+        orderbook.AddOrder(Order(OrderType::GoodTillCancel, nextId, side, price, 10));
+        live.push_back(nextId++);
+    };
+    for (int i = 0; i < restingOrders; ++i) add();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numOperations; ++i) {
+        if (actionDist(gen) < 70 && !live.empty()) {
+            const std::size_t pick = gen() % live.size();
+            orderbook.CancelOrder(live[pick]);
+            live[pick] = live.back();
+            live.pop_back();
+        } else {
+            add();
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / numOperations;
+}
+
+void BenchmarkOrderIndex(int numOperations, int restingOrders) {
+    double stdNanos = CancelHeavyNanosPerOperation<StdOrderIndex>(numOperations, restingOrders);
+    double flatNanos = CancelHeavyNanosPerOperation<FlatOrderIndex>(numOperations, restingOrders);
+    double denseNanos = CancelHeavyNanosPerOperation<DenseOrderIndex>(numOperations, restingOrders);
+
+    std::cout << "Cancel-heavy stream (" << formatNumber(numOperations) << " operations, "
+            << formatNumber(restingOrders) << " resting):\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  StdOrderIndex:   " << stdNanos << " ns/op\n";
+    std::cout << "  FlatOrderIndex:  " << flatNanos << " ns/op\n";
+    std::cout << "  DenseOrderIndex: " << denseNanos << " ns/op\n\n";
+}
+
+// Benchmark: heap allocations per add/cancel pair, shared_ptr API versus pooled API.
+// One order is kept resting on every level so level creation is not measured.
+void BenchmarkAllocationsPerOperation(int numOperations) {
+    auto measure = [numOperations](bool useOrderPointer) {
+        Orderbook orderbook;
+        for (int level = 0; level < 10; ++level) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, (OrderId) level, Side::Buy,
+                                     90 + level, 10});
+        }
+
+        OrderId nextOrderId = 10;
+        auto runCycle = [&](int count) {
+            for (int i = 0; i < count; ++i) {
+                OrderId orderId = nextOrderId++;
+                Price price = 90 + (i % 10);
+                if (useOrderPointer) {
+                    orderbook.AddOrder(std::make_shared<Order>(
+                        OrderType::GoodTillCancel, orderId, Side::Buy, price, 10));
+                } else {
+                    orderbook.AddOrder(Order{OrderType::GoodTillCancel, orderId, Side::Buy, price, 10});
+                }
+                orderbook.CancelOrder(orderId);
+            }
+        };
+
+        runCycle(numOperations); // warm up pool and level vectors
+        std::size_t before = allocationCount;
+        runCycle(numOperations);
+        return (double) (allocationCount - before) / numOperations;
+    };
+
+    double sharedAllocs = measure(true);
+    double pooledAllocs = measure(false);
+
+    std::cout << "Add + cancel " << formatNumber(numOperations) << " orders:\n";
+    std::cout << "  OrderPointer API: " << std::fixed << std::setprecision(2)
+            << sharedAllocs << " allocations/op\n";
+    std::cout << "  Pooled API:       " << std::fixed << std::setprecision(2)
+            << pooledAllocs << " allocations/op\n\n";
+}
+
+// Benchmark: a peak of resting orders thinned to one in keepEvery, then compacted in
+// fixed slices the way a matching thread would between messages.
+void BenchmarkCompaction(int peakOrders, int keepEvery, std::chrono::microseconds slice) {
+    Orderbook orderbook;
+    for (int i = 0; i < peakOrders; ++i) {
+        const Side side = (i % 2) ? Side::Buy : Side::Sell;
+        const Price price = (side == Side::Buy) ? static_cast<Price>(9999 - i % 500) : static_cast<Price>(10001 + i % 500);
+        orderbook.AddOrder(Order{OrderType::GoodTillCancel, static_cast<OrderId>(i + 1), side, price, 10});
+    }
+    for (int i = 0; i < peakOrders; ++i) {
+        if (i % keepEvery != 0 && i % keepEvery != 1) orderbook.CancelOrder(static_cast<OrderId>(i + 1));
+    }
+    const MemoryUsage before = orderbook.GetMemoryUsage();
+
+    int slices = 0;
+    double longest = 0.0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (bool done = false; !done; ++slices) {
+        auto sliceStart = std::chrono::high_resolution_clock::now();
+        done = orderbook.Compact(slice);
+        longest = std::max(longest, std::chrono::duration<double, std::micro>(
+                               std::chrono::high_resolution_clock::now() - sliceStart).count());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const MemoryUsage after = orderbook.GetMemoryUsage();
+
+    auto megabytes = [](std::size_t bytes) { return bytes / (1024.0 * 1024.0); };
+    std::cout << "Compact " << formatNumber(orderbook.Size()) << " orders left from a peak of "
+            << formatNumber(peakOrders) << " (" << slice.count() << " us slices):\n";
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Before: " << megabytes(before.Total()) << " MiB (levels " << megabytes(before.levels)
+            << ", index " << megabytes(before.orderIndex) << ", orders " << megabytes(before.orders)
+            << ", pools " << megabytes(before.pools) << ", buffers " << megabytes(before.buffers) << ")\n";
+    std::cout << "  After:  " << megabytes(after.Total()) << " MiB (levels " << megabytes(after.levels)
+            << ", index " << megabytes(after.orderIndex) << ", orders " << megabytes(after.orders)
+            << ", pools " << megabytes(after.pools) << ", buffers " << megabytes(after.buffers) << ")\n";
+    std::cout << "  " << slices << " slices, " << std::setprecision(1)
+            << std::chrono::duration<double, std::milli>(end - start).count() << " ms total, longest slice "
+            << longest << " us\n\n";
+}
+
+// Benchmark: aggressive orders that each sweep three resting orders, reporting trades
+// through the returned Trades vector versus a sink that appends to a reused buffer.
+void BenchmarkTradeSink(int numOrders) {
+    auto measure = [numOrders](bool useSink) {
+        Orderbook orderbook;
+        OrderId nextOrderId = 0;
+        for (int i = 0; i < numOrders * 3; ++i) {
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, nextOrderId++, Side::Sell,
+                                     100 + (i / 3) % 50, 10});
+        }
+
+        Trades buffer;
+        buffer.reserve(16);
+        std::size_t tradeCount = 0;
+        std::size_t allocationsBefore = allocationCount;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < numOrders; ++i) {
+            Order order{OrderType::ImmediateOrCancel, nextOrderId++, Side::Buy, 200, 30};
+            if (useSink) {
+                buffer.clear();
+                orderbook.AddOrder(order, [&buffer](const Trade &trade) { buffer.push_back(trade); });
+                tradeCount += buffer.size();
+            } else {
+                tradeCount += orderbook.AddOrder(order).size();
+            }
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        double micros = std::chrono::duration<double, std::micro>(end - start).count();
+        double allocsPerOrder = (double) (allocationCount - allocationsBefore) / numOrders;
+        return std::make_tuple(micros, allocsPerOrder, tradeCount);
+    };
+
+    auto [vectorMicros, vectorAllocs, vectorTrades] = measure(false);
+    auto [sinkMicros, sinkAllocs, sinkTrades] = measure(true);
+    ASSERT_EQ(vectorTrades, sinkTrades);
+
+    std::cout << "Sweep " << formatNumber(numOrders) << " aggressive orders ("
+            << formatNumber(sinkTrades) << " trades):\n";
+    std::cout << "  Returned Trades: " << std::fixed << std::setprecision(3)
+            << vectorMicros / numOrders << " μs/order, " << std::setprecision(2)
+            << vectorAllocs << " allocations/order\n";
+    std::cout << "  Trade sink:      " << std::fixed << std::setprecision(3)
+            << sinkMicros / numOrders << " μs/order, " << std::setprecision(2)
+            << sinkAllocs << " allocations/order\n\n";
+}
+
+// Benchmark: replaying a passive add/cancel stream one message at a time versus in batches.
+// Seeded non-crossing feed: resting adds, and 40% cancels once the book holds 1,000 orders
+std::vector<MarketDataMessage> GenerateAddCancelFeed(int numMessages, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<Price> bidPriceDist(900, 999);
+    std::uniform_int_distribution<Price> askPriceDist(1001, 1100);
+    std::uniform_int_distribution<Quantity> qtyDist(1, 100);
+    auto now = std::chrono::system_clock::now();
+
+    std::vector<MarketDataMessage> messages;
+    messages.reserve(numMessages);
+    std::vector<OrderId> live;
+    OrderId nextOrderId = 0;
+    for (int i = 0; i < numMessages; ++i) {
+        if (live.size() > 1000 && gen() % 10 < 4) {
+            size_t idx = gen() % live.size();
+            messages.push_back(CancelOrderMessage{MessageType::CancelOrder, live[idx], now});
+            live[idx] = live.back();
+            live.pop_back();
+        } else {
+            Side side = (gen() % 2) ? Side::Buy : Side::Sell;
+            Price price = (side == Side::Buy) ? bidPriceDist(gen) : askPriceDist(gen);
+            messages.push_back(NewOrderMessage{MessageType::NewOrder, nextOrderId, side, price,
+                                               qtyDist(gen), OrderType::GoodTillCancel, now});
+            live.push_back(nextOrderId++);
+        }
+    }
+    return messages;
+}
+
+void BenchmarkMarketDataBatch(int numMessages, int batchSize) {
+    const std::vector<MarketDataMessage> messages = GenerateAddCancelFeed(numMessages, 7);
+
+    Orderbook sequentialBook;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto &message: messages) sequentialBook.ProcessMarketData(message);
+    auto end = std::chrono::high_resolution_clock::now();
+    double sequentialMicros = std::chrono::duration<double, std::micro>(end - start).count();
+
+    Orderbook batchBook;
+    start = std::chrono::high_resolution_clock::now();
+    for (std::size_t offset = 0; offset < messages.size(); offset += batchSize) {
+        std::size_t count = std::min<std::size_t>(batchSize, messages.size() - offset);
+        batchBook.ProcessMarketDataBatch(std::span(messages).subspan(offset, count));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double batchMicros = std::chrono::duration<double, std::micro>(end - start).count();
+    ASSERT_EQ(sequentialBook.Size(), batchBook.Size());
+
+    std::cout << "Replay " << formatNumber(numMessages) << " messages:\n";
+    const auto &latency = sequentialBook.GetMarketDataStats().GetLatency(MessageType::NewOrder);
+    std::cout << "  One at a time:     " << std::fixed << std::setprecision(3)
+            << sequentialMicros * 1000.0 / numMessages << " ns/message (new order p50 " << latency.P50()
+            << " ns, p99 " << latency.P99() << " ns, p99.9 " << latency.P999() << " ns, max "
+            << latency.Max() << " ns)\n";
+    std::cout << "  Batches of " << formatNumber(batchSize) << ": " << std::fixed << std::setprecision(3)
+            << batchMicros * 1000.0 / numMessages << " ns/message\n";
+
+    std::vector<MarketDataEvent> events;
+    events.reserve(messages.size());
+    for (const auto &message: messages) events.push_back(*ToMarketDataEvent(message));
+
+    Orderbook eventBook;
+    start = std::chrono::high_resolution_clock::now();
+    for (std::size_t offset = 0; offset < events.size(); offset += batchSize) {
+        std::size_t count = std::min<std::size_t>(batchSize, events.size() - offset);
+        eventBook.ProcessMarketDataBatch(std::span(events).subspan(offset, count));
+    }
+    end = std::chrono::high_resolution_clock::now();
+    double eventMicros = std::chrono::duration<double, std::micro>(end - start).count();
+    ASSERT_EQ(sequentialBook.Size(), eventBook.Size());
+
+    std::cout << "  Compact events:    " << std::fixed << std::setprecision(3)
+            << eventMicros * 1000.0 / numMessages << " ns/message ("
+            << sizeof(MarketDataEvent) << " vs " << sizeof(MarketDataMessage) << " bytes/message)\n\n";
+}
+
+// Benchmark: record a feed to a capture file, then replay it from the memory mapping
+void BenchmarkCaptureReplay(int numMessages) {
+    const auto path = std::filesystem::temp_directory_path() / "orderbook_capture_bench.bin";
+    std::filesystem::remove(path);
+    const std::vector<MarketDataMessage> messages = GenerateAddCancelFeed(numMessages, 17);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        CaptureWriter writer(path, "BENCH", "2024-01-02");
+        for (const auto &message: messages) writer.Write(message);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double writeMillis = std::chrono::duration<double, std::milli>(end - start).count();
+
+    CaptureReader reader(path);
+    BasicOrderbook<MapBookSide, NoInstrumentation> orderbook;
+    ReplayResult result = ReplayCapture(orderbook, reader);
+
+    std::cout << "Capture " << formatNumber(numMessages) << " messages ("
+            << formatNumber(static_cast<long long>(std::filesystem::file_size(path))) << " bytes):\n";
+    std::cout << "  Record: " << std::fixed << std::setprecision(2) << writeMillis << " ms\n";
+    std::cout << "  Replay: " << formatNumber(static_cast<long long>(result.EventsPerSecond()))
+            << " messages/sec\n\n";
+    std::filesystem::remove(path);
+}
+
+// Benchmark: the same feed through each instrumentation policy, one message at a time
+template<typename Book>
+double ReplayNanosPerMessage(const std::vector<MarketDataMessage> &messages, Book &orderbook) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto &message: messages) orderbook.ProcessMarketData(message);
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / messages.size();
+}
+
+void BenchmarkInstrumentationOverhead(int numMessages) {
+    const std::vector<MarketDataMessage> messages = GenerateAddCancelFeed(numMessages, 13);
+
+    BasicOrderbook<MapBookSide, NoInstrumentation> noneBook;
+    BasicOrderbook<MapBookSide, CountingInstrumentation> countingBook;
+    Orderbook defaultBook;
+    BasicOrderbook<MapBookSide, FullInstrumentation<SteadyClock> > steadyBook;
+    BasicOrderbook<MapBookSide, FullInstrumentation<TscClock> > tscBook;
+    TscClock::NanosPerTick(); // calibrate outside the timed region
+
+    double none = ReplayNanosPerMessage(messages, noneBook);
+    double counting = ReplayNanosPerMessage(messages, countingBook);
+    double messageTimers = ReplayNanosPerMessage(messages, defaultBook);
+    double steady = ReplayNanosPerMessage(messages, steadyBook);
+    double tsc = ReplayNanosPerMessage(messages, tscBook);
+    ASSERT_EQ(noneBook.Size(), tscBook.Size());
+
+    auto report = [none](const char *label, double nanos) {
+        std::cout << "  " << std::left << std::setw(22) << label << std::right << std::fixed
+                << std::setprecision(1) << nanos << " ns/message (+" << nanos - none << " ns)\n";
+    };
+    std::cout << "Replay " << formatNumber(numMessages) << " messages:\n";
+    report("None:", none);
+    report("Counting:", counting);
+    report("Default (messages):", messageTimers);
+    report("Full (steady_clock):", steady);
+    report("Full (TSC):", tsc);
+
+    const auto &match = tscBook.GetPhaseLatency(Phase::Match);
+    std::cout << "  TSC match phase: p50 " << match.P50() << " ns, p99 " << match.P99() << " ns\n\n";
+}
+
+// Benchmark: identical seeded add/cancel/cross flow on the map book and the ladder book.
+template<typename Book>
+double RunBookSideFlow(Book &orderbook, int numOperations) {
+    std::mt19937 gen(42);
+    std::normal_distribution<double> offsetDist(0.0, 20.0);
+    std::uniform_int_distribution<Quantity> qtyDist(1, 100);
+    std::uniform_int_distribution<int> actionDist(0, 9);
+    std::vector<OrderId> activeOrders;
+    activeOrders.reserve(numOperations);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numOperations; ++i) {
+        if (activeOrders.empty() || actionDist(gen) < 6) {
+            Side side = (i % 2) ? Side::Buy : Side::Sell;
+            Price offset = std::abs(static_cast<Price>(offsetDist(gen)));
+            Price price = (side == Side::Buy) ? 1000 - offset : 1000 + offset;
+            orderbook.AddOrder(Order{OrderType::GoodTillCancel, (OrderId) i, side, price, qtyDist(gen)});
+            activeOrders.push_back(i);
+        } else {
+            size_t idx = gen() % activeOrders.size();
+            orderbook.CancelOrder(activeOrders[idx]);
+            activeOrders[idx] = activeOrders.back();
+            activeOrders.pop_back();
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+void BenchmarkMapVersusLadder(int numOperations) {
+    Orderbook mapBook;
+    LadderOrderbook ladderBook(LadderConfig::FromBand(500, 1500, 1));
+
+    double mapMicros = RunBookSideFlow(mapBook, numOperations);
+    double ladderMicros = RunBookSideFlow(ladderBook, numOperations);
+
+    std::cout << "Map vs ladder (" << formatNumber(numOperations) << " mixed operations):\n";
+    std::cout << "  Map book:    " << std::fixed << std::setprecision(2)
+            << mapMicros / 1000.0 << " ms ("
+            << formatNumber(static_cast<long long>(numOperations / (mapMicros / 1e6))) << " ops/sec)\n";
+    std::cout << "  Ladder book: " << std::fixed << std::setprecision(2)
+            << ladderMicros / 1000.0 << " ms ("
+            << formatNumber(static_cast<long long>(numOperations / (ladderMicros / 1e6))) << " ops/sec)\n\n";
 }
 
 // Simulates HFT with a realistically large book by separating the warmup
@@ -492,8 +2895,7 @@ void BenchmarkGetOrderInfos(int numOrders, int numCalls) {
 // other, keeping thousands of orders alive on both sides throughout.
 void BenchmarkHighFrequencyTrading() {
     Orderbook orderbook;
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    std::mt19937 gen(4);
 
     // Wide spread: buys up to 95, sells from 105 — orders won't cross
     std::uniform_int_distribution<Price> bidPriceDist(85, 95);
@@ -508,18 +2910,16 @@ void BenchmarkHighFrequencyTrading() {
     activeOrders.reserve(warmupOrders + numOperations);
     OrderId nextOrderId = 0;
 
-    // Warmup: build a large resting book, not measured
+    // Warmup: build a large resting book in one bulk load, not measured
+    std::vector<OrderSpec> warmup;
+    warmup.reserve(warmupOrders);
     for (int i = 0; i < warmupOrders; ++i) {
         Side side = (i % 2) ? Side::Buy : Side::Sell;
         Price price = (side == Side::Buy) ? bidPriceDist(gen) : askPriceDist(gen);
-        auto order = std::make_shared<Order>(
-            OrderType::GoodTillCancel, nextOrderId++, side, price, qtyDist(gen)
-        );
-        orderbook.AddOrder(order);
-        if (!order->IsFilled()) {
-            activeOrders.push_back(order->GetOrderId());
-        }
+        warmup.push_back(OrderSpec{OrderType::GoodTillCancel, nextOrderId, side, price, qtyDist(gen)});
+        activeOrders.push_back(nextOrderId++);
     }
+    orderbook.BulkLoad(warmup);
 
     int addCount = 0, cancelCount = 0, modifyCount = 0, tradeCount = 0;
 
@@ -545,7 +2945,8 @@ void BenchmarkHighFrequencyTrading() {
             // 30%: cancel a random active order
             size_t idx = gen() % activeOrders.size();
             orderbook.CancelOrder(activeOrders[idx]);
-            activeOrders.erase(activeOrders.begin() + idx);
+            activeOrders[idx] = activeOrders.back(); // O(1) swap-and-pop, order is irrelevant
+            activeOrders.pop_back();
             cancelCount++;
         } else {
             // 20%: modify a random active order (reprice within same side's range)
@@ -574,6 +2975,63 @@ void BenchmarkHighFrequencyTrading() {
     std::cout << "  Final book size: " << formatNumber((long long)orderbook.Size()) << " orders\n\n";
 }
 
+// Benchmark: independent symbols replayed through OrderbookManager with 1..N shards
+void BenchmarkMultiSymbol(int numSymbols, int messagesPerSymbol) {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<Price> bidPriceDist(85, 95);
+    std::uniform_int_distribution<Price> askPriceDist(105, 115);
+    std::uniform_int_distribution<Quantity> qtyDist(1, 10);
+    auto now = std::chrono::system_clock::now();
+
+    // Interleave the symbols the way a consolidated feed would: 70% adds, 30% cancels
+    std::vector<std::pair<SymbolId, MarketDataMessage> > feed;
+    feed.reserve(static_cast<std::size_t>(numSymbols) * messagesPerSymbol);
+    std::vector<std::vector<OrderId> > live(numSymbols);
+    OrderId nextOrderId = 0;
+    for (int i = 0; i < messagesPerSymbol; ++i) {
+        for (int s = 0; s < numSymbols; ++s) {
+            auto &orders = live[s];
+            if (orders.size() > 100 && gen() % 10 < 3) {
+                size_t idx = gen() % orders.size();
+                feed.emplace_back(s, CancelOrderMessage{MessageType::CancelOrder, orders[idx], now});
+                orders[idx] = orders.back();
+                orders.pop_back();
+            } else {
+                Side side = (gen() % 2) ? Side::Buy : Side::Sell;
+                Price price = (side == Side::Buy) ? bidPriceDist(gen) : askPriceDist(gen);
+                feed.emplace_back(s, NewOrderMessage{MessageType::NewOrder, nextOrderId, side, price,
+                                                     qtyDist(gen), OrderType::GoodTillCancel, now});
+                orders.push_back(nextOrderId++);
+            }
+        }
+    }
+
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Replay " << formatNumber(static_cast<long long>(feed.size())) << " messages across "
+            << numSymbols << " symbols:\n";
+    double baseline = 0.0;
+    for (unsigned shards = 1; shards <= cores; shards *= 2) {
+        OrderbookManager manager(shards, 65536);
+        for (int s = 0; s < numSymbols; ++s) manager.AddSymbol("SYM" + std::to_string(s));
+        manager.Start();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (const auto &[symbol, message]: feed) {
+            while (!manager.Route(symbol, message)) std::this_thread::yield();
+        }
+        manager.Stop();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        double messagesPerSec = feed.size() / seconds;
+        if (shards == 1) baseline = messagesPerSec;
+        std::cout << "  " << std::setw(2) << shards << " shard(s): "
+                << formatNumber(static_cast<long long>(messagesPerSec)) << " messages/sec ("
+                << std::fixed << std::setprecision(2) << messagesPerSec / baseline << "x)\n";
+    }
+    std::cout << "\n";
+}
+
 // ==================== MAIN TEST RUNNER ====================
 
 int main() {
@@ -589,21 +3047,65 @@ int main() {
     RUN_TEST(TestMultipleMatchesAtSamePrice);
     RUN_TEST(TestPricePriority);
     RUN_TEST(TestTimePriority_FIFO);
+    RUN_TEST(TestCancelPreservesTimePriority);
     RUN_TEST(TestMarketOrderBuy);
     RUN_TEST(TestMarketOrderSell);
     RUN_TEST(TestMarketOrderEmptyBook);
+    RUN_TEST(TestOrderFlagsPackTypeAndSide);
     RUN_TEST(TestImmediateOrCancel_PartialFill);
     RUN_TEST(TestImmediateOrCancel_NoMatch);
+    RUN_TEST(TestTypedEntryPointsSweepWithoutResting);
     RUN_TEST(TestFillOrKill_FullFill);
     RUN_TEST(TestFillOrKill_PartialAvailable);
     RUN_TEST(TestFillOrKill_MultipleOrders);
+    RUN_TEST(TestTradeSinkStreamsFills);
+    RUN_TEST(TestFillOrKillChecksLevelTotals);
     RUN_TEST(TestOrderModify);
+    RUN_TEST(TestAmendDownKeepsQueuePosition);
+    RUN_TEST(TestGoodForDayExpiresOnAdvanceTime);
+    RUN_TEST(TestCheckpointRestoresQueuePosition);
+    RUN_TEST(TestBulkLoadSortsOnceAndRejectsCrosses);
     RUN_TEST(TestOrderbookLevelInfos);
+    RUN_TEST(TestIncrementalLevelAggregates);
+    RUN_TEST(TestDepthKernelsMatchScalar);
+    RUN_TEST(TestTopOfBookPublisherSnapshots);
+    RUN_TEST(TestLevelDeltasMirrorTheBook);
+    RUN_TEST(TestLevelDeltasSkipUnchangedLevels);
     RUN_TEST(TestExchangeRulesBasic);
     RUN_TEST(TestMinNotionalValidation);
     RUN_TEST(TestMarketOrderValidation);
-
-    std::cout << "\nAll " << 21 << " functionality tests passed!\n";
+    RUN_TEST(TestMarketDataBatchDefersCrossing);
+    RUN_TEST(TestMarketDataBatchAggressiveOrderSeesPendingAdds);
+    RUN_TEST(TestMarketDataEventRoundTrip);
+    RUN_TEST(TestMarketDataEventProcessing);
+    RUN_TEST(TestSpscQueueWrapsAndRejectsWhenFull);
+    RUN_TEST(TestMarketDataPipelineDrainsOnStop);
+    RUN_TEST(TestOrderbookManagerRoutesBySymbol);
+    RUN_TEST(TestOrderbookManagerOnAppliedWithIdleSleep);
+    RUN_TEST(TestLatencyHistogramPercentiles);
+    RUN_TEST(TestMarketDataStatsRecordNanosPerType);
+    RUN_TEST(TestInstrumentationPolicies);
+    RUN_TEST(TestCaptureRecordAndReplay);
+    RUN_TEST(TestWorkStealingPoolRunsAndSteals);
+    RUN_TEST(TestBacktestReplaysEachSymbolDay);
+    RUN_TEST(TestOrderPoolFillsLowestChunkFirst);
+    RUN_TEST(TestCompactionReclaimsPeakMemory);
+    RUN_TEST(TestCompactionSlicesStayNearBudget);
+    RUN_TEST(TestSnapshotAppliesAsDiff);
+    RUN_TEST(TestStraySnapshotRecordsAreRejected);
+    RUN_TEST(TestDepthUpdatesFollowSequence);
+    RUN_TEST(TestDepthFeedHandlerSyncsAndResyncs);
+    RUN_TEST(TestDepthFeedHandlerResyncsOnGapInBuffer);
+    RUN_TEST(TestParseFixedPoint);
+    RUN_TEST(TestDepthParserPayloads);
+    RUN_TEST(TestOrderIndexPolicies);
+    RUN_TEST(TestOrderPoolReusesSlots);
+    RUN_TEST(TestOrderPointerCompatibility);
+    RUN_TEST(TestLadderOrderbookBasics);
+    RUN_TEST(TestLadderScansAcrossBitmapWords);
+    RUN_TEST(TestMarketRemainderIsDropped);
+
+    std::cout << "\nAll " << testsRun << " functionality tests passed!\n";
 
     PrintPerformanceHeader();
 
@@ -626,13 +3128,59 @@ int main() {
     BenchmarkModifyOrders(1000);
     BenchmarkModifyOrders(10000);
 
+    std::cout << "--- GoodForDay Expiry ---\n";
+    BenchmarkGoodForDayExpiry(100000, 1000);
+
+    std::cout << "--- Checkpoint, Restore and Bulk Load ---\n";
+    BenchmarkCheckpoint(1000000);
+    BenchmarkBulkLoad(1000000);
+
+    std::cout << "--- Aggressive Order Entry ---\n";
+    BenchmarkImmediateOrCancel(1000000);
+    BenchmarkFillOrKill(100, 100, 1000);
+    BenchmarkDeepSweep(1000, 1000);
+
     std::cout << "--- Market Data Snapshot Performance ---\n";
     BenchmarkGetOrderInfos(1000, 1000);
     BenchmarkGetOrderInfos(10000, 1000);
+    BenchmarkSnapshotApply(1000, 2000, 10);
+    BenchmarkDepthKernels(1000, 100000);
+    BenchmarkTopOfBookPublication(1000000);
+    BenchmarkLevelDeltas(1000, 100000);
+
+    std::cout << "--- Trade Reporting ---\n";
+    BenchmarkTradeSink(20000);
+
+    std::cout << "--- Depth Payload Parsing ---\n";
+    BenchmarkDepthParsing(5000, 200);
+
+    std::cout << "--- Market Data Ingestion ---\n";
+    BenchmarkMarketDataBatch(200000, 10000);
+
+    std::cout << "--- Capture Replay ---\n";
+    BenchmarkCaptureReplay(1000000);
+
+    std::cout << "--- Instrumentation Overhead ---\n";
+    BenchmarkInstrumentationOverhead(200000);
+
+    std::cout << "--- Order Index ---\n";
+    BenchmarkOrderIndex(1000000, 100000);
+
+    std::cout << "--- Book Side Containers ---\n";
+    BenchmarkMapVersusLadder(200000);
+
+    std::cout << "--- Allocations Per Operation ---\n";
+    BenchmarkAllocationsPerOperation(10000);
+
+    std::cout << "--- Memory Compaction ---\n";
+    BenchmarkCompaction(1000000, 50, std::chrono::microseconds{50});
 
     std::cout << "--- High-Frequency Trading Simulation ---\n";
     BenchmarkHighFrequencyTrading();
 
+    std::cout << "--- Multi-Symbol Sharding ---\n";
+    BenchmarkMultiSymbol(64, 20000);
+
     std::cout << "\nTesting complete!\n";
 
     return 0;